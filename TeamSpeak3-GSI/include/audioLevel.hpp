@@ -0,0 +1,60 @@
+#pragma once
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Level and clipping of a block of 16 bit PCM samples, channels interleaved or not does not matter.
+ * Kernels for SSE2 and AVX2 plus a portable scalar one, measureAudioLevel() picks the best the CPU supports.
+ * They only read the samples and never allocate, so they are safe on TeamSpeak's audio threads.
+ */
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define AUDIO_LEVEL_X86 1
+#endif
+
+struct AudioLevel {
+	/* Sum of the squared samples, exact even for a full scale block */
+	uint64_t sumSquares;
+	/* Largest absolute sample, 0..32768 */
+	unsigned int peak;
+	/* Samples at full scale (32767 or beyond -32767), i.e. most likely clipped */
+	unsigned int clipped;
+};
+
+typedef AudioLevel (*AudioLevelKernel)(const short* samples, size_t count);
+
+AudioLevel measureAudioLevelScalar(const short* samples, size_t count);
+#ifdef AUDIO_LEVEL_X86
+AudioLevel measureAudioLevelSSE2(const short* samples, size_t count);
+/* Only call if audioLevelAVX2Supported() */
+AudioLevel measureAudioLevelAVX2(const short* samples, size_t count);
+bool audioLevelAVX2Supported();
+#endif
+
+/* Runs the fastest kernel available, chosen on first use */
+AudioLevel measureAudioLevel(const short* samples, size_t count);
+const char* audioLevelKernelName();
+
+/* RMS of the block relative to full scale, 0..1 */
+inline float audioLevelRms(const AudioLevel& level, size_t count) {
+	return count ? (float)(sqrt((double)level.sumSquares / count) / 32768.0) : 0.0f;
+}
+
+/* Peak relative to full scale, 0..1 */
+inline float audioLevelPeak(const AudioLevel& level) {
+	return level.peak / 32768.0f;
+}
+
+// Levels this many dB or more below full scale count as silence on the loudness scale
+#define AUDIO_LOUDNESS_FLOOR_DB 60.0f
+
+/* Linear 0..1 to 0..100 on a dB scale, which follows perceived loudness far better than the raw amplitude */
+inline float audioLoudnessScale(float linear) {
+	if (linear <= 0.0f) {
+		return 0.0f;
+	}
+	float scaled = 100.0f * (1.0f + 20.0f * log10f(linear) / AUDIO_LOUDNESS_FLOOR_DB);
+	return scaled > 0.0f ? scaled : 0.0f;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <rapidjson/stringbuffer.h>
+
+#include "eventTypes.hpp"
+
+/* Serialized event on its way to Aurora. Buffers are recycled, their capacity survives between events */
+struct OutboundBuffer {
+	/* JSON or MessagePack, depending on sinkEncoding */
+	rapidjson::StringBuffer payload;
+	/* Events with the same non-zero key replace each other while waiting in the sender, only the latest is posted */
+	uint64_t coalesceKey;
+	/* Delay before the event may be posted. If a same-key event arrives meanwhile, the pair is a flap and both are dropped */
+	unsigned int holdMs;
+	/* For the per-event metrics, see pluginMetrics.hpp */
+	AuroraEvent type;
+	/* metricsNowNs() when the event went into the queue */
+	uint64_t enqueuedNs;
+};
+
+/* Periodic work of the sender thread, e.g. turning audio levels into events. Runs between posts, so it must be quick */
+typedef void (*SenderTask)();
+
+/* Runs task every periodMs on the sender thread. Register before startAuroraSender, stopAuroraSender forgets all tasks */
+bool addSenderTask(SenderTask task, unsigned int periodMs);
+
+/* Starts the background thread that delivers queued events to Aurora. Called from ts3plugin_init */
+void startAuroraSender();
+
+/* Stops and joins the sender thread, events still waiting in the queue are dropped. Called from ts3plugin_shutdown */
+void stopAuroraSender();
+
+/* Takes an empty buffer from the pool, returns nullptr if every buffer is in flight */
+OutboundBuffer* acquireOutboundBuffer();
+
+/* Gives a buffer back to the pool without sending it */
+void releaseOutboundBuffer(OutboundBuffer* buffer);
+
+/* Hands a filled buffer over to the sender thread, which returns it to the pool once sent.
+ * Never blocks, returns false if the queue was full and the event got dropped */
+bool enqueueBuffer_for_Aurora(OutboundBuffer* buffer);
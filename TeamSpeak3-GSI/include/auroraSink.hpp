@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stddef.h>
+
+#include <memory>
+
+/*
+ * Transport that carries payloads from the sender thread to Aurora.
+ * Implementations: HttpSink (POST through libcurl, the default), DatagramSink (one UDP datagram per payload)
+ * StreamSink (length framed payloads over localhost TCP or a Unix domain socket) and ShmRingSink (ring in shared memory).
+ * Not thread safe, a sink is only ever used from the sender thread.
+ */
+class AuroraSink {
+public:
+	virtual ~AuroraSink() {}
+
+	/* Sends one payload, returns true if it was delivered (as far as the transport can tell) */
+	virtual bool post(const char* payload, size_t length) = 0;
+
+	/* Largest payload the transport carries, bigger batches are split by the sender */
+	virtual size_t maxPayload() const { return (size_t)-1; }
+};
+
+/* Sink selected by sinkTransport and friends in the settings */
+std::unique_ptr<AuroraSink> createAuroraSink();
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <teamspeak/public_definitions.h>
+
+/*
+ * Level, peak and clipping of our own microphone, measured on ts3plugin_onEditCapturedVoiceDataEvent.
+ * The capture thread never locks or allocates, it hands its numbers to the sender thread through a wait-free
+ * SnapshotBuffer. The sender samples them captureLevelRateHz times a second (capped at what Aurora renders)
+ * and sends a "captureLevel" event whenever the level changed or samples clipped.
+ */
+
+/* Capture thread. The samples are only read */
+void recordCaptureLevel(uint64 serverConnectionHandlerID, const short* samples, int sampleCount, int channels);
+
+/* Adds the sampling task to the sender if captureLevelRateHz is set. Called from ts3plugin_init before the sender starts */
+void registerCaptureLevelTask();
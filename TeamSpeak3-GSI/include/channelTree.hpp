@@ -0,0 +1,89 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <unordered_map>
+#include <vector>
+
+#include <teamspeak/public_definitions.h>
+
+/*
+ * Channels and clients of one server connection as flat arrays keyed by dense indices,
+ * so membership, talker and subtree questions never have to go through the client library:
+ * - every channel keeps the indices of its clients and every client its slot in that list, moves are O(1)
+ * - talking clients are a bitset over the client indices, every channel counts its talkers
+ * - every channel knows the top level channel of its subtree, recomputed only when channels move
+ *
+ * Indices of removed channels and clients are reused. Not thread safe, serverState.cpp guards it with its mutex.
+ */
+
+typedef uint32_t TreeIndex;
+
+const TreeIndex noTreeIndex = 0xFFFFFFFFu;
+
+class ChannelTree {
+public:
+	void clear();
+
+	/* Replaces everything with these channels, parentIDs[i] is 0 for top level channels. Called when seeding at connect */
+	void build(const uint64* channelIDs, const uint64* parentIDs, size_t count);
+
+	/* Adds a channel or updates the parent of a known one. An unknown parent makes it a top level channel */
+	TreeIndex addChannel(uint64 channelID, uint64 parentID);
+	/* Its clients go with it, channels below it become top level channels */
+	bool removeChannel(uint64 channelID);
+	bool moveChannel(uint64 channelID, uint64 parentID);
+
+	TreeIndex findChannel(uint64 channelID) const;
+	uint64 channelID(TreeIndex channel) const { return channelIDs[channel]; }
+	TreeIndex topLevelChannel(TreeIndex channel) const { return channelRoots[channel]; }
+	/* True if channel is ancestor or below it, walks up the parents */
+	bool inSubtree(TreeIndex channel, TreeIndex ancestor) const;
+
+	size_t memberCount(TreeIndex channel) const { return channelMembers[channel].size(); }
+	const TreeIndex* members(TreeIndex channel) const { return channelMembers[channel].data(); }
+	unsigned int talkerCount(TreeIndex channel) const { return channelTalkers[channel]; }
+
+	/* Puts a client into a channel, adding it if it is new. channelID 0 or an unknown channel removes it and returns noTreeIndex */
+	TreeIndex moveClient(anyID clientID, uint64 channelID);
+	/* Returns true if the client's talking state changed */
+	bool setTalking(TreeIndex client, bool talking);
+
+	TreeIndex findClient(anyID clientID) const {
+		return clientID < clientIndices.size() ? clientIndices[clientID] : noTreeIndex;
+	}
+	anyID clientID(TreeIndex client) const { return clientIDs[client]; }
+	TreeIndex clientChannel(TreeIndex client) const { return clientChannels[client]; }
+	bool talking(TreeIndex client) const { return (talkerBits[client / 64] >> (client % 64)) & 1; }
+
+	size_t channelCount() const { return channelIndices.size(); }
+	size_t clientCount() const { return clientsInUse; }
+	size_t talkerCount() const { return talkersInUse; }
+	/* Upper bounds of the indices, for arrays kept alongside the tree */
+	size_t channelCapacity() const { return channelIDs.size(); }
+	size_t clientCapacity() const { return clientIDs.size(); }
+
+private:
+	void removeClient(TreeIndex client);
+	void refreshRoots();
+
+	std::unordered_map<uint64, TreeIndex> channelIndices;
+	std::vector<TreeIndex> freeChannels;
+	std::vector<uint64> channelIDs;
+	std::vector<TreeIndex> channelParents;
+	std::vector<TreeIndex> channelRoots;
+	std::vector<unsigned int> channelChildren;
+	std::vector<unsigned int> channelTalkers;
+	std::vector<std::vector<TreeIndex>> channelMembers;
+
+	// Client IDs are 16 bit, so they index this directly
+	std::vector<TreeIndex> clientIndices;
+	std::vector<TreeIndex> freeClients;
+	std::vector<anyID> clientIDs;
+	std::vector<TreeIndex> clientChannels;
+	std::vector<TreeIndex> clientSlots;
+	std::vector<uint64_t> talkerBits;
+	size_t clientsInUse = 0;
+	size_t talkersInUse = 0;
+};
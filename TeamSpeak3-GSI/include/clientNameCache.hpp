@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stddef.h>
+
+#include <teamspeak/public_definitions.h>
+
+/*
+ * Display names keyed by (serverConnectionHandlerID, clientID), filled lazily from getClientDisplayName.
+ * Lookups copy the name into the caller's buffer, so an entry can be replaced or dropped at any time
+ * and the cache only ever holds the names of clients it currently knows.
+ */
+
+// Same size the cache asks the client library with
+#define DISPLAY_NAME_BUFSIZE 512
+
+/* Copies the name into name (at most size bytes, always terminated). False if the client library does not know the client either */
+bool getCachedClientDisplayName(uint64 serverConnectionHandlerID, anyID clientID, char* name, size_t size);
+
+/* Stores a name TeamSpeak already told us about, e.g. from onClientDisplayNameChanged */
+void updateCachedClientDisplayName(uint64 serverConnectionHandlerID, anyID clientID, const char* displayName);
+
+/* Next lookup goes to the client library again. Used when a client changed or left */
+void invalidateCachedClientDisplayName(uint64 serverConnectionHandlerID, anyID clientID);
+
+/* Drops every entry of one connection */
+void clearCachedClientDisplayNames(uint64 serverConnectionHandlerID);
+
+/* Drops everything. Only call when no hook can run anymore */
+void releaseClientDisplayNameCache();
@@ -1,6 +1,7 @@
 #pragma once
 
-#include <rapidjson/document.h>
+#include "eventSerializer.hpp"
+
 #include <teamspeak/public_errors.h>
 #include <teamspeak/public_errors_rare.h>
 #include <teamspeak/public_definitions.h>
@@ -8,7 +9,5 @@
 #include <teamspeak/clientlib_publicdefinitions.h>
 #include <ts3_functions.h>
 
-int sendJSON_to_Aurora(rapidjson::Document& json);
-
 extern TS3Functions ts3Functions;
 
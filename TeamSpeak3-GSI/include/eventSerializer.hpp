@@ -0,0 +1,216 @@
+#pragma once
+
+#include <cstring>
+
+#include <rapidjson/allocators.h>
+#include <rapidjson/writer.h>
+#include <rapidjson/stringbuffer.h>
+
+#include <teamspeak/public_definitions.h>
+
+#include "auroraSender.hpp"
+#include "eventTypes.hpp"
+#include "msgPackWriter.hpp"
+#include "pluginMetrics.hpp"
+#include "settings.hpp"
+
+/*
+ * Streams events straight through a SAX writer, no DOM and no JSON Pointer parsing.
+ * Output is byte-identical to the old Pointer based documents:
+ * {"provider":{"name":"TeamSpeak","appid":-1},"data":{"<eventName>":{<fields in hook order>}}}
+ *
+ * With sinkEncoding = msgpack the same event goes out as MessagePack instead, names replaced by their tags
+ * from eventTypes.hpp: [<AuroraEvent>, {<EventFieldTag>: <value>, ...}]. No provider, the payload only ever
+ * comes from this plugin.
+ *
+ * Steady state is allocation free: the writer's nesting stack lives in a per-thread arena and
+ * the output goes into a recycled buffer from the sender's pool. Strings are written straight
+ * from the pointers TeamSpeak hands to the hook, never copied into intermediate objects.
+ */
+
+/* Constant parts of every payload, glued together by the preprocessor and copied verbatim */
+#define AURORA_EVENT_PREFIX(eventName) "{\"provider\":{\"name\":\"TeamSpeak\",\"appid\":-1},\"data\":{\"" #eventName "\":"
+#define AURORA_EVENT_SUFFIX "}}"
+
+typedef rapidjson::MemoryPoolAllocator<> EventWriterAllocator;
+typedef rapidjson::Writer<rapidjson::StringBuffer, rapidjson::UTF8<>, rapidjson::UTF8<>, EventWriterAllocator> EventWriter;
+
+// Payloads nest at most three objects deep, the arena comfortably holds the writer's level stack
+#define SERIALIZER_ARENA_SIZE 1024
+#define SERIALIZER_LEVEL_DEPTH 8
+
+/* Per-thread writer state, reused for every event serialized on that thread */
+struct SerializationContext {
+	alignas(16) char arena[SERIALIZER_ARENA_SIZE];
+	EventWriterAllocator allocator;
+	EventWriter writer;
+	MsgPackWriter msgPackWriter;
+
+	SerializationContext() : allocator(arena, sizeof(arena)), writer(&allocator, SERIALIZER_LEVEL_DEPTH) {}
+};
+
+inline SerializationContext& serializationContext() {
+	static thread_local SerializationContext context;
+	return context;
+}
+
+/* Key of a field, name, its length and the tag are compile-time constants */
+struct EventKey {
+	const char* name;
+	rapidjson::SizeType nameLength;
+	EventFieldTag tag;
+};
+
+template <size_t N>
+inline EventKey makeEventKey(const char (&name)[N], EventFieldTag tag) {
+	return EventKey{ name, N - 1, tag };
+}
+
+/* Key for the value callbacks, the name has to be in AURORA_EVENT_FIELDS */
+#define EVENT_KEY(keyName) makeEventKey(#keyName, EventFieldTag::keyName)
+
+inline void writeEventKey(EventWriter& writer, const EventKey& key) { writer.Key(key.name, key.nameLength); }
+inline void writeEventKey(MsgPackWriter& writer, const EventKey& key) { writer.Key(key.tag); }
+
+/* One hook argument */
+template <typename T>
+struct EventField {
+	EventKey key;
+	T value;
+};
+
+template <typename T>
+inline EventField<T> makeEventField(const EventKey& key, T value) {
+	return EventField<T>{ key, value };
+}
+
+#define EVENT_FIELD(valName) makeEventField(EVENT_KEY(valName), valName)
+
+/* Field whose key differs from the variable holding its value */
+#define NAMED_EVENT_FIELD(keyName, value) makeEventField(EVENT_KEY(keyName), value)
+
+// anyID used to be promoted to int by the DOM, keep writing it the same way
+template <typename Writer>
+inline void writeEventValue(Writer& writer, anyID value) { writer.Int(value); }
+template <typename Writer>
+inline void writeEventValue(Writer& writer, int value) { writer.Int(value); }
+template <typename Writer>
+inline void writeEventValue(Writer& writer, unsigned int value) { writer.Uint(value); }
+template <typename Writer>
+inline void writeEventValue(Writer& writer, uint64 value) { writer.Uint64(value); }
+template <typename Writer>
+inline void writeEventValue(Writer& writer, const char* value) {
+	if (value) {
+		writer.String(value, (rapidjson::SizeType)strlen(value));
+	}
+	else {
+		writer.Null();
+	}
+}
+
+/* Value written by a callback, for nested arrays and objects such as the state snapshot.
+ * The callback gets either writer, so it takes it as auto& and writes keys with writeEventKey */
+template <typename F>
+struct EventValueWriter {
+	F write;
+};
+
+template <typename F>
+inline EventValueWriter<F> makeEventValueWriter(F write) {
+	return EventValueWriter<F>{ write };
+}
+
+template <typename Writer, typename F>
+inline void writeEventValue(Writer& writer, const EventValueWriter<F>& value) {
+	value.write(writer);
+}
+
+template <typename Writer>
+inline void writeEventFields(Writer& writer, uint64_t omittedFields) {}
+
+/* Fields whose bit is set in omittedFields (omitFields setting) are skipped, their strings are never even measured */
+template <typename Writer, typename T, typename... Rest>
+inline void writeEventFields(Writer& writer, uint64_t omittedFields, const EventField<T>& field, const Rest&... rest) {
+	if (!((omittedFields >> (unsigned int)field.key.tag) & 1)) {
+		writeEventKey(writer, field.key);
+		writeEventValue(writer, field.value);
+	}
+	writeEventFields(writer, omittedFields, rest...);
+}
+
+inline void appendRawJSON(rapidjson::StringBuffer& buffer, const char* fragment, size_t length) {
+	memcpy(buffer.Push(length), fragment, length);
+}
+
+/* How the sender should treat an event, default is to post every single one */
+struct EventDelivery {
+	uint64_t coalesceKey;
+	unsigned int holdMs;
+};
+
+/* Only the newest pending event per (type, connection, subject) is posted, subject is e.g. a client ID */
+inline EventDelivery latestOnly(AuroraEvent type, uint64 serverConnectionHandlerID, uint64 subject, unsigned int holdMs = 0) {
+	uint64_t key = ((uint64_t)((unsigned char)type + 1) << 56) | ((serverConnectionHandlerID & 0xFFFFFFFFFFULL) << 16) | (subject & 0xFFFF);
+	return EventDelivery{ key, holdMs };
+}
+
+/* Appends one event in the given encoding, the JSON prefix comes from AURORA_EVENT_PREFIX */
+template <size_t N, typename... Fields>
+inline void serializeEvent(rapidjson::StringBuffer& out, PayloadEncoding encoding, AuroraEvent type, const char (&prefix)[N], const Fields&... fields) {
+	const uint64_t omittedFields = pluginSettings.omittedFields[(size_t)type];
+	if (encoding == PayloadEncoding::msgPack) {
+		MsgPackWriter& writer = serializationContext().msgPackWriter;
+		writer.Reset(out);
+		writer.StartArray();
+		writer.Uint((unsigned int)type);
+		writer.StartObject();
+		writeEventFields(writer, omittedFields, fields...);
+		writer.EndObject();
+		writer.EndArray();
+		return;
+	}
+
+	appendRawJSON(out, prefix, N - 1);
+
+	EventWriter& writer = serializationContext().writer;
+	writer.Reset(out);
+	writer.StartObject();
+	writeEventFields(writer, omittedFields, fields...);
+	writer.EndObject();
+
+	appendRawJSON(out, AURORA_EVENT_SUFFIX, sizeof(AURORA_EVENT_SUFFIX) - 1);
+}
+
+template <size_t N, typename... Fields>
+inline int sendEvent_to_Aurora(const EventDelivery& delivery, AuroraEvent type, const char (&prefix)[N], const Fields&... fields) {
+	const uint64_t startNs = metricsNowNs();
+	EventCounters& counters = pluginMetrics.events[(size_t)type];
+	OutboundBuffer* buffer = acquireOutboundBuffer();
+	if (!buffer) {
+		counters.dropped.fetch_add(1, std::memory_order_relaxed);
+		return 1;
+	}
+	buffer->coalesceKey = delivery.coalesceKey;
+	buffer->holdMs = delivery.holdMs;
+	buffer->type = type;
+	serializeEvent(buffer->payload, pluginSettings.sinkEncoding, type, prefix, fields...);
+	buffer->enqueuedNs = metricsNowNs();
+	pluginMetrics.serialize.record(buffer->enqueuedNs - startNs);
+	if (tracing()) {
+		traceSpan(TraceCategory::serialize, auroraEventName(type), startNs, buffer->enqueuedNs);
+	}
+
+	if (!enqueueBuffer_for_Aurora(buffer)) {
+		counters.dropped.fetch_add(1, std::memory_order_relaxed);
+		return 1;
+	}
+	counters.queued.fetch_add(1, std::memory_order_relaxed);
+	// Periodic events from sender tasks have no hook, their time starts with this call
+	pluginMetrics.hookToEnqueue.record(metricsNowNs() - (hookEntryNs ? hookEntryNs : startNs));
+	return 0;
+}
+
+#define SEND_EVENT_TO_AURORA(eventName, ...) sendEvent_to_Aurora(EventDelivery{ 0, 0 }, AuroraEvent::eventName, AURORA_EVENT_PREFIX(eventName), __VA_ARGS__)
+
+/* Same as SEND_EVENT_TO_AURORA, but stale pending events with the same key are replaced (see latestOnly) */
+#define SEND_LATEST_EVENT_TO_AURORA(delivery, eventName, ...) sendEvent_to_Aurora(delivery, AuroraEvent::eventName, AURORA_EVENT_PREFIX(eventName), __VA_ARGS__)
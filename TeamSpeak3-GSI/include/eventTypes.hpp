@@ -0,0 +1,130 @@
+#pragma once
+
+#include <stdint.h>
+
+/*
+ * Every payload type the plugin sends. Names match the event key used in the JSON payload,
+ * the position is the event's tag in MessagePack payloads. Only ever append to this list
+ */
+#define AURORA_EVENTS(X) \
+	X(onConnectStatusChangeEvent) \
+	X(onClientMoveEvent) \
+	X(onClientKickFromChannelEvent) \
+	X(onClientKickFromServerEvent) \
+	X(onClientPokeEvent) \
+	X(onTextMessageEvent) \
+	X(onTalkStatusChangeEvent) \
+	X(onClientSelfVariableUpdateEvent) \
+	X(serverState) \
+	X(voiceLevel) \
+	X(captureLevel) \
+	X(spectrum) \
+	X(serverSummary)
+
+#define AURORA_EVENT_ENUM_ENTRY(eventName) eventName,
+enum class AuroraEvent : unsigned char {
+	AURORA_EVENTS(AURORA_EVENT_ENUM_ENTRY)
+	count
+};
+#undef AURORA_EVENT_ENUM_ENTRY
+
+/* Every key inside an event, the position is the key's tag in MessagePack payloads. Only ever append to this list */
+#define AURORA_EVENT_FIELDS(X) \
+	X(serverConnectionHandlerID) \
+	X(newStatus) \
+	X(errorNumber) \
+	X(clientID) \
+	X(oldChannelID) \
+	X(newChannelID) \
+	X(visibility) \
+	X(moveMessage) \
+	X(kickerID) \
+	X(kickerName) \
+	X(kickerUniqueIdentifier) \
+	X(kickMessage) \
+	X(fromClientID) \
+	X(pokerName) \
+	X(pokerUniqueIdentity) \
+	X(message) \
+	X(ffIgnored) \
+	X(toID) \
+	X(fromName) \
+	X(fromUniqueIdentifier) \
+	X(status) \
+	X(isReceivedWhisper) \
+	X(name) \
+	X(flag) \
+	X(oldValue) \
+	X(newValue) \
+	X(channelID) \
+	X(channelName) \
+	X(channelCount) \
+	X(clientCount) \
+	X(channelClients) \
+	X(talkStatus) \
+	X(loudness) \
+	X(peak) \
+	X(clipped) \
+	X(bands) \
+	X(channelClientCount) \
+	X(channelTalkerCount) \
+	X(talkerCount)
+
+#define AURORA_EVENT_FIELD_ENUM_ENTRY(fieldName) fieldName,
+enum class EventFieldTag : uint8_t {
+	AURORA_EVENT_FIELDS(AURORA_EVENT_FIELD_ENUM_ENTRY)
+	count
+};
+#undef AURORA_EVENT_FIELD_ENUM_ENTRY
+
+// MessagePack writes a tag as a single positive fixint byte (see MsgPackWriter::Key)
+static_assert((size_t)EventFieldTag::count <= 128, "field tags must fit a positive fixint");
+// omitFields keeps a uint64_t bit per field (see writeEventFields)
+static_assert((size_t)EventFieldTag::count <= 64, "omittedFields holds a bit per field");
+
+/* Sender queue of an event. The sender takes high before normal before low, and posts a batch holding
+ * a high event right away instead of waiting for the batch window. Normal and low drop their oldest event when full */
+enum class EventLane : unsigned char {
+	high,
+	normal,
+	low,
+	count
+};
+
+inline EventLane eventLane(AuroraEvent type) {
+	switch (type) {
+	case AuroraEvent::onConnectStatusChangeEvent:
+	case AuroraEvent::onClientKickFromChannelEvent:
+	case AuroraEvent::onClientKickFromServerEvent:
+	case AuroraEvent::onClientPokeEvent:
+	case AuroraEvent::onTextMessageEvent:
+	case AuroraEvent::onTalkStatusChangeEvent:
+	case AuroraEvent::onClientSelfVariableUpdateEvent:
+		return EventLane::high;
+	case AuroraEvent::serverState:
+	case AuroraEvent::serverSummary:
+		// Whole snapshots, the newest one replaces everything before it anyway
+		return EventLane::low;
+	default:
+		return EventLane::normal;
+	}
+}
+
+inline const char* eventLaneName(EventLane lane) {
+	static const char* const names[] = { "high", "normal", "low" };
+	return lane < EventLane::count ? names[(size_t)lane] : nullptr;
+}
+
+inline const char* auroraEventName(AuroraEvent type) {
+#define AURORA_EVENT_NAME_ENTRY(eventName) #eventName,
+	static const char* const names[] = { AURORA_EVENTS(AURORA_EVENT_NAME_ENTRY) };
+#undef AURORA_EVENT_NAME_ENTRY
+	return type < AuroraEvent::count ? names[(size_t)type] : nullptr;
+}
+
+inline const char* eventFieldName(EventFieldTag tag) {
+#define AURORA_EVENT_FIELD_NAME_ENTRY(fieldName) #fieldName,
+	static const char* const names[] = { AURORA_EVENT_FIELDS(AURORA_EVENT_FIELD_NAME_ENTRY) };
+#undef AURORA_EVENT_FIELD_NAME_ENTRY
+	return tag < EventFieldTag::count ? names[(size_t)tag] : nullptr;
+}
@@ -0,0 +1,190 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <atomic>
+
+#include <teamspeak/public_definitions.h>
+
+#include "pluginMetrics.hpp"
+
+/*
+ * Optional recording of every hook call into an append-only binary log, so real traffic can be replayed
+ * through the plugin later (mockHost --replay). The file is written through a memory mapping that grows in chunks.
+ *
+ * Layout, little endian:
+ *   header  "AGSIHKL1", uint32 version, uint32 header size
+ *   record  uint32 record size (0 ends the log), uint16 HookLogID, uint16 0, uint64 ns since the log started,
+ *           then the hook arguments in signature order:
+ *             integers as they are (uint64 8 bytes, anyID 2, int and unsigned int 4)
+ *             strings as uint32 length (0xFFFFFFFF for nullptr), the bytes and a terminating 0
+ *             pointers to buffers (samples, edited flags, speaker masks) as uint32 byte count and the bytes
+ */
+
+#define HOOK_LOG_MAGIC "AGSIHKL1"
+#define HOOK_LOG_VERSION 1
+#define HOOK_LOG_NULL_STRING 0xFFFFFFFFu
+
+struct HookLogHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t headerSize;
+};
+
+struct HookLogRecordHeader {
+	uint32_t size;
+	uint16_t hook;
+	uint16_t reserved;
+	uint64_t timestampNs;
+};
+
+/* Every recorded hook, the name is the export without its ts3plugin_ prefix. Only ever append to this list */
+#define HOOK_LOG_HOOKS(X) \
+	X(onConnectStatusChangeEvent) \
+	X(onNewChannelEvent) \
+	X(onNewChannelCreatedEvent) \
+	X(onDelChannelEvent) \
+	X(onChannelMoveEvent) \
+	X(onUpdateChannelEvent) \
+	X(onUpdateChannelEditedEvent) \
+	X(onUpdateClientEvent) \
+	X(onClientMoveEvent) \
+	X(onClientMoveSubscriptionEvent) \
+	X(onClientMoveTimeoutEvent) \
+	X(onClientMoveMovedEvent) \
+	X(onClientKickFromChannelEvent) \
+	X(onClientKickFromServerEvent) \
+	X(onClientBanFromServerEvent) \
+	X(onClientPokeEvent) \
+	X(onTextMessageEvent) \
+	X(onTalkStatusChangeEvent) \
+	X(onClientSelfVariableUpdateEvent) \
+	X(onClientDisplayNameChanged) \
+	X(onEditPlaybackVoiceDataEvent) \
+	X(onEditCapturedVoiceDataEvent) \
+	X(onEditMixedPlaybackVoiceDataEvent) \
+	X(onChannelSubscribeEvent) \
+	X(onChannelSubscribeFinishedEvent) \
+	X(onChannelUnsubscribeEvent) \
+	X(onChannelUnsubscribeFinishedEvent) \
+	X(onClientIDsEvent) \
+	X(onClientIDsFinishedEvent) \
+	X(currentServerConnectionChanged)
+
+#define HOOK_LOG_ENUM_ENTRY(hookName) hookName,
+enum class HookLogID : uint16_t {
+	HOOK_LOG_HOOKS(HOOK_LOG_ENUM_ENTRY)
+	count
+};
+#undef HOOK_LOG_ENUM_ENTRY
+
+inline const char* hookLogName(HookLogID hook) {
+#define HOOK_LOG_NAME_ENTRY(hookName) #hookName,
+	static const char* const names[] = { HOOK_LOG_HOOKS(HOOK_LOG_NAME_ENTRY) };
+#undef HOOK_LOG_NAME_ENTRY
+	return hook < HookLogID::count ? names[(size_t)hook] : "unknown";
+}
+
+/* Opens a new log in the config folder if hookLog is set. Called from ts3plugin_init */
+void startHookLog(const char* configPath);
+
+/* Truncates the log to what was written and closes it. Called from ts3plugin_shutdown */
+void stopHookLog();
+
+/* Reserves a record with size bytes of arguments and fills its header. Returns where the arguments go and holds
+ * the log's lock until finishHookRecord, or returns nullptr if the log is closed or full */
+char* beginHookRecord(HookLogID hook, size_t size);
+void finishHookRecord();
+
+extern std::atomic<bool> hookLogActive;
+extern std::atomic<bool> hookLogAudioActive;
+
+/* Buffer argument of a hook, recorded by value */
+template <typename T>
+struct HookLogBlob {
+	const T* data;
+	size_t count;
+};
+
+template <typename T>
+inline HookLogBlob<T> hookLogBlob(const T* data, size_t count) {
+	return HookLogBlob<T>{ data, data ? count : 0 };
+}
+
+// Argument sizes
+inline size_t hookArgSize(uint64) { return 8; }
+inline size_t hookArgSize(anyID) { return 2; }
+inline size_t hookArgSize(int) { return 4; }
+inline size_t hookArgSize(unsigned int) { return 4; }
+inline size_t hookArgSize(const char* value) { return 4 + (value ? strlen(value) + 1 : 0); }
+template <typename T>
+inline size_t hookArgSize(const HookLogBlob<T>& value) { return 4 + value.count * sizeof(T); }
+
+inline size_t hookArgsSize() { return 0; }
+
+template <typename T, typename... Rest>
+inline size_t hookArgsSize(const T& value, const Rest&... rest) {
+	return hookArgSize(value) + hookArgsSize(rest...);
+}
+
+// Argument encoding, out always has room as the record was sized with hookArgsSize
+template <typename T>
+inline char* writeHookInteger(char* out, T value) {
+	memcpy(out, &value, sizeof(value));
+	return out + sizeof(value);
+}
+
+inline char* writeHookArg(char* out, uint64 value) { return writeHookInteger(out, value); }
+inline char* writeHookArg(char* out, anyID value) { return writeHookInteger(out, value); }
+inline char* writeHookArg(char* out, int value) { return writeHookInteger(out, value); }
+inline char* writeHookArg(char* out, unsigned int value) { return writeHookInteger(out, value); }
+inline char* writeHookArg(char* out, const char* value) {
+	if (!value) {
+		return writeHookInteger(out, (uint32_t)HOOK_LOG_NULL_STRING);
+	}
+	const size_t length = strlen(value);
+	out = writeHookInteger(out, (uint32_t)length);
+	memcpy(out, value, length + 1);
+	return out + length + 1;
+}
+template <typename T>
+inline char* writeHookArg(char* out, const HookLogBlob<T>& value) {
+	const size_t bytes = value.count * sizeof(T);
+	out = writeHookInteger(out, (uint32_t)bytes);
+	if (bytes) {
+		memcpy(out, value.data, bytes);
+	}
+	return out + bytes;
+}
+
+inline char* writeHookArgs(char* out) { return out; }
+
+template <typename T, typename... Rest>
+inline char* writeHookArgs(char* out, const T& value, const Rest&... rest) {
+	return writeHookArgs(writeHookArg(out, value), rest...);
+}
+
+template <typename... Args>
+inline void recordHook(HookLogID hook, const Args&... args) {
+	char* out = beginHookRecord(hook, hookArgsSize(args...));
+	if (out) {
+		writeHookArgs(out, args...);
+		finishHookRecord();
+	}
+}
+
+/* First line of every hook. Stamps the hook entry for the metrics and the trace, then a relaxed load and a branch while no log is being written */
+#define RECORD_HOOK(hookName, ...) \
+	HookEntryScope hookEntryScope(#hookName); \
+	if (hookLogActive.load(std::memory_order_relaxed)) { \
+		recordHook(HookLogID::hookName, __VA_ARGS__); \
+	}
+
+/* Same for the audio hooks, which are only recorded if hookLogAudio is set as well. They enqueue nothing, so only the trace times them */
+#define RECORD_AUDIO_HOOK(hookName, ...) \
+	TraceScope hookTraceScope(TraceCategory::hook, #hookName); \
+	if (hookLogAudioActive.load(std::memory_order_relaxed)) { \
+		recordHook(HookLogID::hookName, __VA_ARGS__); \
+	}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+
+#include "auroraSink.hpp"
+
+// Room for "http://localhost:<port>"
+#define SINK_URL_BUFSIZE 64
+#define SINK_HEADER_BUFSIZE 64
+
+typedef void CURL;
+struct curl_slist;
+
+/*
+ * Long-lived HTTP connection to Aurora's GSI endpoint, the default transport.
+ * The Content-Type tells Aurora how the payloads are encoded (application/json or application/msgpack).
+ * Owns one reused easy handle, so libcurl keeps the TCP connection to Aurora open between events.
+ * Not thread safe, it is only ever used from the sender thread.
+ */
+class HttpSink : public AuroraSink {
+public:
+	HttpSink(const char* url, const char* contentType, long connectTimeoutMs, long requestTimeoutMs);
+	~HttpSink() override;
+
+	/* POSTs one payload, returns true if Aurora accepted it */
+	bool post(const char* payload, size_t length) override;
+
+private:
+	bool createHandle();
+	void destroyHandle();
+	int perform(const char* payload, size_t length);
+
+	char url[SINK_URL_BUFSIZE];
+	long connectTimeoutMs;
+	long requestTimeoutMs;
+	CURL* curlHandle;
+	struct curl_slist* headers;
+	bool reconnectNeeded;
+	unsigned int consecutiveFailures;
+};
@@ -0,0 +1,209 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <rapidjson/stringbuffer.h>
+
+#include "eventTypes.hpp"
+
+/*
+ * MessagePack counterpart of the JSON EventWriter, with the same SAX style calls so the serializer and the
+ * value callbacks work with either. Keys are written as their EventFieldTag, a positive fixint of one byte.
+ *
+ * Maps and arrays start with a one byte placeholder that EndObject/EndArray fill in with the element count.
+ * Containers of more than 15 elements (e.g. the clients of a big channel) are moved up to make room for a longer header.
+ */
+
+// Container nesting supported, same as the JSON writer's level stack
+#define MSGPACK_WRITER_DEPTH 8
+
+/* Array header for count elements, used for the batch of several events */
+inline void writeMsgPackArrayHeader(rapidjson::StringBuffer& out, size_t count) {
+	if (count < 16) {
+		out.Put((char)(0x90 | count));
+	}
+	else if (count <= 0xFFFF) {
+		char* header = out.Push(3);
+		header[0] = (char)0xdc;
+		header[1] = (char)(count >> 8);
+		header[2] = (char)count;
+	}
+	else {
+		char* header = out.Push(5);
+		header[0] = (char)0xdd;
+		header[1] = (char)(count >> 24);
+		header[2] = (char)(count >> 16);
+		header[3] = (char)(count >> 8);
+		header[4] = (char)count;
+	}
+}
+
+class MsgPackWriter {
+public:
+	MsgPackWriter() : out(nullptr), depth(0) {}
+
+	void Reset(rapidjson::StringBuffer& buffer) {
+		out = &buffer;
+		depth = 0;
+	}
+
+	bool Null() {
+		countValue();
+		out->Put((char)0xc0);
+		return true;
+	}
+
+	bool Bool(bool value) {
+		countValue();
+		out->Put((char)(value ? 0xc3 : 0xc2));
+		return true;
+	}
+
+	bool Int(int value) {
+		return Int64(value);
+	}
+
+	bool Int64(int64_t value) {
+		if (value >= 0) {
+			return Uint64((uint64_t)value);
+		}
+		countValue();
+		if (value >= -32) {
+			out->Put((char)value);
+		}
+		else if (value >= INT8_MIN) {
+			writeBigEndian(0xd0, (uint8_t)value);
+		}
+		else if (value >= INT16_MIN) {
+			writeBigEndian(0xd1, (uint16_t)value);
+		}
+		else if (value >= INT32_MIN) {
+			writeBigEndian(0xd2, (uint32_t)value);
+		}
+		else {
+			writeBigEndian(0xd3, (uint64_t)value);
+		}
+		return true;
+	}
+
+	bool Uint(unsigned int value) {
+		return Uint64(value);
+	}
+
+	bool Uint64(uint64_t value) {
+		countValue();
+		if (value < 0x80) {
+			out->Put((char)value);
+		}
+		else if (value <= 0xFF) {
+			writeBigEndian(0xcc, (uint8_t)value);
+		}
+		else if (value <= 0xFFFF) {
+			writeBigEndian(0xcd, (uint16_t)value);
+		}
+		else if (value <= 0xFFFFFFFFu) {
+			writeBigEndian(0xce, (uint32_t)value);
+		}
+		else {
+			writeBigEndian(0xcf, value);
+		}
+		return true;
+	}
+
+	bool String(const char* value, size_t length) {
+		countValue();
+		if (length < 32) {
+			out->Put((char)(0xa0 | length));
+		}
+		else if (length <= 0xFF) {
+			writeBigEndian(0xd9, (uint8_t)length);
+		}
+		else if (length <= 0xFFFF) {
+			writeBigEndian(0xda, (uint16_t)length);
+		}
+		else {
+			writeBigEndian(0xdb, (uint32_t)length);
+		}
+		if (length) {
+			memcpy(out->Push(length), value, length);
+		}
+		return true;
+	}
+
+	bool Key(EventFieldTag tag) {
+		levels[depth - 1].count++;
+		out->Put((char)tag);
+		return true;
+	}
+
+	bool StartObject() { return startContainer(0x80); }
+	bool EndObject() { return endContainer(); }
+	bool StartArray() { return startContainer(0x90); }
+	bool EndArray() { return endContainer(); }
+
+private:
+	struct Level {
+		size_t start;
+		size_t count;
+		unsigned char fixType;
+	};
+
+	void countValue() {
+		// Map entries are counted by their key
+		if (depth && levels[depth - 1].fixType == 0x90) {
+			levels[depth - 1].count++;
+		}
+	}
+
+	template <typename T>
+	void writeBigEndian(unsigned char type, T value) {
+		char* bytes = out->Push(1 + sizeof(T));
+		bytes[0] = (char)type;
+		for (size_t i = 0; i < sizeof(T); i++) {
+			bytes[1 + i] = (char)(value >> (8 * (sizeof(T) - 1 - i)));
+		}
+	}
+
+	bool startContainer(unsigned char fixType) {
+		if (depth == MSGPACK_WRITER_DEPTH) {
+			return false;
+		}
+		countValue();
+		levels[depth++] = Level{ out->GetSize(), 0, fixType };
+		out->Put((char)fixType);
+		return true;
+	}
+
+	bool endContainer() {
+		const Level level = levels[--depth];
+		if (level.count < 16) {
+			((char*)out->GetString())[level.start] = (char)(level.fixType | level.count);
+			return true;
+		}
+
+		// Grow the placeholder into a 16 or 32 bit header, moving the elements up
+		const bool map = level.fixType == 0x80;
+		const size_t extra = level.count <= 0xFFFF ? 2 : 4;
+		const size_t elementsSize = out->GetSize() - level.start - 1;
+		out->Push(extra);
+		char* header = (char*)out->GetString() + level.start;
+		memmove(header + 1 + extra, header + 1, elementsSize);
+		if (extra == 2) {
+			header[0] = (char)(map ? 0xde : 0xdc);
+		}
+		else {
+			header[0] = (char)(map ? 0xdf : 0xdd);
+			header[1] = (char)(level.count >> 24);
+			header[2] = (char)(level.count >> 16);
+		}
+		header[extra - 1] = (char)(level.count >> 8);
+		header[extra] = (char)level.count;
+		return true;
+	}
+
+	rapidjson::StringBuffer* out;
+	Level levels[MSGPACK_WRITER_DEPTH];
+	size_t depth;
+};
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <chrono>
+#include <string>
+
+#include "eventTypes.hpp"
+#include "traceLog.hpp"
+
+/*
+ * Runtime metrics of the event pipeline, shown in the info panel and by the "/aurora stats" command.
+ * Everything is a relaxed atomic, hooks and the sender update them without locks.
+ *
+ * Latencies go into log2 histograms with microsecond resolution: bucket 0 holds everything below 1 us,
+ * bucket i holds [2^(i-1), 2^i) us and the last bucket everything above. Percentiles are reported as the
+ * upper bound of the bucket they fall into.
+ */
+
+#define LATENCY_BUCKETS 26
+
+/* Nanoseconds on the steady clock, the time base of every latency */
+inline uint64_t metricsNowNs() {
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct LatencySummary {
+	uint64_t count;
+	uint64_t meanUs;
+	uint64_t p50Us;
+	uint64_t p99Us;
+	uint64_t maxUs;
+};
+
+class LatencyHistogram {
+public:
+	LatencyHistogram();
+
+	void record(uint64_t ns) {
+		uint64_t us = ns / 1000;
+		size_t bucket = 0;
+		while (us && bucket < LATENCY_BUCKETS - 1) {
+			us >>= 1;
+			bucket++;
+		}
+		buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+		totalNs.fetch_add(ns, std::memory_order_relaxed);
+		uint64_t previousMax = maxNs.load(std::memory_order_relaxed);
+		while (ns > previousMax && !maxNs.compare_exchange_weak(previousMax, ns, std::memory_order_relaxed)) {
+		}
+	}
+
+	LatencySummary summary() const;
+	uint64_t bucket(size_t index) const { return buckets[index].load(std::memory_order_relaxed); }
+	void reset();
+
+private:
+	std::atomic<uint64_t> buckets[LATENCY_BUCKETS];
+	std::atomic<uint64_t> totalNs;
+	std::atomic<uint64_t> maxNs;
+};
+
+/* What happened to the events of one type */
+struct EventCounters {
+	/* Serialized and handed to the sender */
+	std::atomic<uint64_t> queued;
+	/* Posted to a sink that accepted them */
+	std::atomic<uint64_t> sent;
+	/* Lost on the way: pool or queue full, breaker open or the sink refused the request */
+	std::atomic<uint64_t> dropped;
+	/* Replaced by a newer event with the same key, or cancelled as a flap (see latestOnly) */
+	std::atomic<uint64_t> coalesced;
+};
+
+struct PluginMetrics {
+	EventCounters events[(size_t)AuroraEvent::count];
+
+	/* From the hook's first line (the sender task's call for periodic events) to the event sitting in the queue */
+	LatencyHistogram hookToEnqueue;
+	/* Encoding one event into its buffer */
+	LatencyHistogram serialize;
+	/* From the queue to the sink per EventLane, includes the batch window and held talk stops */
+	LatencyHistogram queueWait[(size_t)EventLane::count];
+	/* One sink post, single event or batch */
+	LatencyHistogram send;
+
+	std::atomic<uint64_t> queueDepth;
+	std::atomic<uint64_t> queueDepthPeak;
+	std::atomic<uint64_t> sinkRequests;
+	std::atomic<uint64_t> sinkErrors;
+	std::atomic<uint64_t> sinkBytes;
+	/* SinkHealth::State of the sender's breaker */
+	std::atomic<unsigned int> breakerState;
+
+	std::atomic<uint64_t> startedNs;
+};
+
+extern PluginMetrics pluginMetrics;
+
+/* Steady clock time the current thread entered a hook, 0 outside hooks */
+extern thread_local uint64_t hookEntryNs;
+
+/* Stamps hookEntryNs for the lifetime of the hook and traces the hook as a span if tracing is on, see RECORD_HOOK */
+class HookEntryScope {
+public:
+	explicit HookEntryScope(const char* hookName) : hookName(hookName) { hookEntryNs = metricsNowNs(); }
+	~HookEntryScope() {
+		if (tracing()) {
+			traceSpan(TraceCategory::hook, hookName, hookEntryNs, metricsNowNs());
+		}
+		hookEntryNs = 0;
+	}
+
+	HookEntryScope(const HookEntryScope&) = delete;
+	HookEntryScope& operator=(const HookEntryScope&) = delete;
+
+private:
+	const char* hookName;
+};
+
+/* Zeroes every counter and histogram, the queue depth stays. Called from ts3plugin_init and by "/aurora stats reset" */
+void resetPluginMetrics();
+
+/* Human readable summary, one line per item. perEvent adds a line for every event type seen so far */
+void formatMetricsText(std::string& out, bool perEvent);
+
+/* Everything, including the raw histogram buckets, as one JSON object */
+void formatMetricsJson(std::string& out);
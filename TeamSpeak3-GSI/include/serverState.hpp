@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+
+#include <teamspeak/public_definitions.h>
+
+/*
+ * In-memory mirror of the channels and clients of every server connection.
+ * Seeded from the client library once a connection is established and afterwards only
+ * updated from hook arguments, so building a snapshot never has to query TeamSpeak.
+ *
+ * The update functions return true when the change is visible in the snapshot, the
+ * caller then sends a fresh one with sendServerStateSnapshot().
+ */
+
+/*
+ * Connection of the selected server tab, 0 until the client told us. Only the focused connection sends
+ * serverState snapshots and per client events, every other one sends a serverSummary at most every
+ * backgroundSummaryMs, and only if something changed.
+ */
+extern std::atomic<uint64> focusedConnection;
+
+inline bool isFocusedConnection(uint64 serverConnectionHandlerID) {
+	const uint64 focused = focusedConnection.load(std::memory_order_relaxed);
+	return focused == 0 || focused == serverConnectionHandlerID;
+}
+
+/* Sends a snapshot of the newly focused connection right away, the one that went to the background gets a summary */
+void focusConnection(uint64 serverConnectionHandlerID);
+
+/* Adds the summary task to the sender if backgroundSummaryMs is set. Called from ts3plugin_init before the sender starts */
+void registerServerSummaryTask();
+
+/* Reads the full channel and client lists. Called when STATUS_CONNECTION_ESTABLISHED is reached */
+bool seedServerState(uint64 serverConnectionHandlerID);
+
+/* Forgets everything about a connection. Called on STATUS_DISCONNECTED */
+void clearServerState(uint64 serverConnectionHandlerID);
+
+/* newChannelID 0 means the client left our view, oldChannelID 0 means it just appeared */
+bool updateStateClientMoved(uint64 serverConnectionHandlerID, anyID clientID, uint64 oldChannelID, uint64 newChannelID);
+bool updateStateClientUpdated(uint64 serverConnectionHandlerID, anyID clientID);
+/* Name from an onClientIDsEvent, which needs no call into the client library */
+bool updateStateClientIDs(uint64 serverConnectionHandlerID, anyID clientID, const char* clientName);
+bool updateStateTalkStatus(uint64 serverConnectionHandlerID, anyID clientID, int status);
+
+bool updateStateChannelAdded(uint64 serverConnectionHandlerID, uint64 channelID, uint64 channelParentID);
+bool updateStateChannelDeleted(uint64 serverConnectionHandlerID, uint64 channelID);
+bool updateStateChannelMoved(uint64 serverConnectionHandlerID, uint64 channelID, uint64 newChannelParentID);
+bool updateStateChannelUpdated(uint64 serverConnectionHandlerID, uint64 channelID);
+
+/*
+ * Bursts the client library closes with a ...Finished callback: channel (un)subscriptions with the
+ * onClientMoveSubscriptionEvent calls for every client they reveal or hide, and the answers to a client ID request.
+ * While one is open the update functions return false and only note a change, endStateBurst returns whether
+ * there was one once the last open burst is finished, so the whole burst makes a single snapshot.
+ */
+enum class StateBurst : unsigned int {
+	channelSubscribe = 1,
+	channelUnsubscribe = 2,
+	clientIDs = 4
+};
+
+/* Called by every onChannel(Un)subscribeEvent and onClientIDsEvent, the first one opens the burst */
+void beginStateBurst(uint64 serverConnectionHandlerID, StateBurst burst);
+bool endStateBurst(uint64 serverConnectionHandlerID, StateBurst burst);
+
+/*
+ * Sends the current state of a connection as a "serverState" event:
+ * own client and channel, everyone in our channel with their talk status, plus server wide totals.
+ * For a background connection it only marks the summary due.
+ */
+void sendServerStateSnapshot(uint64 serverConnectionHandlerID);
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <string>
+
+#include "eventTypes.hpp"
+
+/* How payloads travel to Aurora, see auroraSink.hpp */
+enum class SinkTransport : unsigned int {
+	http,
+	udp,
+	tcp,
+	unixSocket,
+	shm
+};
+
+/* How events are encoded, see eventSerializer.hpp */
+enum class PayloadEncoding : unsigned int {
+	json,
+	msgPack
+};
+
+/*
+ * Plugin settings, read once from aurora_gsi.ini in the TeamSpeak config folder.
+ * The file holds "key = value" lines, '#' and ';' start comments. Missing keys keep their defaults.
+ */
+struct PluginSettings {
+	/* Sender collects events for this long before posting them as one batch, 0 sends every event on its own */
+	unsigned int batchWindowMs = 10;
+	/* A batch is posted early once it holds this many events */
+	unsigned int batchMaxEvents = 32;
+	/* Events the normal and low lanes hold (see EventLane), a new event beyond that drops the oldest waiting one */
+	unsigned int laneMaxEvents = 128;
+	/* Server tabs in the background send a serverSummary at most this often instead of their events, 0 sends nothing for them */
+	unsigned int backgroundSummaryMs = 1000;
+	/* Talk stops are held back this long and dropped together with a talk start that follows within it, 0 disables */
+	unsigned int talkStopHoldMs = 0;
+
+	/* http (default), udp, tcp (length framed), unix (length framed, not on Windows) or shm (shared memory ring) */
+	SinkTransport sinkTransport = SinkTransport::http;
+	/* json (default) or msgpack, MessagePack with integer tags for event and field names */
+	PayloadEncoding sinkEncoding = PayloadEncoding::json;
+	/* Aurora's port on localhost for http, udp and tcp */
+	unsigned int sinkPort = 9088;
+	/* Socket file for the unix transport */
+	std::string sinkSocketPath = "/tmp/aurora_gsi.sock";
+	/* Name and ring size of the shared memory segment for the shm transport */
+	std::string sinkShmName = "aurora_gsi";
+	unsigned int sinkShmSizeKB = 1024;
+
+	/* Hard limits for a single request to Aurora */
+	unsigned int sinkConnectTimeoutMs = 250;
+	unsigned int sinkRequestTimeoutMs = 1000;
+	/* Failed requests in a row before events are dropped without trying, and how long to wait between probes */
+	unsigned int breakerFailureThreshold = 3;
+	unsigned int breakerInitialBackoffMs = 500;
+	unsigned int breakerMaxBackoffMs = 30000;
+
+	/* Voice loudness events per second for every talking client, 0 turns the playback audio tap off */
+	unsigned int voiceLevelRateHz = 20;
+	/* Microphone level events per second, 0 turns the capture audio tap off */
+	unsigned int captureLevelRateHz = 30;
+	/* Frequency bands of the playback spectrum (max 32) and spectrum events per second, 0 in either turns the mixed playback tap off */
+	unsigned int spectrumBands = 16;
+	unsigned int spectrumRateHz = 30;
+
+	/* 1 records every hook call into aurora_gsi_hooks_<date>_<time>.bin in the config folder, for replaying with mockHost */
+	unsigned int hookLog = 0;
+	/* 1 records the audio hooks with their samples as well, about 200 KB/s per talking client */
+	unsigned int hookLogAudio = 0;
+	/* Recording stops once the log reaches this size */
+	unsigned int hookLogMaxMB = 256;
+
+	/* events: bit per AuroraEvent that gets sent, everything by default. Hooks of unsubscribed events return right away */
+	uint32_t subscribedEvents = (1u << (unsigned int)AuroraEvent::count) - 1;
+	/* omitFields: bit per EventFieldTag left out of each event type's payload */
+	uint64_t omittedFields[(size_t)AuroraEvent::count] = {};
+
+	/* 1 records spans of the hooks, serialization, queue wait and sink posts into aurora_gsi_trace_<date>_<time>.json
+	 * in the config folder, for chrome://tracing or Perfetto. Written at shutdown */
+	unsigned int trace = 0;
+	/* Spans kept per thread, later ones are dropped. A span takes 32 bytes */
+	unsigned int traceSpansPerThread = 65536;
+};
+
+extern PluginSettings pluginSettings;
+
+/* A single bit test, the first thing the hooks of an event do (events setting) */
+inline bool eventSubscribed(AuroraEvent type) {
+	return (pluginSettings.subscribedEvents >> (unsigned int)type) & 1;
+}
+
+/* Called from ts3plugin_init before the sender starts */
+void loadPluginSettings(const char* configPath);
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+
+/*
+ * Layout of the shared memory transport (sinkTransport = shm), shared by the plugin, which writes,
+ * and the reader library in tools/shmReader. One writer and one reader on the same machine.
+ *
+ * The segment is called sinkShmName: /dev/shm/<name> on Linux, Local\<name> on Windows. It starts with
+ * ShmRingHeader and the ring follows at dataOffset. Positions are byte counts that only ever grow, a record
+ * lives at position % capacity.
+ *
+ * Record: ShmRecordHeader, then the payload, padded to 8 bytes. A record never wraps around the end of the
+ * ring: the writer fills the rest with a padding record (or leaves less than a record header, which the reader
+ * skips as well) and continues at offset 0.
+ *
+ * Wakeup: a reader that found the ring empty sets readerWaiting, looks once more and sleeps on wakeCounter
+ * (a futex on Linux, the auto reset event Local\<name>_wake on Windows). The writer only wakes it while
+ * readerWaiting is set, so a busy reader costs the writer no system calls.
+ */
+
+#define SHM_RING_MAGIC "AGSISHM1"
+#define SHM_RING_VERSION 1
+#define SHM_RING_ALIGNMENT 8
+#define SHM_RING_MIN_CAPACITY (64u << 10)
+
+enum ShmRecordType : uint32_t {
+	SHM_RECORD_PAYLOAD = 0,
+	SHM_RECORD_PADDING = 1
+};
+
+struct ShmRecordHeader {
+	/* Payload bytes, without the padding */
+	uint32_t length;
+	uint32_t type;
+	/* Number of the payload, counting the ones dropped because the ring was full. Gaps mean lost payloads */
+	uint64_t sequence;
+};
+
+struct ShmRingHeader {
+	char magic[8];
+	/* Written last by the writer, a reader ignores the segment until it holds SHM_RING_VERSION */
+	std::atomic<uint32_t> version;
+	uint32_t dataOffset;
+	uint64_t capacity;
+	/* Set when the writer shuts down, the reader then lets go of the segment */
+	std::atomic<uint32_t> writerClosed;
+
+	// Written by the writer
+	alignas(64) std::atomic<uint64_t> writePosition;
+	std::atomic<uint64_t> droppedPayloads;
+	std::atomic<uint32_t> wakeCounter;
+
+	// Written by the reader
+	alignas(64) std::atomic<uint64_t> readPosition;
+	std::atomic<uint32_t> readerWaiting;
+};
+
+inline uint64_t shmRecordSize(size_t payloadLength) {
+	return (sizeof(ShmRecordHeader) + payloadLength + SHM_RING_ALIGNMENT - 1) & ~(uint64_t)(SHM_RING_ALIGNMENT - 1);
+}
+
+inline size_t shmSegmentSize(uint64_t capacity) {
+	return (size_t)((sizeof(ShmRingHeader) + 63) / 64 * 64 + capacity);
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+#include "auroraSink.hpp"
+#include "shmRing.hpp"
+
+/*
+ * Payloads written into a ring in a named shared memory segment, for an Aurora running on the same machine.
+ * No sockets and no copies on the reading side, see shmRing.hpp for the layout and tools/shmReader for a reader.
+ * A full ring drops the payload and counts as a failed post, so a reader that went away trips the breaker.
+ */
+class ShmRingSink : public AuroraSink {
+public:
+	ShmRingSink(const char* name, size_t capacity);
+	~ShmRingSink() override;
+
+	ShmRingSink(const ShmRingSink&) = delete;
+	ShmRingSink& operator=(const ShmRingSink&) = delete;
+
+	bool post(const char* payload, size_t length) override;
+	/* A quarter of the ring, so a batch never waits for the whole ring to drain */
+	size_t maxPayload() const override { return (size_t)(capacity / 4 - sizeof(ShmRecordHeader)); }
+
+private:
+	bool open();
+	void close();
+	void wakeReader();
+
+	std::string name;
+	uint64_t capacity;
+	uint64_t nextSequence;
+	ShmRingHeader* ring;
+	char* data;
+#ifdef _WIN32
+	void* mapping;
+	void* wakeEvent;
+#endif
+};
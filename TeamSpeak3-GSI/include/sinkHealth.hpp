@@ -0,0 +1,44 @@
+#pragma once
+
+#include <chrono>
+
+/*
+ * Circuit breaker in front of a sink.
+ * Closed: every request goes through. After failureThreshold failures in a row the breaker opens.
+ * Open: requests are refused without touching the network until the backoff has passed.
+ * HalfOpen: a single probe request is let through, success closes the breaker again,
+ * failure reopens it with twice the backoff (capped at maxBackoff).
+ * Not thread safe, used by the sender thread only.
+ */
+class SinkHealth {
+public:
+	typedef std::chrono::steady_clock Clock;
+
+	enum State {
+		CLOSED,
+		OPEN,
+		HALF_OPEN
+	};
+
+	SinkHealth(unsigned int failureThreshold, unsigned int initialBackoffMs, unsigned int maxBackoffMs);
+
+	/* Returns false while the breaker is open, the caller then drops the request */
+	bool allowRequest(Clock::time_point now);
+
+	void recordSuccess();
+	void recordFailure(Clock::time_point now);
+
+	State state() const { return currentState; }
+
+private:
+	void open(Clock::time_point now);
+
+	const unsigned int failureThreshold;
+	const std::chrono::milliseconds initialBackoff;
+	const std::chrono::milliseconds maxBackoff;
+
+	State currentState;
+	unsigned int consecutiveFailures;
+	std::chrono::milliseconds backoff;
+	Clock::time_point retryAt;
+};
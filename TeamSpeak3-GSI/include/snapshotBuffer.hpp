@@ -0,0 +1,52 @@
+#pragma once
+
+#include <atomic>
+
+/*
+ * Wait-free hand-over of the latest snapshot from one producer thread to one consumer thread.
+ * A double buffer plus a spare slot: the producer always owns a slot to fill and the consumer always
+ * reads a complete one, neither side ever waits for or retries against the other.
+ * Intermediate snapshots are overwritten, the consumer only ever sees the newest.
+ */
+template <typename T>
+class SnapshotBuffer {
+public:
+	SnapshotBuffer() : shared(0), back(1), front(2) {}
+
+	SnapshotBuffer(const SnapshotBuffer&) = delete;
+	SnapshotBuffer& operator=(const SnapshotBuffer&) = delete;
+
+	/* Producer: slot to fill before publish() */
+	T& writeSlot() { return slots[back]; }
+
+	/* Producer: hands the filled slot over and takes the one the consumer left behind */
+	void publish() {
+		back = shared.exchange(back | FRESH, std::memory_order_acq_rel) & INDEX_MASK;
+	}
+
+	/* Either side: true while the last published snapshot was not read yet */
+	bool hasUnread() const {
+		return (shared.load(std::memory_order_acquire) & FRESH) != 0;
+	}
+
+	/* Consumer: copies the newest snapshot, returns false if nothing was published since the last read */
+	bool read(T& value) {
+		if (!hasUnread()) {
+			return false;
+		}
+		front = shared.exchange(front, std::memory_order_acq_rel) & INDEX_MASK;
+		value = slots[front];
+		return true;
+	}
+
+private:
+	static const unsigned int INDEX_MASK = 3;
+	static const unsigned int FRESH = 4;
+
+	T slots[3];
+	/* Index of the slot between the two sides, FRESH if the producer put it there */
+	alignas(64) std::atomic<unsigned int> shared;
+	// Each touched by one side only
+	alignas(64) unsigned int back;
+	alignas(64) unsigned int front;
+};
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+#include "auroraSink.hpp"
+
+#ifdef _WIN32
+// SOCKET without pulling winsock2.h into every includer
+typedef uintptr_t SinkSocket;
+#else
+typedef int SinkSocket;
+#endif
+
+// Largest UDP payload over IPv4
+#define DATAGRAM_SINK_MAX_PAYLOAD 65507
+
+/*
+ * One UDP datagram per payload to 127.0.0.1:port, no framing and no answer.
+ * The socket is connected, so a closed port comes back as an error on the next send and trips the breaker.
+ */
+class DatagramSink : public AuroraSink {
+public:
+	explicit DatagramSink(unsigned short port);
+	~DatagramSink() override;
+
+	DatagramSink(const DatagramSink&) = delete;
+	DatagramSink& operator=(const DatagramSink&) = delete;
+
+	bool post(const char* payload, size_t length) override;
+	size_t maxPayload() const override { return DATAGRAM_SINK_MAX_PAYLOAD; }
+
+private:
+	bool open();
+	void close();
+
+	unsigned short port;
+	SinkSocket socketHandle;
+};
+
+/*
+ * Payloads over a kept-open stream socket, each prefixed with its length as a 4 byte big endian integer.
+ * Connects to 127.0.0.1:port, or to a Unix domain socket if a path is given (not on Windows).
+ * Nothing is read back, a payload counts as delivered once the kernel took it.
+ */
+class StreamSink : public AuroraSink {
+public:
+	StreamSink(unsigned short port, const char* socketPath, long connectTimeoutMs, long sendTimeoutMs);
+	~StreamSink() override;
+
+	StreamSink(const StreamSink&) = delete;
+	StreamSink& operator=(const StreamSink&) = delete;
+
+	bool post(const char* payload, size_t length) override;
+
+private:
+	bool connectSocket();
+	void close();
+	bool peerClosed();
+	bool sendFrame(const char* payload, size_t length);
+
+	unsigned short port;
+	std::string socketPath;
+	long connectTimeoutMs;
+	long sendTimeoutMs;
+	SinkSocket socketHandle;
+};
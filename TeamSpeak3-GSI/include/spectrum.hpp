@@ -0,0 +1,92 @@
+#pragma once
+
+#include <stddef.h>
+
+#include <atomic>
+#include <vector>
+
+/*
+ * Building blocks of the spectrum analyzer: a ring that carries audio from TeamSpeak's mixer thread to the
+ * analyzer thread, and the analyzer itself (Hann window, real FFT, log spaced bands).
+ * Nothing in here talks to TeamSpeak or Aurora, see spectrumPublisher.hpp for that.
+ */
+
+// TeamSpeak mixes playback at 48 kHz
+#define SPECTRUM_SAMPLE_RATE 48000
+// 21 ms of audio per analysis, 47 Hz per bin
+#define SPECTRUM_FFT_SIZE 1024
+#define SPECTRUM_MAX_BANDS 32
+// 340 ms of mono audio, the analyzer drains it many times over in that time
+#define SPECTRUM_RING_CAPACITY 16384
+
+/*
+ * Single producer, single consumer ring of mono samples. Wait-free on both sides:
+ * the producer drops what does not fit instead of waiting for the consumer.
+ */
+class SampleRing {
+public:
+	SampleRing();
+
+	SampleRing(const SampleRing&) = delete;
+	SampleRing& operator=(const SampleRing&) = delete;
+
+	/* Producer: averages the first two channels of interleaved frames into mono and appends them. Returns frames written */
+	size_t pushFrames(const short* samples, size_t frames, int channels);
+
+	/* Consumer: moves the newest samples (at most maxCount, older ones are skipped) to out as floats in -1..1 */
+	size_t popLatest(float* out, size_t maxCount);
+
+	/* Consumer: forgets everything buffered */
+	void clear();
+
+	unsigned long long droppedFrames() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+	short samples[SPECTRUM_RING_CAPACITY];
+	alignas(64) std::atomic<size_t> writePosition;
+	alignas(64) std::atomic<size_t> readPosition;
+	std::atomic<unsigned long long> dropped;
+};
+
+/*
+ * Spectrum of the last SPECTRUM_FFT_SIZE samples in bandCount log spaced bands between 50 Hz and 16 kHz.
+ * Window, twiddle factors, bit reversal and band edges are computed once in the constructor,
+ * analyze() does not allocate.
+ */
+class SpectrumAnalyzer {
+public:
+	explicit SpectrumAnalyzer(unsigned int bandCount);
+
+	unsigned int bands() const { return bandCount; }
+
+	/* Slides new samples into the analysis window */
+	void addSamples(const float* samples, size_t count);
+
+	/* Writes the level of every band to levels, 0..100 on the same dB scale as the loudness events */
+	void analyze(float* levels);
+
+	/* Power of FFT bins 0..SPECTRUM_FFT_SIZE/2-1 from the last analyze(), unscaled. For checking the FFT */
+	const float* binPower() const { return power.data(); }
+
+	/* Raw real FFT of input (SPECTRUM_FFT_SIZE samples) into power, without window. For checking the FFT */
+	void powerSpectrum(const float* input, float* binPowerOut);
+
+private:
+	void transform(const float* input);
+
+	unsigned int bandCount;
+	std::vector<float> window;
+	std::vector<float> history;
+	// Split complex working buffers of the half size FFT
+	std::vector<float> real;
+	std::vector<float> imaginary;
+	std::vector<float> power;
+	// Twiddles of the half size complex FFT and of the real FFT split step
+	std::vector<float> fftCos;
+	std::vector<float> fftSin;
+	std::vector<float> splitCos;
+	std::vector<float> splitSin;
+	std::vector<unsigned short> bitReverse;
+	std::vector<unsigned short> bandFirstBin;
+	std::vector<unsigned short> bandEndBin;
+};
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <teamspeak/public_definitions.h>
+
+/*
+ * Audio-reactive spectrum of everything we hear, taken from ts3plugin_onEditMixedPlaybackVoiceDataEvent.
+ * The audio thread only copies the mixed frames into a wait-free ring. A worker thread of its own runs the FFT
+ * spectrumRateHz times a second and sends a "spectrum" event with spectrumBands levels whenever one of them changed.
+ * The worker is separate from the sender so a slow Aurora never stalls the analysis.
+ *
+ * Only one connection feeds the ring at a time, the first one playing audio. It gives the ring up after a second of silence.
+ */
+
+/* Audio thread. Never locks or allocates, the samples are only read */
+void recordMixedPlayback(uint64 serverConnectionHandlerID, const short* samples, int sampleCount, int channels);
+
+/* Starts the analyzer thread if spectrumBands and spectrumRateHz are set. Called from ts3plugin_init after the sender started */
+void startSpectrumAnalyzer();
+
+/* Stops and joins the analyzer thread. Called from ts3plugin_shutdown before the sender stops */
+void stopSpectrumAnalyzer();
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+
+/*
+ * Optional tracing of the hot path (trace = 1) in the Chrome trace event format, for chrome://tracing or Perfetto.
+ * Every thread writes its spans into its own buffer without locks, the buffers are written out as
+ * aurora_gsi_trace_<date>_<time>.json in the config folder when the plugin shuts down.
+ *
+ * Spans reuse the timestamps the metrics take anyway (see pluginMetrics.hpp), so while tracing is off
+ * the only cost is the relaxed load and branch of tracing() at each span.
+ */
+
+enum class TraceCategory : uint8_t {
+	hook,
+	serialize,
+	queue,
+	send
+};
+
+extern std::atomic<bool> traceActive;
+
+inline bool tracing() {
+	return traceActive.load(std::memory_order_relaxed);
+}
+
+/* Allocates nothing yet, buffers are created on the first span of each thread. Called from ts3plugin_init */
+void startTraceLog(const char* configPath);
+
+/* Writes the trace file and frees the buffers. Called from ts3plugin_shutdown once no hook or sender runs anymore */
+void stopTraceLog();
+
+/* Names the calling thread's track, name has to be a literal */
+void setTraceThreadName(const char* name);
+
+/* metricsNowNs(), for the spans below */
+uint64_t traceNowNs();
+
+/* Span from startNs to endNs (metricsNowNs) on the calling thread. name has to outlive the trace, e.g. a literal.
+ * count shows as the span's "events" argument if not 0 */
+void traceSpan(TraceCategory category, const char* name, uint64_t startNs, uint64_t endNs, uint32_t count = 0);
+
+/* Span that started on another thread, e.g. an event's wait in the queue. Shown on its own async track */
+void traceAsyncSpan(TraceCategory category, const char* name, uint64_t startNs, uint64_t endNs);
+
+/* Span over the rest of the enclosing block, for code the metrics do not time already (the audio hooks).
+ * Takes the start time only while tracing, the end checks the start it kept */
+class TraceScope {
+public:
+	TraceScope(TraceCategory category, const char* name) : name(name), startNs(tracing() ? traceNowNs() : 0), category(category) {}
+	~TraceScope() {
+		if (startNs) {
+			finish();
+		}
+	}
+
+	TraceScope(const TraceScope&) = delete;
+	TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+	void finish();
+
+	const char* name;
+	uint64_t startNs;
+	TraceCategory category;
+};
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <teamspeak/public_definitions.h>
+
+/*
+ * Per client voice loudness, measured on the playback audio TeamSpeak hands to ts3plugin_onEditPlaybackVoiceDataEvent.
+ * The audio thread only measures a buffer and publishes the result into a lock-free slot of that client.
+ * The sender thread samples the slots voiceLevelRateHz times a second and sends a "voiceLevel" event for every
+ * client whose level changed, decaying to 0 once the client stopped talking.
+ *
+ * Budget on the audio thread is 1 us per 10 ms buffer of 48 kHz stereo (960 samples), tools/audioBench checks it.
+ */
+
+/* Audio thread. Never locks or allocates, the samples are only read */
+void recordVoiceLevel(uint64 serverConnectionHandlerID, anyID clientID, const short* samples, int sampleCount, int channels);
+
+/* Adds the sampling task to the sender if voiceLevelRateHz is set. Called from ts3plugin_init before the sender starts */
+void registerVoiceLevelTask();
+
+/* Frees the slot of a client that left our view, or of every client of a connection */
+void forgetVoiceLevel(uint64 serverConnectionHandlerID, anyID clientID);
+void forgetVoiceLevels(uint64 serverConnectionHandlerID);
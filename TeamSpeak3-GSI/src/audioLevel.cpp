@@ -0,0 +1,246 @@
+#include "audioLevel.hpp"
+
+#ifdef AUDIO_LEVEL_X86
+#include <emmintrin.h>
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#define CLIP_THRESHOLD 32767
+// Clip counts are gathered in 16 bit lanes that each grow by at most one per step, widen them before they overflow
+#define CLIP_FLUSH_STEPS 32767
+
+// MSVC accepts any intrinsic anywhere, GCC and clang need the instruction set enabled per function
+#if defined(AUDIO_LEVEL_X86) && !defined(_MSC_VER)
+#define AUDIO_TARGET_SSE2 __attribute__((target("sse2")))
+#define AUDIO_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define AUDIO_TARGET_SSE2
+#define AUDIO_TARGET_AVX2
+#endif
+
+static inline void accumulateScalar(const short* samples, size_t count, AudioLevel& level) {
+	for (size_t i = 0; i < count; i++) {
+		int sample = samples[i];
+		unsigned int magnitude = (unsigned int)(sample < 0 ? -sample : sample);
+		level.sumSquares += (uint64_t)(sample * sample);
+		if (magnitude > level.peak) {
+			level.peak = magnitude;
+		}
+	}
+}
+
+static inline unsigned int countClippedScalar(const short* samples, size_t count) {
+	unsigned int clipped = 0;
+	for (size_t i = 0; i < count; i++) {
+		if (samples[i] >= CLIP_THRESHOLD || samples[i] <= -CLIP_THRESHOLD) {
+			clipped++;
+		}
+	}
+	return clipped;
+}
+
+/*
+ * Clipping is rare, so the kernels only look for it in a second pass once the peak shows a full scale sample.
+ * Normal buffers pay nothing for the clip count.
+ */
+AudioLevel measureAudioLevelScalar(const short* samples, size_t count) {
+	AudioLevel level = { 0, 0, 0 };
+	accumulateScalar(samples, count, level);
+	if (level.peak >= CLIP_THRESHOLD) {
+		level.clipped = countClippedScalar(samples, count);
+	}
+	return level;
+}
+
+#ifdef AUDIO_LEVEL_X86
+
+/* Folds the lane-wise minimum and maximum into one absolute peak, -32768 stays representable as int */
+static inline unsigned int peakOfLanes(const short* maximum, const short* minimum, size_t lanes) {
+	int peak = 0;
+	for (size_t i = 0; i < lanes; i++) {
+		if (maximum[i] > peak) {
+			peak = maximum[i];
+		}
+		if (-minimum[i] > peak) {
+			peak = -minimum[i];
+		}
+	}
+	return (unsigned int)peak;
+}
+
+AUDIO_TARGET_SSE2 static unsigned int countClippedSSE2(const short* samples, size_t count) {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i ones = _mm_set1_epi16(1);
+	const __m128i clipHigh = _mm_set1_epi16(CLIP_THRESHOLD - 1);
+	const __m128i clipLow = _mm_set1_epi16(-CLIP_THRESHOLD + 1);
+	__m128i clipped = zero;
+
+	size_t i = 0;
+	while (i + 8 <= count) {
+		const size_t steps = (count - i) / 8 < CLIP_FLUSH_STEPS ? (count - i) / 8 : CLIP_FLUSH_STEPS;
+		const size_t end = i + steps * 8;
+		__m128i clippedLanes = zero;
+		for (; i < end; i += 8) {
+			__m128i block = _mm_loadu_si128((const __m128i*)(samples + i));
+			// Compare masks are -1, subtracting them counts
+			__m128i atFullScale = _mm_or_si128(_mm_cmpgt_epi16(block, clipHigh), _mm_cmplt_epi16(block, clipLow));
+			clippedLanes = _mm_sub_epi16(clippedLanes, atFullScale);
+		}
+		clipped = _mm_add_epi32(clipped, _mm_madd_epi16(clippedLanes, ones));
+	}
+
+	alignas(16) unsigned int clippedSums[4];
+	_mm_store_si128((__m128i*)clippedSums, clipped);
+	return clippedSums[0] + clippedSums[1] + clippedSums[2] + clippedSums[3] + countClippedScalar(samples + i, count - i);
+}
+
+AUDIO_TARGET_SSE2 AudioLevel measureAudioLevelSSE2(const short* samples, size_t count) {
+	const __m128i zero = _mm_setzero_si128();
+	__m128i sum = zero;
+	__m128i maximum = zero;
+	__m128i minimum = zero;
+
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m128i block = _mm_loadu_si128((const __m128i*)(samples + i));
+		// Pairs of squares, up to 2^31 which only fits unsigned, so widen with zeros instead of the sign
+		__m128i squares = _mm_madd_epi16(block, block);
+		sum = _mm_add_epi64(sum, _mm_unpacklo_epi32(squares, zero));
+		sum = _mm_add_epi64(sum, _mm_unpackhi_epi32(squares, zero));
+		maximum = _mm_max_epi16(maximum, block);
+		minimum = _mm_min_epi16(minimum, block);
+	}
+
+	alignas(16) uint64_t sumLanes[2];
+	alignas(16) short maximumLanes[8];
+	alignas(16) short minimumLanes[8];
+	_mm_store_si128((__m128i*)sumLanes, sum);
+	_mm_store_si128((__m128i*)maximumLanes, maximum);
+	_mm_store_si128((__m128i*)minimumLanes, minimum);
+
+	AudioLevel level = { sumLanes[0] + sumLanes[1], peakOfLanes(maximumLanes, minimumLanes, 8), 0 };
+	accumulateScalar(samples + i, count - i, level);
+	if (level.peak >= CLIP_THRESHOLD) {
+		level.clipped = countClippedSSE2(samples, count);
+	}
+	return level;
+}
+
+AUDIO_TARGET_AVX2 static unsigned int countClippedAVX2(const short* samples, size_t count) {
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i ones = _mm256_set1_epi16(1);
+	const __m256i clipHigh = _mm256_set1_epi16(CLIP_THRESHOLD - 1);
+	const __m256i clipLow = _mm256_set1_epi16(-CLIP_THRESHOLD + 1);
+	__m256i clipped = zero;
+
+	size_t i = 0;
+	while (i + 16 <= count) {
+		const size_t steps = (count - i) / 16 < CLIP_FLUSH_STEPS ? (count - i) / 16 : CLIP_FLUSH_STEPS;
+		const size_t end = i + steps * 16;
+		__m256i clippedLanes = zero;
+		for (; i < end; i += 16) {
+			__m256i block = _mm256_loadu_si256((const __m256i*)(samples + i));
+			// AVX2 has no signed less-than, (clipLow > block) is the same test
+			__m256i atFullScale = _mm256_or_si256(_mm256_cmpgt_epi16(block, clipHigh), _mm256_cmpgt_epi16(clipLow, block));
+			clippedLanes = _mm256_sub_epi16(clippedLanes, atFullScale);
+		}
+		clipped = _mm256_add_epi32(clipped, _mm256_madd_epi16(clippedLanes, ones));
+	}
+
+	alignas(32) unsigned int clippedSums[8];
+	_mm256_store_si256((__m256i*)clippedSums, clipped);
+	unsigned int total = countClippedScalar(samples + i, count - i);
+	for (unsigned int lane : clippedSums) {
+		total += lane;
+	}
+	return total;
+}
+
+AUDIO_TARGET_AVX2 AudioLevel measureAudioLevelAVX2(const short* samples, size_t count) {
+	const __m256i zero = _mm256_setzero_si256();
+	__m256i sum = zero;
+	__m256i maximum = zero;
+	__m256i minimum = zero;
+
+	size_t i = 0;
+	for (; i + 16 <= count; i += 16) {
+		__m256i block = _mm256_loadu_si256((const __m256i*)(samples + i));
+		__m256i squares = _mm256_madd_epi16(block, block);
+		sum = _mm256_add_epi64(sum, _mm256_unpacklo_epi32(squares, zero));
+		sum = _mm256_add_epi64(sum, _mm256_unpackhi_epi32(squares, zero));
+		maximum = _mm256_max_epi16(maximum, block);
+		minimum = _mm256_min_epi16(minimum, block);
+	}
+
+	alignas(32) uint64_t sumLanes[4];
+	alignas(32) short maximumLanes[16];
+	alignas(32) short minimumLanes[16];
+	_mm256_store_si256((__m256i*)sumLanes, sum);
+	_mm256_store_si256((__m256i*)maximumLanes, maximum);
+	_mm256_store_si256((__m256i*)minimumLanes, minimum);
+
+	AudioLevel level = { sumLanes[0] + sumLanes[1] + sumLanes[2] + sumLanes[3], peakOfLanes(maximumLanes, minimumLanes, 16), 0 };
+	accumulateScalar(samples + i, count - i, level);
+	if (level.peak >= CLIP_THRESHOLD) {
+		level.clipped = countClippedAVX2(samples, count);
+	}
+	return level;
+}
+
+bool audioLevelAVX2Supported() {
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7) {
+		return false;
+	}
+	__cpuid(info, 1);
+	// AVX and OSXSAVE, then ask the OS whether it saves the YMM registers
+	if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0 || (_xgetbv(0) & 6) != 6) {
+		return false;
+	}
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif
+
+struct SelectedKernel {
+	AudioLevelKernel kernel;
+	const char* name;
+
+	SelectedKernel() {
+#ifdef AUDIO_LEVEL_X86
+		if (audioLevelAVX2Supported()) {
+			kernel = measureAudioLevelAVX2;
+			name = "avx2";
+			return;
+		}
+		// Every x64 CPU and every CPU TeamSpeak 3 still runs on has SSE2
+		kernel = measureAudioLevelSSE2;
+		name = "sse2";
+#else
+		kernel = measureAudioLevelScalar;
+		name = "scalar";
+#endif
+	}
+};
+
+static const SelectedKernel& selectedKernel() {
+	static const SelectedKernel selected;
+	return selected;
+}
+
+AudioLevel measureAudioLevel(const short* samples, size_t count) {
+	return selectedKernel().kernel(samples, count);
+}
+
+const char* audioLevelKernelName() {
+	return selectedKernel().name;
+}
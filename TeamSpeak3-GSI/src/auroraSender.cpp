@@ -0,0 +1,479 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "auroraSender.hpp"
+#include "auroraSink.hpp"
+#include "eventQueue.hpp"
+#include "msgPackWriter.hpp"
+#include "pluginMetrics.hpp"
+#include "settings.hpp"
+#include "sinkHealth.hpp"
+
+#define SENDER_QUEUE_CAPACITY 1024
+// One buffer per queue slot, so a hook holding a buffer can always enqueue it
+#define OUTBOUND_BUFFER_COUNT SENDER_QUEUE_CAPACITY
+#define SENDER_IDLE_WAIT_MS 100
+// Upper bound for the batchMaxEvents setting
+#define SENDER_MAX_BATCH 256
+#define SENDER_MAX_TASKS 4
+
+typedef BoundedEventQueue<OutboundBuffer*, SENDER_QUEUE_CAPACITY> SenderQueue;
+
+// One queue per EventLane
+static SenderQueue senderQueues[(size_t)EventLane::count];
+// laneMaxEvents, clamped to the queue capacity
+static size_t laneMaxEvents = SENDER_QUEUE_CAPACITY;
+
+static OutboundBuffer outboundBuffers[OUTBOUND_BUFFER_COUNT];
+static BoundedEventQueue<OutboundBuffer*, OUTBOUND_BUFFER_COUNT> freeBuffers;
+static std::once_flag freeBuffersFilled;
+
+static std::thread senderThread;
+static std::atomic<bool> senderRunning(false);
+static std::atomic<bool> senderSleeping(false);
+static std::mutex senderWakeMutex;
+static std::condition_variable senderWakeCondition;
+
+static std::atomic<unsigned long long> droppedEvents(0);
+
+typedef std::chrono::steady_clock SenderClock;
+
+struct PeriodicTask {
+	SenderTask run;
+	std::chrono::milliseconds period;
+	SenderClock::time_point due;
+};
+
+// Only touched before the sender starts and after it stopped, or by the sender thread itself
+static PeriodicTask senderTasks[SENDER_MAX_TASKS];
+static size_t senderTaskCount = 0;
+
+static void countCoalesced(const OutboundBuffer* buffer) {
+	pluginMetrics.events[(size_t)buffer->type].coalesced.fetch_add(1, std::memory_order_relaxed);
+}
+
+static void countDropped(OutboundBuffer** first, OutboundBuffer** end) {
+	for (OutboundBuffer** event = first; event != end; event++) {
+		pluginMetrics.events[(size_t)(*event)->type].dropped.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+static size_t queuedEvents() {
+	size_t queued = 0;
+	for (const SenderQueue& queue : senderQueues) {
+		queued += queue.sizeApprox();
+	}
+	return queued;
+}
+
+static void wakeSender() {
+	// Only take the lock if the sender is actually parked, so hooks stay lock-free while events are flowing
+	if (senderSleeping.load()) {
+		std::lock_guard<std::mutex> lock(senderWakeMutex);
+		senderSleeping.store(false);
+		senderWakeCondition.notify_one();
+	}
+}
+
+/* Parks the sender until a hook enqueues something, the timeout passes or the sender is stopped */
+static void waitForEvents(std::chrono::steady_clock::duration timeout) {
+	std::unique_lock<std::mutex> lock(senderWakeMutex);
+	senderSleeping.store(true);
+	// Re-check after announcing that we sleep, a producer either sees the flag or we see its event
+	if (queuedEvents() == 0 && senderRunning.load()) {
+		senderWakeCondition.wait_for(lock, timeout, [] {
+			return !senderSleeping.load() || !senderRunning.load();
+		});
+	}
+	senderSleeping.store(false);
+}
+
+/* Runs every task whose time has come, returns when the next one is due */
+static SenderClock::time_point runDueTasks(SenderClock::time_point now, SenderClock::time_point fallback) {
+	SenderClock::time_point next = fallback;
+	for (size_t i = 0; i < senderTaskCount; i++) {
+		PeriodicTask& task = senderTasks[i];
+		if (task.due <= now) {
+			task.run();
+			task.due += task.period;
+			// Skip missed periods after a slow post instead of catching up in a burst
+			if (task.due <= now) {
+				task.due = now + task.period;
+			}
+		}
+		if (task.due < next) {
+			next = task.due;
+		}
+	}
+	return next;
+}
+
+/*
+ * Events the sender has taken off the queue but not posted yet. Owned by the sender thread.
+ * The batch is what goes out with the next POST, held events wait for their holdMs to pass first.
+ */
+struct PendingEvents {
+	OutboundBuffer* batch[SENDER_MAX_BATCH];
+	size_t batchSize = 0;
+	SenderClock::time_point batchStarted;
+
+	/* The batch holds a high lane event and goes out without waiting for the batch window */
+	bool urgent = false;
+
+	OutboundBuffer* held[SENDER_MAX_BATCH];
+	SenderClock::time_point heldUntil[SENDER_MAX_BATCH];
+	size_t heldCount = 0;
+
+	void appendToBatch(OutboundBuffer* buffer, SenderClock::time_point now) {
+		if (batchSize == 0) {
+			batchStarted = now;
+		}
+		batch[batchSize++] = buffer;
+		if (eventLane(buffer->type) == EventLane::high) {
+			urgent = true;
+		}
+	}
+
+	/* Latest wins: drops an older batched event with the same key, returns true if there was one */
+	bool dropSuperseded(uint64_t coalesceKey) {
+		for (size_t i = 0; i < batchSize; i++) {
+			if (batch[i]->coalesceKey == coalesceKey) {
+				countCoalesced(batch[i]);
+				releaseOutboundBuffer(batch[i]);
+				memmove(&batch[i], &batch[i + 1], (batchSize - i - 1) * sizeof(batch[0]));
+				batchSize--;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/* Returns true if a held event had the same key, it is released together with the caller's event */
+	bool cancelHeld(uint64_t coalesceKey) {
+		for (size_t i = 0; i < heldCount; i++) {
+			if (held[i]->coalesceKey == coalesceKey) {
+				countCoalesced(held[i]);
+				releaseOutboundBuffer(held[i]);
+				heldCount--;
+				held[i] = held[heldCount];
+				heldUntil[i] = heldUntil[heldCount];
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void accept(OutboundBuffer* buffer, SenderClock::time_point now) {
+		bool superseded = false;
+		if (buffer->coalesceKey) {
+			if (cancelHeld(buffer->coalesceKey)) {
+				// e.g. talk stop followed by talk start within the hold time, Aurora never saw the stop
+				countCoalesced(buffer);
+				releaseOutboundBuffer(buffer);
+				return;
+			}
+			superseded = dropSuperseded(buffer->coalesceKey);
+		}
+		// Only hold back an event if Aurora already saw the state it reverts, otherwise a later flap would cancel it
+		if (buffer->holdMs && !superseded && heldCount < SENDER_MAX_BATCH) {
+			held[heldCount] = buffer;
+			heldUntil[heldCount] = now + std::chrono::milliseconds(buffer->holdMs);
+			heldCount++;
+			return;
+		}
+		appendToBatch(buffer, now);
+	}
+
+	/* Moves held events whose time has come into the batch */
+	void releaseDue(SenderClock::time_point now, size_t batchMaxEvents) {
+		for (size_t i = 0; i < heldCount && batchSize < batchMaxEvents;) {
+			if (heldUntil[i] <= now) {
+				appendToBatch(held[i], now);
+				heldCount--;
+				held[i] = held[heldCount];
+				heldUntil[i] = heldUntil[heldCount];
+			}
+			else {
+				i++;
+			}
+		}
+	}
+
+	SenderClock::time_point nextRelease(SenderClock::time_point fallback) const {
+		SenderClock::time_point next = fallback;
+		for (size_t i = 0; i < heldCount; i++) {
+			if (heldUntil[i] < next) {
+				next = heldUntil[i];
+			}
+		}
+		return next;
+	}
+
+	void releaseAll() {
+		for (size_t i = 0; i < batchSize; i++) {
+			releaseOutboundBuffer(batch[i]);
+		}
+		for (size_t i = 0; i < heldCount; i++) {
+			releaseOutboundBuffer(held[i]);
+		}
+		batchSize = 0;
+		heldCount = 0;
+	}
+};
+
+/* Posts events [first, end) of the batch, more than one goes out as a JSON or MessagePack array */
+static void postEvents(AuroraSink& sink, SinkHealth& health, OutboundBuffer** first, OutboundBuffer** end, rapidjson::StringBuffer& batchPayload, SenderClock::time_point now) {
+	PluginMetrics& metrics = pluginMetrics;
+	const uint64_t postNs = metricsNowNs();
+	const bool traced = tracing();
+	for (OutboundBuffer** event = first; event != end; event++) {
+		metrics.queueWait[(size_t)eventLane((*event)->type)].record(postNs - (*event)->enqueuedNs);
+		if (traced) {
+			traceAsyncSpan(TraceCategory::queue, auroraEventName((*event)->type), (*event)->enqueuedNs, postNs);
+		}
+	}
+
+	bool delivered;
+	size_t payloadSize;
+	if (end - first == 1) {
+		payloadSize = (*first)->payload.GetSize();
+		delivered = sink.post((*first)->payload.GetString(), payloadSize);
+	}
+	else {
+		const bool msgPack = pluginSettings.sinkEncoding == PayloadEncoding::msgPack;
+		batchPayload.Clear();
+		if (msgPack) {
+			writeMsgPackArrayHeader(batchPayload, (size_t)(end - first));
+		}
+		else {
+			batchPayload.Put('[');
+		}
+		for (OutboundBuffer** event = first; event != end; event++) {
+			if (event != first && !msgPack) {
+				batchPayload.Put(',');
+			}
+			memcpy(batchPayload.Push((*event)->payload.GetSize()), (*event)->payload.GetString(), (*event)->payload.GetSize());
+		}
+		if (!msgPack) {
+			batchPayload.Put(']');
+		}
+		payloadSize = batchPayload.GetSize();
+		delivered = sink.post(batchPayload.GetString(), payloadSize);
+	}
+	const uint64_t sentNs = metricsNowNs();
+	metrics.send.record(sentNs - postNs);
+	if (traced) {
+		traceSpan(TraceCategory::send, delivered ? "post" : "post failed", postNs, sentNs, (uint32_t)(end - first));
+	}
+	metrics.sinkRequests.fetch_add(1, std::memory_order_relaxed);
+
+	if (delivered) {
+		health.recordSuccess();
+		metrics.sinkBytes.fetch_add(payloadSize, std::memory_order_relaxed);
+		for (OutboundBuffer** event = first; event != end; event++) {
+			metrics.events[(size_t)(*event)->type].sent.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+	else {
+		health.recordFailure(now);
+		metrics.sinkErrors.fetch_add(1, std::memory_order_relaxed);
+		countDropped(first, end);
+	}
+}
+
+/* Posts the batch and hands its buffers back to the pool. Splits it where the sink's payload limit requires */
+static void flushBatch(AuroraSink& sink, SinkHealth& health, PendingEvents& pending, rapidjson::StringBuffer& batchPayload) {
+	OutboundBuffer** batch = pending.batch;
+	const size_t count = pending.batchSize;
+	const SenderClock::time_point now = SenderClock::now();
+	const size_t maxPayload = sink.maxPayload();
+
+	// Brackets of the JSON array, or at most the 5 byte MessagePack array header
+	const size_t arrayOverhead = pluginSettings.sinkEncoding == PayloadEncoding::msgPack ? 5 : 2;
+	size_t first = 0;
+	size_t payloadSize = arrayOverhead;
+	for (size_t i = 0; i <= count; i++) {
+		// Event plus its separating comma
+		const size_t eventSize = i < count ? batch[i]->payload.GetSize() + 1 : 0;
+		if (i == count || (i > first && payloadSize + eventSize > maxPayload)) {
+			// Asked per chunk, so a half open breaker lets a single probe through and a failed chunk stops the rest
+			if (!health.allowRequest(now)) {
+				// Aurora is down, dropping costs nothing compared to another refused connection
+				droppedEvents.fetch_add(count - first, std::memory_order_relaxed);
+				countDropped(batch + first, batch + count);
+				break;
+			}
+			postEvents(sink, health, batch + first, batch + i, batchPayload, now);
+			first = i;
+			payloadSize = arrayOverhead;
+		}
+		payloadSize += eventSize;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		releaseOutboundBuffer(batch[i]);
+	}
+	pending.batchSize = 0;
+	pending.urgent = false;
+}
+
+static void senderLoop() {
+	setTraceThreadName("Aurora sender");
+	// The sink lives on this thread for its whole lifetime so the connection stays open between events
+	std::unique_ptr<AuroraSink> sink = createAuroraSink();
+	SinkHealth health(pluginSettings.breakerFailureThreshold, pluginSettings.breakerInitialBackoffMs, pluginSettings.breakerMaxBackoffMs);
+	// Reused for every multi-event payload, keeps its capacity like the pooled buffers
+	rapidjson::StringBuffer batchPayload;
+	PendingEvents pending;
+
+	const std::chrono::milliseconds batchWindow(pluginSettings.batchWindowMs);
+	size_t batchMaxEvents = pluginSettings.batchMaxEvents;
+	// Without a window every flush takes a single event, so it is posted bare instead of as an array
+	if (batchMaxEvents < 1 || pluginSettings.batchWindowMs == 0) {
+		batchMaxEvents = 1;
+	}
+	else if (batchMaxEvents > SENDER_MAX_BATCH) {
+		batchMaxEvents = SENDER_MAX_BATCH;
+	}
+
+	while (senderRunning.load()) {
+		SenderClock::time_point now = SenderClock::now();
+		const SenderClock::time_point nextTask = runDueTasks(now, now + std::chrono::milliseconds(SENDER_IDLE_WAIT_MS));
+
+		const uint64_t queueDepth = queuedEvents();
+		pluginMetrics.queueDepth.store(queueDepth, std::memory_order_relaxed);
+		if (queueDepth > pluginMetrics.queueDepthPeak.load(std::memory_order_relaxed)) {
+			pluginMetrics.queueDepthPeak.store(queueDepth, std::memory_order_relaxed);
+		}
+
+		// Lanes in order, a backed up low lane only gets what room the others leave in the batch
+		for (SenderQueue& queue : senderQueues) {
+			OutboundBuffer* buffer;
+			while (pending.batchSize < batchMaxEvents && queue.tryPop(buffer)) {
+				pending.accept(buffer, now);
+			}
+		}
+		pending.releaseDue(now, batchMaxEvents);
+
+		if (pending.batchSize == 0) {
+			waitForEvents(pending.nextRelease(nextTask) - now);
+			continue;
+		}
+
+		// The window starts with the first event, so no event waits longer than batchWindowMs
+		const SenderClock::time_point deadline = pending.batchStarted + batchWindow;
+		if (pending.batchSize < batchMaxEvents && now < deadline && !pending.urgent) {
+			waitForEvents(pending.nextRelease(std::min(deadline, nextTask)) - now);
+			continue;
+		}
+
+		flushBatch(*sink, health, pending, batchPayload);
+		pluginMetrics.breakerState.store(health.state(), std::memory_order_relaxed);
+	}
+
+	pending.releaseAll();
+}
+
+void startAuroraSender() {
+	if (senderRunning.exchange(true)) {
+		return;
+	}
+	std::call_once(freeBuffersFilled, [] {
+		for (size_t i = 0; i < OUTBOUND_BUFFER_COUNT; i++) {
+			OutboundBuffer* buffer = &outboundBuffers[i];
+			freeBuffers.tryPush(std::move(buffer));
+		}
+	});
+	laneMaxEvents = std::min<size_t>(std::max<size_t>(pluginSettings.laneMaxEvents, 1), SENDER_QUEUE_CAPACITY);
+	const SenderClock::time_point now = SenderClock::now();
+	for (size_t i = 0; i < senderTaskCount; i++) {
+		senderTasks[i].due = now + senderTasks[i].period;
+	}
+	senderThread = std::thread(senderLoop);
+}
+
+void stopAuroraSender() {
+	if (!senderRunning.exchange(false)) {
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(senderWakeMutex);
+		senderWakeCondition.notify_one();
+	}
+	if (senderThread.joinable()) {
+		senderThread.join();
+	}
+
+	for (SenderQueue& queue : senderQueues) {
+		OutboundBuffer* buffer;
+		while (queue.tryPop(buffer)) {
+			releaseOutboundBuffer(buffer);
+		}
+	}
+	senderTaskCount = 0;
+
+	unsigned long long dropped = droppedEvents.exchange(0);
+	if (dropped) {
+		printf("PLUGIN: %llu events dropped (queue full or Aurora unreachable)\n", dropped);
+	}
+}
+
+bool addSenderTask(SenderTask task, unsigned int periodMs) {
+	if (senderRunning.load() || senderTaskCount == SENDER_MAX_TASKS || periodMs == 0) {
+		return false;
+	}
+	senderTasks[senderTaskCount++] = PeriodicTask{ task, std::chrono::milliseconds(periodMs), SenderClock::time_point() };
+	return true;
+}
+
+OutboundBuffer* acquireOutboundBuffer() {
+	OutboundBuffer* buffer;
+	if (!freeBuffers.tryPop(buffer)) {
+		droppedEvents.fetch_add(1, std::memory_order_relaxed);
+		return nullptr;
+	}
+	return buffer;
+}
+
+void releaseOutboundBuffer(OutboundBuffer* buffer) {
+	// Clear() keeps the allocated capacity, so a recycled buffer does not allocate again
+	buffer->payload.Clear();
+	buffer->coalesceKey = 0;
+	buffer->holdMs = 0;
+	freeBuffers.tryPush(std::move(buffer));
+}
+
+bool enqueueBuffer_for_Aurora(OutboundBuffer* buffer) {
+	if (!senderRunning.load(std::memory_order_relaxed)) {
+		droppedEvents.fetch_add(1, std::memory_order_relaxed);
+		releaseOutboundBuffer(buffer);
+		return false;
+	}
+
+	const EventLane lane = eventLane(buffer->type);
+	SenderQueue& queue = senderQueues[(size_t)lane];
+	if (lane != EventLane::high) {
+		// Backed up bulk lanes keep the newest events, and leave the buffers to the high lane
+		OutboundBuffer* oldest;
+		while (queue.sizeApprox() >= laneMaxEvents && queue.tryPop(oldest)) {
+			droppedEvents.fetch_add(1, std::memory_order_relaxed);
+			countDropped(&oldest, &oldest + 1);
+			releaseOutboundBuffer(oldest);
+		}
+	}
+	if (!queue.tryPush(std::move(buffer))) {
+		droppedEvents.fetch_add(1, std::memory_order_relaxed);
+		releaseOutboundBuffer(buffer);
+		return false;
+	}
+	wakeSender();
+	return true;
+}
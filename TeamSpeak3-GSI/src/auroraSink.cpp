@@ -0,0 +1,41 @@
+#include <stdio.h>
+
+#include "auroraSink.hpp"
+#include "httpSink.hpp"
+#include "shmSink.hpp"
+#include "socketSink.hpp"
+#include "settings.hpp"
+
+std::unique_ptr<AuroraSink> createAuroraSink() {
+	const unsigned short port = (unsigned short)pluginSettings.sinkPort;
+	const long connectTimeoutMs = (long)pluginSettings.sinkConnectTimeoutMs;
+	const long requestTimeoutMs = (long)pluginSettings.sinkRequestTimeoutMs;
+
+	switch (pluginSettings.sinkTransport) {
+	case SinkTransport::udp:
+		printf("PLUGIN: sending to Aurora over udp port %u\n", port);
+		return std::unique_ptr<AuroraSink>(new DatagramSink(port));
+	case SinkTransport::tcp:
+		printf("PLUGIN: sending to Aurora over tcp port %u\n", port);
+		return std::unique_ptr<AuroraSink>(new StreamSink(port, nullptr, connectTimeoutMs, requestTimeoutMs));
+	case SinkTransport::unixSocket:
+#ifdef _WIN32
+		printf("PLUGIN: unix sockets are not supported on Windows, sending over tcp port %u instead\n", port);
+		return std::unique_ptr<AuroraSink>(new StreamSink(port, nullptr, connectTimeoutMs, requestTimeoutMs));
+#else
+		printf("PLUGIN: sending to Aurora over %s\n", pluginSettings.sinkSocketPath.c_str());
+		return std::unique_ptr<AuroraSink>(new StreamSink(port, pluginSettings.sinkSocketPath.c_str(), connectTimeoutMs, requestTimeoutMs));
+#endif
+	case SinkTransport::shm:
+		printf("PLUGIN: sending to Aurora through shared memory %s\n", pluginSettings.sinkShmName.c_str());
+		return std::unique_ptr<AuroraSink>(new ShmRingSink(pluginSettings.sinkShmName.c_str(), (size_t)pluginSettings.sinkShmSizeKB << 10));
+	case SinkTransport::http:
+	default:
+		break;
+	}
+
+	char url[SINK_URL_BUFSIZE];
+	snprintf(url, sizeof(url), "http://localhost:%u", port);
+	const char* contentType = pluginSettings.sinkEncoding == PayloadEncoding::msgPack ? "application/msgpack" : "application/json";
+	return std::unique_ptr<AuroraSink>(new HttpSink(url, contentType, connectTimeoutMs, requestTimeoutMs));
+}
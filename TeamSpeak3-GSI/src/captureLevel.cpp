@@ -0,0 +1,99 @@
+#include <stddef.h>
+
+#include "eventHooks.hpp"
+#include "audioLevel.hpp"
+#include "captureLevel.hpp"
+#include "snapshotBuffer.hpp"
+#include "settings.hpp"
+
+// Aurora renders at most this many frames per second, faster updates would never be seen
+#define CAPTURE_LEVEL_MAX_RATE_HZ 60
+// Points of the 0..100 scale the reported level falls per second once the microphone got quieter
+#define CAPTURE_LEVEL_RELEASE_PER_SECOND 150.0f
+
+struct CaptureSnapshot {
+	uint64 serverConnectionHandlerID;
+	/* Loudest buffer since the sender's last read, linear 0..1 */
+	float rms;
+	float peak;
+	/* Clipped samples since the plugin started, the sender sends the difference */
+	unsigned long long clippedTotal;
+};
+
+static SnapshotBuffer<CaptureSnapshot> captureSnapshots;
+
+// Capture thread only
+static CaptureSnapshot captureAccumulator;
+
+// Sender thread only
+static float captureLoudness = 0.0f;
+static float capturePeak = 0.0f;
+static unsigned int sentLoudness = 0;
+static unsigned int sentPeak = 0;
+static unsigned long long sentClippedTotal = 0;
+
+static unsigned int captureLevelRateHz() {
+	unsigned int rateHz = pluginSettings.captureLevelRateHz;
+	return rateHz > CAPTURE_LEVEL_MAX_RATE_HZ ? CAPTURE_LEVEL_MAX_RATE_HZ : rateHz;
+}
+
+void recordCaptureLevel(uint64 serverConnectionHandlerID, const short* samples, int sampleCount, int channels) {
+	if (sampleCount <= 0 || channels <= 0) {
+		return;
+	}
+	const size_t count = (size_t)sampleCount * (size_t)channels;
+	const AudioLevel level = measureAudioLevel(samples, count);
+	const float rms = audioLevelRms(level, count);
+	const float peak = audioLevelPeak(level);
+
+	// Start over once the sender took the last snapshot, otherwise keep the loudest buffer since then
+	if (!captureSnapshots.hasUnread()) {
+		captureAccumulator.rms = 0.0f;
+		captureAccumulator.peak = 0.0f;
+	}
+	captureAccumulator.serverConnectionHandlerID = serverConnectionHandlerID;
+	captureAccumulator.rms = rms > captureAccumulator.rms ? rms : captureAccumulator.rms;
+	captureAccumulator.peak = peak > captureAccumulator.peak ? peak : captureAccumulator.peak;
+	captureAccumulator.clippedTotal += level.clipped;
+
+	captureSnapshots.writeSlot() = captureAccumulator;
+	captureSnapshots.publish();
+}
+
+static void publishCaptureLevel() {
+	const float release = CAPTURE_LEVEL_RELEASE_PER_SECOND / captureLevelRateHz();
+	static CaptureSnapshot snapshot = {};
+
+	// Nothing new means the microphone is closed, let the level fall
+	float loudness = 0.0f;
+	float peak = 0.0f;
+	if (captureSnapshots.read(snapshot)) {
+		loudness = audioLoudnessScale(snapshot.rms);
+		peak = audioLoudnessScale(snapshot.peak);
+	}
+	captureLoudness = loudness > captureLoudness - release ? loudness : captureLoudness - release;
+	capturePeak = peak > capturePeak - release ? peak : capturePeak - release;
+
+	unsigned int roundedLoudness = captureLoudness > 0.0f ? (unsigned int)(captureLoudness + 0.5f) : 0;
+	unsigned int roundedPeak = capturePeak > 0.0f ? (unsigned int)(capturePeak + 0.5f) : 0;
+	unsigned int clipped = (unsigned int)(snapshot.clippedTotal - sentClippedTotal);
+	if (roundedLoudness == sentLoudness && roundedPeak == sentPeak && clipped == 0) {
+		return;
+	}
+	sentLoudness = roundedLoudness;
+	sentPeak = roundedPeak;
+	sentClippedTotal = snapshot.clippedTotal;
+
+	uint64 serverConnectionHandlerID = snapshot.serverConnectionHandlerID;
+	SEND_LATEST_EVENT_TO_AURORA(latestOnly(AuroraEvent::captureLevel, serverConnectionHandlerID, 0), captureLevel,
+		EVENT_FIELD(serverConnectionHandlerID),
+		NAMED_EVENT_FIELD(loudness, roundedLoudness),
+		NAMED_EVENT_FIELD(peak, roundedPeak),
+		EVENT_FIELD(clipped));
+}
+
+void registerCaptureLevelTask() {
+	if (captureLevelRateHz()) {
+		addSenderTask(publishCaptureLevel, 1000 / captureLevelRateHz());
+	}
+}
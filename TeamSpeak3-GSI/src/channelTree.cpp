@@ -0,0 +1,254 @@
+#include "channelTree.hpp"
+
+void ChannelTree::clear() {
+	channelIndices.clear();
+	freeChannels.clear();
+	channelIDs.clear();
+	channelParents.clear();
+	channelRoots.clear();
+	channelChildren.clear();
+	channelTalkers.clear();
+	channelMembers.clear();
+	clientIndices.clear();
+	freeClients.clear();
+	clientIDs.clear();
+	clientChannels.clear();
+	clientSlots.clear();
+	talkerBits.clear();
+	clientsInUse = 0;
+	talkersInUse = 0;
+}
+
+void ChannelTree::build(const uint64* ids, const uint64* parentIDs, size_t count) {
+	clear();
+	channelIndices.reserve(count);
+	channelIDs.assign(ids, ids + count);
+	channelParents.assign(count, noTreeIndex);
+	channelRoots.resize(count);
+	channelChildren.assign(count, 0);
+	channelTalkers.assign(count, 0);
+	channelMembers.resize(count);
+	for (size_t i = 0; i < count; i++) {
+		channelIndices[ids[i]] = (TreeIndex)i;
+	}
+	// Parents may come after their children in the list, so resolve them once all channels are known
+	for (size_t i = 0; i < count; i++) {
+		const TreeIndex parent = findChannel(parentIDs[i]);
+		if (parent != noTreeIndex) {
+			channelParents[i] = parent;
+			channelChildren[parent]++;
+		}
+	}
+	refreshRoots();
+}
+
+TreeIndex ChannelTree::findChannel(uint64 id) const {
+	auto channel = channelIndices.find(id);
+	return channel != channelIndices.end() ? channel->second : noTreeIndex;
+}
+
+TreeIndex ChannelTree::addChannel(uint64 id, uint64 parentID) {
+	TreeIndex channel = findChannel(id);
+	if (channel != noTreeIndex) {
+		moveChannel(id, parentID);
+		return channel;
+	}
+
+	if (!freeChannels.empty()) {
+		channel = freeChannels.back();
+		freeChannels.pop_back();
+	}
+	else {
+		channel = (TreeIndex)channelIDs.size();
+		channelIDs.push_back(0);
+		channelParents.push_back(noTreeIndex);
+		channelRoots.push_back(noTreeIndex);
+		channelChildren.push_back(0);
+		channelTalkers.push_back(0);
+		channelMembers.emplace_back();
+	}
+	channelIndices[id] = channel;
+
+	const TreeIndex parent = findChannel(parentID);
+	channelIDs[channel] = id;
+	channelParents[channel] = parent;
+	channelRoots[channel] = parent != noTreeIndex ? channelRoots[parent] : channel;
+	channelChildren[channel] = 0;
+	channelTalkers[channel] = 0;
+	if (parent != noTreeIndex) {
+		channelChildren[parent]++;
+	}
+	return channel;
+}
+
+bool ChannelTree::removeChannel(uint64 id) {
+	const TreeIndex channel = findChannel(id);
+	if (channel == noTreeIndex) {
+		return false;
+	}
+
+	while (!channelMembers[channel].empty()) {
+		removeClient(channelMembers[channel].back());
+	}
+	if (channelParents[channel] != noTreeIndex) {
+		channelChildren[channelParents[channel]]--;
+	}
+	channelIndices.erase(id);
+	channelIDs[channel] = 0;
+	channelParents[channel] = noTreeIndex;
+	channelRoots[channel] = noTreeIndex;
+	freeChannels.push_back(channel);
+
+	// TeamSpeak deletes subchannels first, this only happens if a delete event went missing
+	if (channelChildren[channel]) {
+		for (TreeIndex& parent : channelParents) {
+			if (parent == channel) {
+				parent = noTreeIndex;
+			}
+		}
+		channelChildren[channel] = 0;
+		refreshRoots();
+	}
+	return true;
+}
+
+bool ChannelTree::moveChannel(uint64 id, uint64 parentID) {
+	const TreeIndex channel = findChannel(id);
+	if (channel == noTreeIndex) {
+		return false;
+	}
+
+	TreeIndex parent = findChannel(parentID);
+	// A channel cannot move below itself, keep the tree acyclic whatever the events say
+	if (parent != noTreeIndex && inSubtree(parent, channel)) {
+		parent = noTreeIndex;
+	}
+	if (parent == channelParents[channel]) {
+		return false;
+	}
+	if (channelParents[channel] != noTreeIndex) {
+		channelChildren[channelParents[channel]]--;
+	}
+	if (parent != noTreeIndex) {
+		channelChildren[parent]++;
+	}
+	channelParents[channel] = parent;
+
+	const TreeIndex root = parent != noTreeIndex ? channelRoots[parent] : channel;
+	if (root != channelRoots[channel]) {
+		if (channelChildren[channel]) {
+			refreshRoots();
+		}
+		else {
+			channelRoots[channel] = root;
+		}
+	}
+	return true;
+}
+
+bool ChannelTree::inSubtree(TreeIndex channel, TreeIndex ancestor) const {
+	while (channel != noTreeIndex) {
+		if (channel == ancestor) {
+			return true;
+		}
+		channel = channelParents[channel];
+	}
+	return false;
+}
+
+/* Walks every channel up to its top level channel, only when a channel with subchannels moves or the tree is built */
+void ChannelTree::refreshRoots() {
+	for (size_t i = 0; i < channelIDs.size(); i++) {
+		if (!channelIDs[i]) {
+			continue;
+		}
+		TreeIndex root = (TreeIndex)i;
+		while (channelParents[root] != noTreeIndex) {
+			root = channelParents[root];
+		}
+		channelRoots[i] = root;
+	}
+}
+
+TreeIndex ChannelTree::moveClient(anyID id, uint64 channelID) {
+	TreeIndex client = findClient(id);
+	const TreeIndex channel = channelID ? findChannel(channelID) : noTreeIndex;
+	if (channel == noTreeIndex) {
+		if (client != noTreeIndex) {
+			removeClient(client);
+		}
+		return noTreeIndex;
+	}
+
+	if (client == noTreeIndex) {
+		if (!freeClients.empty()) {
+			client = freeClients.back();
+			freeClients.pop_back();
+		}
+		else {
+			client = (TreeIndex)clientIDs.size();
+			clientIDs.push_back(0);
+			clientChannels.push_back(noTreeIndex);
+			clientSlots.push_back(0);
+			if (client % 64 == 0) {
+				talkerBits.push_back(0);
+			}
+		}
+		if (id >= clientIndices.size()) {
+			clientIndices.resize((size_t)id + 1, noTreeIndex);
+		}
+		clientIndices[id] = client;
+		clientIDs[client] = id;
+		clientsInUse++;
+	}
+	else if (clientChannels[client] == channel) {
+		return client;
+	}
+	else {
+		// Swap the last member into the client's slot
+		std::vector<TreeIndex>& previous = channelMembers[clientChannels[client]];
+		const TreeIndex last = previous.back();
+		previous[clientSlots[client]] = last;
+		clientSlots[last] = clientSlots[client];
+		previous.pop_back();
+		if (talking(client)) {
+			channelTalkers[clientChannels[client]]--;
+			channelTalkers[channel]++;
+		}
+	}
+
+	clientChannels[client] = channel;
+	clientSlots[client] = (TreeIndex)channelMembers[channel].size();
+	channelMembers[channel].push_back(client);
+	return client;
+}
+
+void ChannelTree::removeClient(TreeIndex client) {
+	setTalking(client, false);
+	std::vector<TreeIndex>& members = channelMembers[clientChannels[client]];
+	const TreeIndex last = members.back();
+	members[clientSlots[client]] = last;
+	clientSlots[last] = clientSlots[client];
+	members.pop_back();
+
+	clientIndices[clientIDs[client]] = noTreeIndex;
+	clientChannels[client] = noTreeIndex;
+	freeClients.push_back(client);
+	clientsInUse--;
+}
+
+bool ChannelTree::setTalking(TreeIndex client, bool isTalking) {
+	if (talking(client) == isTalking) {
+		return false;
+	}
+	talkerBits[client / 64] ^= (uint64_t)1 << (client % 64);
+	if (isTalking) {
+		channelTalkers[clientChannels[client]]++;
+		talkersInUse++;
+	}
+	else {
+		channelTalkers[clientChannels[client]]--;
+		talkersInUse--;
+	}
+	return true;
+}
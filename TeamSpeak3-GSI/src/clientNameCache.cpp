@@ -0,0 +1,84 @@
+#include <stddef.h>
+#include <string.h>
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include <teamspeak/public_errors.h>
+#include <teamspeak/public_definitions.h>
+#include <ts3_functions.h>
+
+#include "eventHooks.hpp"
+#include "clientNameCache.hpp"
+
+static std::mutex cacheMutex;
+static std::unordered_map<uint64, std::string> cachedNames;
+
+static inline uint64 cacheKey(uint64 serverConnectionHandlerID, anyID clientID) {
+	return (serverConnectionHandlerID << 16) | clientID;
+}
+
+static void copyName(const std::string& cached, char* name, size_t size) {
+	const size_t length = cached.size() < size ? cached.size() : size - 1;
+	memcpy(name, cached.data(), length);
+	name[length] = '\0';
+}
+
+bool getCachedClientDisplayName(uint64 serverConnectionHandlerID, anyID clientID, char* name, size_t size) {
+	if (!size) {
+		return false;
+	}
+	const uint64 key = cacheKey(serverConnectionHandlerID, clientID);
+	{
+		std::lock_guard<std::mutex> lock(cacheMutex);
+		auto cached = cachedNames.find(key);
+		if (cached != cachedNames.end()) {
+			copyName(cached->second, name, size);
+			return true;
+		}
+	}
+
+	// Miss, ask the client library outside the lock
+	char fetched[DISPLAY_NAME_BUFSIZE];
+	if (ts3Functions.getClientDisplayName(serverConnectionHandlerID, clientID, fetched, DISPLAY_NAME_BUFSIZE) != ERROR_ok) {
+		return false;
+	}
+
+	// A rename stored meanwhile is newer than what we fetched, keep it
+	std::lock_guard<std::mutex> lock(cacheMutex);
+	copyName(cachedNames.emplace(key, fetched).first->second, name, size);
+	return true;
+}
+
+void updateCachedClientDisplayName(uint64 serverConnectionHandlerID, anyID clientID, const char* displayName) {
+	if (!displayName) {
+		invalidateCachedClientDisplayName(serverConnectionHandlerID, clientID);
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(cacheMutex);
+	cachedNames[cacheKey(serverConnectionHandlerID, clientID)] = displayName;
+}
+
+void invalidateCachedClientDisplayName(uint64 serverConnectionHandlerID, anyID clientID) {
+	std::lock_guard<std::mutex> lock(cacheMutex);
+	cachedNames.erase(cacheKey(serverConnectionHandlerID, clientID));
+}
+
+void clearCachedClientDisplayNames(uint64 serverConnectionHandlerID) {
+	std::lock_guard<std::mutex> lock(cacheMutex);
+	for (auto entry = cachedNames.begin(); entry != cachedNames.end();) {
+		if ((entry->first >> 16) == serverConnectionHandlerID) {
+			entry = cachedNames.erase(entry);
+		}
+		else {
+			++entry;
+		}
+	}
+}
+
+void releaseClientDisplayNameCache() {
+	std::lock_guard<std::mutex> lock(cacheMutex);
+	cachedNames.clear();
+}
@@ -1,5 +1,4 @@
-#include <rapidjson/document.h>
-#include <rapidjson/pointer.h>
+#include <stddef.h>
 
 #include <teamspeak/public_errors.h>
 #include <teamspeak/public_errors_rare.h>
@@ -10,129 +9,376 @@
 
 #include "plugin_exports.hpp"
 #include "eventHooks.hpp"
+#include "serverState.hpp"
+#include "clientNameCache.hpp"
+#include "voiceLevel.hpp"
+#include "captureLevel.hpp"
+#include "spectrumPublisher.hpp"
+#include "hookLog.hpp"
+#include "settings.hpp"
 
-#define PREPARE_JSON_FOR_AURORA(x) \
-rapidjson::Pointer("/provider/name").Set(x, "TeamSpeak"); \
-rapidjson::Pointer("/provider/appid").Set(x, -1);
+/* The mirror of the channel tree feeds both the focused connection's snapshots and the summaries of the others */
+static bool trackingServerState() {
+	return eventSubscribed(AuroraEvent::serverState) || eventSubscribed(AuroraEvent::serverSummary);
+}
 
-#define JSON_ADD_VAL(documentName,subName,valName) rapidjson::Pointer("/data/"#subName"/"#valName).Set(documentName, valName);
+/* Shared by every hook that moves a client, including joins (oldChannelID 0) and leaves (newChannelID 0) */
+static void onClientMoved(uint64 serverConnectionHandlerID, anyID clientID, uint64 oldChannelID, uint64 newChannelID) {
+	if (newChannelID == 0) {
+		invalidateCachedClientDisplayName(serverConnectionHandlerID, clientID);
+		forgetVoiceLevel(serverConnectionHandlerID, clientID);
+	}
+	if (trackingServerState() && updateStateClientMoved(serverConnectionHandlerID, clientID, oldChannelID, newChannelID)) {
+		sendServerStateSnapshot(serverConnectionHandlerID);
+	}
+}
 
 void ts3plugin_onConnectStatusChangeEvent(uint64 serverConnectionHandlerID, int newStatus, unsigned int errorNumber) {
-	rapidjson::Document json;
-	PREPARE_JSON_FOR_AURORA(json);
+	RECORD_HOOK(onConnectStatusChangeEvent, serverConnectionHandlerID, newStatus, errorNumber);
+
+	if (eventSubscribed(AuroraEvent::onConnectStatusChangeEvent)) {
+		SEND_EVENT_TO_AURORA(onConnectStatusChangeEvent,
+			EVENT_FIELD(serverConnectionHandlerID),
+			EVENT_FIELD(newStatus),
+			EVENT_FIELD(errorNumber));
+	}
+
+	if (newStatus == STATUS_CONNECTION_ESTABLISHED) {
+		if (trackingServerState() && seedServerState(serverConnectionHandlerID)) {
+			sendServerStateSnapshot(serverConnectionHandlerID);
+		}
+	}
+	else if (newStatus == STATUS_DISCONNECTED) {
+		clearServerState(serverConnectionHandlerID);
+		clearCachedClientDisplayNames(serverConnectionHandlerID);
+		forgetVoiceLevels(serverConnectionHandlerID);
+	}
+}
+
+void ts3plugin_currentServerConnectionChanged(uint64 serverConnectionHandlerID) {
+	RECORD_HOOK(currentServerConnectionChanged, serverConnectionHandlerID);
+
+	focusConnection(serverConnectionHandlerID);
+}
+
+void ts3plugin_onNewChannelEvent(uint64 serverConnectionHandlerID, uint64 channelID, uint64 channelParentID) {
+	RECORD_HOOK(onNewChannelEvent, serverConnectionHandlerID, channelID, channelParentID);
 
-	JSON_ADD_VAL(json, onConnectStatusChangeEvent, serverConnectionHandlerID);
-	JSON_ADD_VAL(json, onConnectStatusChangeEvent, newStatus);
-	JSON_ADD_VAL(json, onConnectStatusChangeEvent, errorNumber);
+	if (!trackingServerState()) {
+		return;
+	}
+
+	if (updateStateChannelAdded(serverConnectionHandlerID, channelID, channelParentID)) {
+		sendServerStateSnapshot(serverConnectionHandlerID);
+	}
+}
+
+void ts3plugin_onNewChannelCreatedEvent(uint64 serverConnectionHandlerID, uint64 channelID, uint64 channelParentID, anyID invokerID, const char* invokerName, const char* invokerUniqueIdentifier) {
+	RECORD_HOOK(onNewChannelCreatedEvent, serverConnectionHandlerID, channelID, channelParentID, invokerID, invokerName, invokerUniqueIdentifier);
+
+	if (!trackingServerState()) {
+		return;
+	}
 
-	sendJSON_to_Aurora(json);
+	if (updateStateChannelAdded(serverConnectionHandlerID, channelID, channelParentID)) {
+		sendServerStateSnapshot(serverConnectionHandlerID);
+	}
+}
+
+void ts3plugin_onDelChannelEvent(uint64 serverConnectionHandlerID, uint64 channelID, anyID invokerID, const char* invokerName, const char* invokerUniqueIdentifier) {
+	RECORD_HOOK(onDelChannelEvent, serverConnectionHandlerID, channelID, invokerID, invokerName, invokerUniqueIdentifier);
+
+	if (!trackingServerState()) {
+		return;
+	}
+
+	if (updateStateChannelDeleted(serverConnectionHandlerID, channelID)) {
+		sendServerStateSnapshot(serverConnectionHandlerID);
+	}
+}
+
+void ts3plugin_onChannelMoveEvent(uint64 serverConnectionHandlerID, uint64 channelID, uint64 newChannelParentID, anyID invokerID, const char* invokerName, const char* invokerUniqueIdentifier) {
+	RECORD_HOOK(onChannelMoveEvent, serverConnectionHandlerID, channelID, newChannelParentID, invokerID, invokerName, invokerUniqueIdentifier);
+
+	if (!trackingServerState()) {
+		return;
+	}
+
+	if (updateStateChannelMoved(serverConnectionHandlerID, channelID, newChannelParentID)) {
+		sendServerStateSnapshot(serverConnectionHandlerID);
+	}
+}
+
+void ts3plugin_onUpdateChannelEvent(uint64 serverConnectionHandlerID, uint64 channelID) {
+	RECORD_HOOK(onUpdateChannelEvent, serverConnectionHandlerID, channelID);
+
+	if (!trackingServerState()) {
+		return;
+	}
+
+	if (updateStateChannelUpdated(serverConnectionHandlerID, channelID)) {
+		sendServerStateSnapshot(serverConnectionHandlerID);
+	}
+}
+
+void ts3plugin_onUpdateChannelEditedEvent(uint64 serverConnectionHandlerID, uint64 channelID, anyID invokerID, const char* invokerName, const char* invokerUniqueIdentifier) {
+	RECORD_HOOK(onUpdateChannelEditedEvent, serverConnectionHandlerID, channelID, invokerID, invokerName, invokerUniqueIdentifier);
+
+	if (!trackingServerState()) {
+		return;
+	}
+
+	if (updateStateChannelUpdated(serverConnectionHandlerID, channelID)) {
+		sendServerStateSnapshot(serverConnectionHandlerID);
+	}
+}
+
+void ts3plugin_onUpdateClientEvent(uint64 serverConnectionHandlerID, anyID clientID, anyID invokerID, const char* invokerName, const char* invokerUniqueIdentifier) {
+	RECORD_HOOK(onUpdateClientEvent, serverConnectionHandlerID, clientID, invokerID, invokerName, invokerUniqueIdentifier);
+
+	invalidateCachedClientDisplayName(serverConnectionHandlerID, clientID);
+
+	if (trackingServerState() && updateStateClientUpdated(serverConnectionHandlerID, clientID)) {
+		sendServerStateSnapshot(serverConnectionHandlerID);
+	}
 }
 
 void ts3plugin_onClientMoveEvent(uint64 serverConnectionHandlerID, anyID clientID, uint64 oldChannelID, uint64 newChannelID, int visibility, const char* moveMessage) {
-	rapidjson::Document json;
-	PREPARE_JSON_FOR_AURORA(json);
+	RECORD_HOOK(onClientMoveEvent, serverConnectionHandlerID, clientID, oldChannelID, newChannelID, visibility, moveMessage);
+
+	if (eventSubscribed(AuroraEvent::onClientMoveEvent) && isFocusedConnection(serverConnectionHandlerID)) {
+		SEND_EVENT_TO_AURORA(onClientMoveEvent,
+			EVENT_FIELD(serverConnectionHandlerID),
+			EVENT_FIELD(clientID),
+			EVENT_FIELD(oldChannelID),
+			EVENT_FIELD(newChannelID),
+			EVENT_FIELD(visibility),
+			EVENT_FIELD(moveMessage));
+	}
+
+	onClientMoved(serverConnectionHandlerID, clientID, oldChannelID, newChannelID);
+}
 
-	JSON_ADD_VAL(json, onClientMoveEvent, serverConnectionHandlerID);
-	JSON_ADD_VAL(json, onClientMoveEvent, clientID);
-	JSON_ADD_VAL(json, onClientMoveEvent, oldChannelID);
-	JSON_ADD_VAL(json, onClientMoveEvent, newChannelID);
-	JSON_ADD_VAL(json, onClientMoveEvent, visibility);
-	JSON_ADD_VAL(json, onClientMoveEvent, moveMessage);
+void ts3plugin_onClientMoveSubscriptionEvent(uint64 serverConnectionHandlerID, anyID clientID, uint64 oldChannelID, uint64 newChannelID, int visibility) {
+	RECORD_HOOK(onClientMoveSubscriptionEvent, serverConnectionHandlerID, clientID, oldChannelID, newChannelID, visibility);
 
-	sendJSON_to_Aurora(json);
+	onClientMoved(serverConnectionHandlerID, clientID, oldChannelID, newChannelID);
+}
+
+void ts3plugin_onChannelSubscribeEvent(uint64 serverConnectionHandlerID, uint64 channelID) {
+	RECORD_HOOK(onChannelSubscribeEvent, serverConnectionHandlerID, channelID);
+
+	if (trackingServerState()) {
+		beginStateBurst(serverConnectionHandlerID, StateBurst::channelSubscribe);
+	}
+}
+
+void ts3plugin_onChannelSubscribeFinishedEvent(uint64 serverConnectionHandlerID) {
+	RECORD_HOOK(onChannelSubscribeFinishedEvent, serverConnectionHandlerID);
+
+	// One snapshot for every client the subscriptions revealed
+	if (trackingServerState() && endStateBurst(serverConnectionHandlerID, StateBurst::channelSubscribe)) {
+		sendServerStateSnapshot(serverConnectionHandlerID);
+	}
+}
+
+void ts3plugin_onChannelUnsubscribeEvent(uint64 serverConnectionHandlerID, uint64 channelID) {
+	RECORD_HOOK(onChannelUnsubscribeEvent, serverConnectionHandlerID, channelID);
+
+	if (trackingServerState()) {
+		beginStateBurst(serverConnectionHandlerID, StateBurst::channelUnsubscribe);
+	}
+}
+
+void ts3plugin_onChannelUnsubscribeFinishedEvent(uint64 serverConnectionHandlerID) {
+	RECORD_HOOK(onChannelUnsubscribeFinishedEvent, serverConnectionHandlerID);
+
+	if (trackingServerState() && endStateBurst(serverConnectionHandlerID, StateBurst::channelUnsubscribe)) {
+		sendServerStateSnapshot(serverConnectionHandlerID);
+	}
+}
+
+void ts3plugin_onClientIDsEvent(uint64 serverConnectionHandlerID, const char* uniqueClientIdentifier, anyID clientID, const char* clientName) {
+	RECORD_HOOK(onClientIDsEvent, serverConnectionHandlerID, uniqueClientIdentifier, clientID, clientName);
+
+	if (!trackingServerState()) {
+		return;
+	}
+
+	beginStateBurst(serverConnectionHandlerID, StateBurst::clientIDs);
+	updateStateClientIDs(serverConnectionHandlerID, clientID, clientName);
+}
+
+void ts3plugin_onClientIDsFinishedEvent(uint64 serverConnectionHandlerID) {
+	RECORD_HOOK(onClientIDsFinishedEvent, serverConnectionHandlerID);
+
+	if (trackingServerState() && endStateBurst(serverConnectionHandlerID, StateBurst::clientIDs)) {
+		sendServerStateSnapshot(serverConnectionHandlerID);
+	}
+}
+
+void ts3plugin_onClientMoveTimeoutEvent(uint64 serverConnectionHandlerID, anyID clientID, uint64 oldChannelID, uint64 newChannelID, int visibility, const char* timeoutMessage) {
+	RECORD_HOOK(onClientMoveTimeoutEvent, serverConnectionHandlerID, clientID, oldChannelID, newChannelID, visibility, timeoutMessage);
+
+	onClientMoved(serverConnectionHandlerID, clientID, oldChannelID, newChannelID);
+}
+
+void ts3plugin_onClientMoveMovedEvent(uint64 serverConnectionHandlerID, anyID clientID, uint64 oldChannelID, uint64 newChannelID, int visibility, anyID moverID, const char* moverName, const char* moverUniqueIdentifier, const char* moveMessage) {
+	RECORD_HOOK(onClientMoveMovedEvent, serverConnectionHandlerID, clientID, oldChannelID, newChannelID, visibility, moverID, moverName, moverUniqueIdentifier, moveMessage);
+
+	onClientMoved(serverConnectionHandlerID, clientID, oldChannelID, newChannelID);
 }
 
 void ts3plugin_onClientKickFromChannelEvent(uint64 serverConnectionHandlerID, anyID clientID, uint64 oldChannelID, uint64 newChannelID, int visibility, anyID kickerID, const char* kickerName, const char* kickerUniqueIdentifier, const char* kickMessage) {
-	rapidjson::Document json;
-	PREPARE_JSON_FOR_AURORA(json);
+	RECORD_HOOK(onClientKickFromChannelEvent, serverConnectionHandlerID, clientID, oldChannelID, newChannelID, visibility, kickerID, kickerName, kickerUniqueIdentifier, kickMessage);
 
-	JSON_ADD_VAL(json, onClientKickFromChannelEvent, serverConnectionHandlerID);
-	JSON_ADD_VAL(json, onClientKickFromChannelEvent, clientID);
-	JSON_ADD_VAL(json, onClientKickFromChannelEvent, oldChannelID);
-	JSON_ADD_VAL(json, onClientKickFromChannelEvent, newChannelID);
-	JSON_ADD_VAL(json, onClientKickFromChannelEvent, visibility);
-	JSON_ADD_VAL(json, onClientKickFromChannelEvent, kickerID);
-	JSON_ADD_VAL(json, onClientKickFromChannelEvent, kickerName);
-	JSON_ADD_VAL(json, onClientKickFromChannelEvent, kickerUniqueIdentifier);
-	JSON_ADD_VAL(json, onClientKickFromChannelEvent, kickMessage);
+	if (eventSubscribed(AuroraEvent::onClientKickFromChannelEvent)) {
+		SEND_EVENT_TO_AURORA(onClientKickFromChannelEvent,
+			EVENT_FIELD(serverConnectionHandlerID),
+			EVENT_FIELD(clientID),
+			EVENT_FIELD(oldChannelID),
+			EVENT_FIELD(newChannelID),
+			EVENT_FIELD(visibility),
+			EVENT_FIELD(kickerID),
+			EVENT_FIELD(kickerName),
+			EVENT_FIELD(kickerUniqueIdentifier),
+			EVENT_FIELD(kickMessage));
+	}
 
-	sendJSON_to_Aurora(json);
+	onClientMoved(serverConnectionHandlerID, clientID, oldChannelID, newChannelID);
 }
 
 void ts3plugin_onClientKickFromServerEvent(uint64 serverConnectionHandlerID, anyID clientID, uint64 oldChannelID, uint64 newChannelID, int visibility, anyID kickerID, const char* kickerName, const char* kickerUniqueIdentifier, const char* kickMessage) {
-	rapidjson::Document json;
-	PREPARE_JSON_FOR_AURORA(json);
+	RECORD_HOOK(onClientKickFromServerEvent, serverConnectionHandlerID, clientID, oldChannelID, newChannelID, visibility, kickerID, kickerName, kickerUniqueIdentifier, kickMessage);
+
+	if (eventSubscribed(AuroraEvent::onClientKickFromServerEvent)) {
+		SEND_EVENT_TO_AURORA(onClientKickFromServerEvent,
+			EVENT_FIELD(serverConnectionHandlerID),
+			EVENT_FIELD(clientID),
+			EVENT_FIELD(oldChannelID),
+			EVENT_FIELD(newChannelID),
+			EVENT_FIELD(visibility),
+			EVENT_FIELD(kickerID),
+			EVENT_FIELD(kickerName),
+			EVENT_FIELD(kickerUniqueIdentifier),
+			EVENT_FIELD(kickMessage));
+	}
+
+	// Kicked clients always leave our view
+	onClientMoved(serverConnectionHandlerID, clientID, oldChannelID, 0);
+}
 
-	JSON_ADD_VAL(json, onClientKickFromServerEvent, serverConnectionHandlerID);
-	JSON_ADD_VAL(json, onClientKickFromServerEvent, clientID);
-	JSON_ADD_VAL(json, onClientKickFromServerEvent, oldChannelID);
-	JSON_ADD_VAL(json, onClientKickFromServerEvent, newChannelID);
-	JSON_ADD_VAL(json, onClientKickFromServerEvent, visibility);
-	JSON_ADD_VAL(json, onClientKickFromServerEvent, kickerID);
-	JSON_ADD_VAL(json, onClientKickFromServerEvent, kickerName);
-	JSON_ADD_VAL(json, onClientKickFromServerEvent, kickerUniqueIdentifier);
-	JSON_ADD_VAL(json, onClientKickFromServerEvent, kickMessage);
+void ts3plugin_onClientBanFromServerEvent(uint64 serverConnectionHandlerID, anyID clientID, uint64 oldChannelID, uint64 newChannelID, int visibility, anyID kickerID, const char* kickerName, const char* kickerUniqueIdentifier, uint64 time, const char* kickMessage) {
+	RECORD_HOOK(onClientBanFromServerEvent, serverConnectionHandlerID, clientID, oldChannelID, newChannelID, visibility, kickerID, kickerName, kickerUniqueIdentifier, time, kickMessage);
 
-	sendJSON_to_Aurora(json);
+	onClientMoved(serverConnectionHandlerID, clientID, oldChannelID, 0);
 }
 
 int ts3plugin_onClientPokeEvent(uint64 serverConnectionHandlerID, anyID fromClientID, const char* pokerName, const char* pokerUniqueIdentity, const char* message, int ffIgnored) {
-	rapidjson::Document json;
-	PREPARE_JSON_FOR_AURORA(json);
+	RECORD_HOOK(onClientPokeEvent, serverConnectionHandlerID, fromClientID, pokerName, pokerUniqueIdentity, message, ffIgnored);
 
-	JSON_ADD_VAL(json, onClientPokeEvent, serverConnectionHandlerID);
-	JSON_ADD_VAL(json, onClientPokeEvent, fromClientID);
-	JSON_ADD_VAL(json, onClientPokeEvent, pokerName);
-	JSON_ADD_VAL(json, onClientPokeEvent, pokerUniqueIdentity);
-	JSON_ADD_VAL(json, onClientPokeEvent, message);
-	JSON_ADD_VAL(json, onClientPokeEvent, ffIgnored);
+	if (!eventSubscribed(AuroraEvent::onClientPokeEvent)) {
+		return 0;
+	}
 
-	sendJSON_to_Aurora(json);
+	SEND_EVENT_TO_AURORA(onClientPokeEvent,
+		EVENT_FIELD(serverConnectionHandlerID),
+		EVENT_FIELD(fromClientID),
+		EVENT_FIELD(pokerName),
+		EVENT_FIELD(pokerUniqueIdentity),
+		EVENT_FIELD(message),
+		EVENT_FIELD(ffIgnored));
 
 	return 0;  /* 0 = handle normally, 1 = client will ignore the poke */
 }
 
 int ts3plugin_onTextMessageEvent(uint64 serverConnectionHandlerID, anyID targetMode, anyID toID, anyID fromID, const char* fromName, const char* fromUniqueIdentifier, const char* message, int ffIgnored) {
-	rapidjson::Document json;
-	PREPARE_JSON_FOR_AURORA(json);
+	RECORD_HOOK(onTextMessageEvent, serverConnectionHandlerID, targetMode, toID, fromID, fromName, fromUniqueIdentifier, message, ffIgnored);
 
-	JSON_ADD_VAL(json, onTextMessageEvent, serverConnectionHandlerID);
-	JSON_ADD_VAL(json, onTextMessageEvent, toID);
-	JSON_ADD_VAL(json, onTextMessageEvent, fromName);
-	JSON_ADD_VAL(json, onTextMessageEvent, fromUniqueIdentifier);
-	JSON_ADD_VAL(json, onTextMessageEvent, message);
-	JSON_ADD_VAL(json, onTextMessageEvent, ffIgnored);
+	if (!eventSubscribed(AuroraEvent::onTextMessageEvent)) {
+		return 0;
+	}
 
-	sendJSON_to_Aurora(json);
+	SEND_EVENT_TO_AURORA(onTextMessageEvent,
+		EVENT_FIELD(serverConnectionHandlerID),
+		EVENT_FIELD(toID),
+		EVENT_FIELD(fromName),
+		EVENT_FIELD(fromUniqueIdentifier),
+		EVENT_FIELD(message),
+		EVENT_FIELD(ffIgnored));
 
 	return 0;
 }
 
 void ts3plugin_onTalkStatusChangeEvent(uint64 serverConnectionHandlerID, int status, int isReceivedWhisper, anyID clientID) {
-	char name[512];
+	RECORD_HOOK(onTalkStatusChangeEvent, serverConnectionHandlerID, status, isReceivedWhisper, clientID);
 
-	if (ts3Functions.getClientDisplayName(serverConnectionHandlerID, clientID, name, 512) == ERROR_ok) {
-		rapidjson::Document json;
-		PREPARE_JSON_FOR_AURORA(json);
+	// Background tabs only count their talkers into the summary
+	if (eventSubscribed(AuroraEvent::onTalkStatusChangeEvent) && isFocusedConnection(serverConnectionHandlerID)) {
+		// Served from the cache, the client library is only asked the first time we see this client
+		char name[DISPLAY_NAME_BUFSIZE];
 
-		JSON_ADD_VAL(json, onTalkStatusChangeEvent, serverConnectionHandlerID);
-		JSON_ADD_VAL(json, onTalkStatusChangeEvent, status);
-		JSON_ADD_VAL(json, onTalkStatusChangeEvent, isReceivedWhisper);
-		JSON_ADD_VAL(json, onTalkStatusChangeEvent, clientID);
-		JSON_ADD_VAL(json, onTalkStatusChangeEvent, name);
+		if (getCachedClientDisplayName(serverConnectionHandlerID, clientID, name, sizeof(name))) {
+			// Talking flaps collapse into the latest status per client
+			const unsigned int holdMs = status == STATUS_NOT_TALKING ? pluginSettings.talkStopHoldMs : 0;
+			SEND_LATEST_EVENT_TO_AURORA(latestOnly(AuroraEvent::onTalkStatusChangeEvent, serverConnectionHandlerID, clientID, holdMs), onTalkStatusChangeEvent,
+				EVENT_FIELD(serverConnectionHandlerID),
+				EVENT_FIELD(status),
+				EVENT_FIELD(isReceivedWhisper),
+				EVENT_FIELD(clientID),
+				EVENT_FIELD(name));
+		}
+	}
 
-		sendJSON_to_Aurora(json);
+	if (trackingServerState() && updateStateTalkStatus(serverConnectionHandlerID, clientID, status)) {
+		sendServerStateSnapshot(serverConnectionHandlerID);
 	}
 }
 
 void ts3plugin_onClientSelfVariableUpdateEvent(uint64 serverConnectionHandlerID, int flag, const char* oldValue, const char* newValue) {
-	rapidjson::Document json;
-	PREPARE_JSON_FOR_AURORA(json);
+	RECORD_HOOK(onClientSelfVariableUpdateEvent, serverConnectionHandlerID, flag, oldValue, newValue);
 
-	JSON_ADD_VAL(json, onClientSelfVariableUpdateEvent, serverConnectionHandlerID);
-	JSON_ADD_VAL(json, onClientSelfVariableUpdateEvent, flag);
-	JSON_ADD_VAL(json, onClientSelfVariableUpdateEvent, oldValue);
-	JSON_ADD_VAL(json, onClientSelfVariableUpdateEvent, newValue);
+	if (!eventSubscribed(AuroraEvent::onClientSelfVariableUpdateEvent)) {
+		return;
+	}
+
+	// Repeated mute/deafen toggles only need their final value, one key per flag
+	SEND_LATEST_EVENT_TO_AURORA(latestOnly(AuroraEvent::onClientSelfVariableUpdateEvent, serverConnectionHandlerID, flag), onClientSelfVariableUpdateEvent,
+		EVENT_FIELD(serverConnectionHandlerID),
+		EVENT_FIELD(flag),
+		EVENT_FIELD(oldValue),
+		EVENT_FIELD(newValue));
+}
 
-	sendJSON_to_Aurora(json);
+void ts3plugin_onClientDisplayNameChanged(uint64 serverConnectionHandlerID, anyID clientID, const char* displayName, const char* uniqueClientIdentifier) {
+	RECORD_HOOK(onClientDisplayNameChanged, serverConnectionHandlerID, clientID, displayName, uniqueClientIdentifier);
+
+	updateCachedClientDisplayName(serverConnectionHandlerID, clientID, displayName);
+}
+
+void ts3plugin_onEditPlaybackVoiceDataEvent(uint64 serverConnectionHandlerID, anyID clientID, short* samples, int sampleCount, int channels) {
+	RECORD_AUDIO_HOOK(onEditPlaybackVoiceDataEvent, serverConnectionHandlerID, clientID, hookLogBlob(samples, (size_t)sampleCount * channels), sampleCount, channels);
+
+	// Runs on the audio thread: measure only, the samples are played back unchanged
+	if (pluginSettings.voiceLevelRateHz && isFocusedConnection(serverConnectionHandlerID)) {
+		recordVoiceLevel(serverConnectionHandlerID, clientID, samples, sampleCount, channels);
+	}
+}
+
+void ts3plugin_onEditCapturedVoiceDataEvent(uint64 serverConnectionHandlerID, short* samples, int sampleCount, int channels, int* edited) {
+	RECORD_AUDIO_HOOK(onEditCapturedVoiceDataEvent, serverConnectionHandlerID, hookLogBlob(samples, (size_t)sampleCount * channels), sampleCount, channels, hookLogBlob(edited, 1));
+
+	// Capture thread: measure only, *edited stays as it is so TeamSpeak keeps its own decision about the buffer
+	if (pluginSettings.captureLevelRateHz) {
+		recordCaptureLevel(serverConnectionHandlerID, samples, sampleCount, channels);
+	}
+}
+
+void ts3plugin_onEditMixedPlaybackVoiceDataEvent(uint64 serverConnectionHandlerID, short* samples, int sampleCount, int channels, const unsigned int* channelSpeakerArray, unsigned int* channelFillMask) {
+	RECORD_AUDIO_HOOK(onEditMixedPlaybackVoiceDataEvent, serverConnectionHandlerID, hookLogBlob(samples, (size_t)sampleCount * channels), sampleCount, channels, hookLogBlob(channelSpeakerArray, (size_t)channels), hookLogBlob(channelFillMask, 1));
+
+	// Audio thread: copy into the analyzer's ring and nothing else, the FFT runs on its own thread
+	if (pluginSettings.spectrumBands && pluginSettings.spectrumRateHz) {
+		recordMixedPlayback(serverConnectionHandlerID, samples, sampleCount, channels);
+	}
 }
@@ -0,0 +1,243 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <chrono>
+#include <mutex>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "hookLog.hpp"
+#include "settings.hpp"
+
+#define HOOK_LOG_PATH_BUFSIZE 1024
+// The mapping grows by this much whenever a record does not fit anymore
+#define HOOK_LOG_CHUNK_SIZE (8u << 20)
+
+std::atomic<bool> hookLogActive(false);
+std::atomic<bool> hookLogAudioActive(false);
+
+/*
+ * File mapped for writing. The mapping always covers the whole file, growing means unmapping,
+ * extending the file and mapping it again. Closing truncates the file to what was written.
+ */
+class MappedLogFile {
+public:
+	bool open(const char* path, size_t initialSize) {
+#ifdef _WIN32
+		file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE) {
+			return false;
+		}
+#else
+		file = ::open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+		if (file < 0) {
+			return false;
+		}
+#endif
+		if (!map(initialSize)) {
+			close(0);
+			return false;
+		}
+		return true;
+	}
+
+	/* Remaps the file at newSize bytes, keeping what was written */
+	bool grow(size_t newSize) {
+		unmap();
+		return map(newSize);
+	}
+
+	void close(size_t writtenSize) {
+		unmap();
+#ifdef _WIN32
+		if (file != INVALID_HANDLE_VALUE) {
+			LARGE_INTEGER end;
+			end.QuadPart = (LONGLONG)writtenSize;
+			SetFilePointerEx(file, end, nullptr, FILE_BEGIN);
+			SetEndOfFile(file);
+			CloseHandle(file);
+			file = INVALID_HANDLE_VALUE;
+		}
+#else
+		if (file >= 0) {
+			if (ftruncate(file, (off_t)writtenSize) != 0) {
+				printf("PLUGIN: hook log: could not truncate the log\n");
+			}
+			::close(file);
+			file = -1;
+		}
+#endif
+	}
+
+	char* data() const { return view; }
+	size_t size() const { return mappedSize; }
+
+private:
+	bool map(size_t newSize) {
+#ifdef _WIN32
+		// Mapping beyond the end of the file extends it
+		mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE, (DWORD)((unsigned long long)newSize >> 32), (DWORD)newSize, nullptr);
+		if (!mapping) {
+			return false;
+		}
+		view = (char*)MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, newSize);
+		if (!view) {
+			CloseHandle(mapping);
+			mapping = nullptr;
+			return false;
+		}
+#else
+		if (ftruncate(file, (off_t)newSize) != 0) {
+			return false;
+		}
+		void* address = mmap(nullptr, newSize, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+		if (address == MAP_FAILED) {
+			return false;
+		}
+		view = (char*)address;
+#endif
+		mappedSize = newSize;
+		return true;
+	}
+
+	void unmap() {
+#ifdef _WIN32
+		if (view) {
+			UnmapViewOfFile(view);
+		}
+		if (mapping) {
+			CloseHandle(mapping);
+			mapping = nullptr;
+		}
+#else
+		if (view) {
+			munmap(view, mappedSize);
+		}
+#endif
+		view = nullptr;
+		mappedSize = 0;
+	}
+
+#ifdef _WIN32
+	HANDLE file = INVALID_HANDLE_VALUE;
+	HANDLE mapping = nullptr;
+#else
+	int file = -1;
+#endif
+	char* view = nullptr;
+	size_t mappedSize = 0;
+};
+
+// Everything below is guarded by logMutex, hookLogActive only tells the hooks whether to bother
+static std::mutex logMutex;
+static MappedLogFile logFile;
+static size_t writtenSize = 0;
+static size_t maxSize = 0;
+static std::chrono::steady_clock::time_point logStart;
+
+/* Writes the zero size that ends the log and cuts the file after it. beginHookRecord always leaves room for it,
+ * and after a failed grow the mapping is gone but those bytes are still the zeros the file was extended with */
+static void closeLogFile() {
+	if (logFile.data()) {
+		memset(logFile.data() + writtenSize, 0, sizeof(uint32_t));
+	}
+	logFile.close(writtenSize + sizeof(uint32_t));
+}
+
+void startHookLog(const char* configPath) {
+	if (!pluginSettings.hookLog || hookLogActive.load()) {
+		return;
+	}
+
+	char path[HOOK_LOG_PATH_BUFSIZE];
+	char stamp[32];
+	time_t now = time(nullptr);
+	strftime(stamp, sizeof(stamp), "%Y%m%d_%H%M%S", localtime(&now));
+	snprintf(path, sizeof(path), "%saurora_gsi_hooks_%s.bin", configPath, stamp);
+
+	std::lock_guard<std::mutex> lock(logMutex);
+	maxSize = (size_t)pluginSettings.hookLogMaxMB << 20;
+	if (maxSize < sizeof(HookLogHeader) + sizeof(HookLogRecordHeader)) {
+		printf("PLUGIN: hook log: hookLogMaxMB is too small\n");
+		return;
+	}
+	if (!logFile.open(path, maxSize < HOOK_LOG_CHUNK_SIZE ? maxSize : HOOK_LOG_CHUNK_SIZE)) {
+		printf("PLUGIN: hook log: could not create %s\n", path);
+		return;
+	}
+
+	HookLogHeader header;
+	memcpy(header.magic, HOOK_LOG_MAGIC, sizeof(header.magic));
+	header.version = HOOK_LOG_VERSION;
+	header.headerSize = sizeof(HookLogHeader);
+	memcpy(logFile.data(), &header, sizeof(header));
+	writtenSize = sizeof(header);
+	logStart = std::chrono::steady_clock::now();
+
+	hookLogActive.store(true);
+	hookLogAudioActive.store(pluginSettings.hookLogAudio != 0);
+	printf("PLUGIN: recording hooks to %s\n", path);
+}
+
+void stopHookLog() {
+	hookLogActive.store(false);
+	hookLogAudioActive.store(false);
+
+	std::lock_guard<std::mutex> lock(logMutex);
+	if (logFile.data()) {
+		closeLogFile();
+		printf("PLUGIN: hook log closed at %zu bytes\n", writtenSize + sizeof(uint32_t));
+	}
+}
+
+char* beginHookRecord(HookLogID hook, size_t size) {
+	const size_t recordSize = sizeof(HookLogRecordHeader) + size;
+	logMutex.lock();
+
+	// Leave room for the zero size that ends the log
+	const size_t needed = writtenSize + recordSize + sizeof(uint32_t);
+	if (!logFile.data() || needed > maxSize) {
+		if (logFile.data()) {
+			printf("PLUGIN: hook log reached hookLogMaxMB, recording stopped\n");
+			hookLogActive.store(false);
+			hookLogAudioActive.store(false);
+		}
+		logMutex.unlock();
+		return nullptr;
+	}
+	if (needed > logFile.size()) {
+		size_t newSize = logFile.size() + HOOK_LOG_CHUNK_SIZE;
+		newSize = newSize > needed ? newSize : needed;
+		newSize = newSize < maxSize ? newSize : maxSize;
+		if (!logFile.grow(newSize)) {
+			printf("PLUGIN: hook log: could not grow the log, recording stopped\n");
+			hookLogActive.store(false);
+			hookLogAudioActive.store(false);
+			closeLogFile();
+			logMutex.unlock();
+			return nullptr;
+		}
+	}
+
+	HookLogRecordHeader header;
+	header.size = (uint32_t)recordSize;
+	header.hook = (uint16_t)hook;
+	header.reserved = 0;
+	header.timestampNs = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - logStart).count();
+
+	char* record = logFile.data() + writtenSize;
+	memcpy(record, &header, sizeof(header));
+	writtenSize += recordSize;
+	return record + sizeof(header);
+}
+
+void finishHookRecord() {
+	logMutex.unlock();
+}
@@ -0,0 +1,102 @@
+#include <stdio.h>
+
+#define CURL_STATICLIB
+#include <curl/curl.h>
+
+#include "httpSink.hpp"
+
+// After this many failed requests in a row the easy handle (and its connection cache) is thrown away and rebuilt
+#define SINK_RECREATE_AFTER_FAILURES 3
+
+static size_t discardResponse(char* data, size_t size, size_t nmemb, void* userdata) {
+	return size * nmemb;
+}
+
+HttpSink::HttpSink(const char* url, const char* contentType, long connectTimeoutMs, long requestTimeoutMs) :
+	connectTimeoutMs(connectTimeoutMs), requestTimeoutMs(requestTimeoutMs), curlHandle(nullptr), headers(nullptr), reconnectNeeded(false), consecutiveFailures(0) {
+	snprintf(this->url, sizeof(this->url), "%s", url);
+
+	// Header list never changes, build it once for all requests
+	char contentTypeHeader[SINK_HEADER_BUFSIZE];
+	snprintf(contentTypeHeader, sizeof(contentTypeHeader), "Content-Type: %s", contentType);
+	headers = curl_slist_append(headers, contentTypeHeader);
+	headers = curl_slist_append(headers, "Connection: keep-alive");
+	// Stop curl from sending "Expect: 100-continue" and waiting for Aurora to answer it
+	headers = curl_slist_append(headers, "Expect:");
+
+	createHandle();
+}
+
+HttpSink::~HttpSink() {
+	destroyHandle();
+	curl_slist_free_all(headers);
+}
+
+bool HttpSink::createHandle() {
+	curlHandle = curl_easy_init();
+	if (!curlHandle) {
+		return false;
+	}
+
+	curl_easy_setopt(curlHandle, CURLOPT_URL, url);
+	curl_easy_setopt(curlHandle, CURLOPT_HTTPHEADER, headers);
+	curl_easy_setopt(curlHandle, CURLOPT_POST, 1L);
+	curl_easy_setopt(curlHandle, CURLOPT_NOSIGNAL, 1L);
+	curl_easy_setopt(curlHandle, CURLOPT_TCP_NODELAY, 1L);
+	curl_easy_setopt(curlHandle, CURLOPT_TCP_KEEPALIVE, 1L);
+	// A hung Aurora must never hold the sender for long
+	curl_easy_setopt(curlHandle, CURLOPT_CONNECTTIMEOUT_MS, connectTimeoutMs);
+	curl_easy_setopt(curlHandle, CURLOPT_TIMEOUT_MS, requestTimeoutMs);
+	// Aurora's response body is of no interest, discard it instead of printing it to stdout
+	curl_easy_setopt(curlHandle, CURLOPT_WRITEFUNCTION, discardResponse);
+	// An error status means Aurora did not take the event, count it as a failed request
+	curl_easy_setopt(curlHandle, CURLOPT_FAILONERROR, 1L);
+
+	reconnectNeeded = false;
+	return true;
+}
+
+void HttpSink::destroyHandle() {
+	if (curlHandle) {
+		curl_easy_cleanup(curlHandle);
+		curlHandle = nullptr;
+	}
+}
+
+int HttpSink::perform(const char* payload, size_t length) {
+	curl_easy_setopt(curlHandle, CURLOPT_POSTFIELDS, payload);
+	curl_easy_setopt(curlHandle, CURLOPT_POSTFIELDSIZE, (long)length);
+	curl_easy_setopt(curlHandle, CURLOPT_FRESH_CONNECT, reconnectNeeded ? 1L : 0L);
+
+	return curl_easy_perform(curlHandle);
+}
+
+bool HttpSink::post(const char* payload, size_t length) {
+	if (!curlHandle && !createHandle()) {
+		return false;
+	}
+
+	CURLcode curlResult = (CURLcode)perform(payload, length);
+
+	// Aurora may have closed the kept-alive connection in the meantime, retry once on a fresh one
+	if (curlResult == CURLE_SEND_ERROR || curlResult == CURLE_RECV_ERROR || curlResult == CURLE_GOT_NOTHING) {
+		reconnectNeeded = true;
+		curlResult = (CURLcode)perform(payload, length);
+	}
+
+	if (curlResult != CURLE_OK) {
+		// If sending request fails, print the error message
+		fprintf(stderr, "curl_easy_perform() failed: %s\n", curl_easy_strerror(curlResult));
+
+		reconnectNeeded = true;
+		if (++consecutiveFailures >= SINK_RECREATE_AFTER_FAILURES) {
+			destroyHandle();
+			consecutiveFailures = 0;
+		}
+		return false;
+	}
+
+	reconnectNeeded = false;
+	consecutiveFailures = 0;
+	return true;
+}
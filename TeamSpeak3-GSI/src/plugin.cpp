@@ -1,4 +1,8 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
 
 #include <teamspeak/public_errors.h>
 #include <teamspeak/public_errors_rare.h>
@@ -7,12 +11,17 @@
 #include <teamspeak/clientlib_publicdefinitions.h>
 #include <ts3_functions.h>
 
-#include <rapidjson/document.h>
-#include <rapidjson/writer.h>
-#include <rapidjson/stringbuffer.h>
-#include <rapidjson/pointer.h>
-
 #include "plugin_exports.hpp"
+#include "auroraSender.hpp"
+#include "clientNameCache.hpp"
+#include "voiceLevel.hpp"
+#include "captureLevel.hpp"
+#include "spectrumPublisher.hpp"
+#include "hookLog.hpp"
+#include "pluginMetrics.hpp"
+#include "serverState.hpp"
+#include "settings.hpp"
+#include "traceLog.hpp"
 
 
 #ifdef _WIN32
@@ -20,9 +29,8 @@
 #pragma comment(lib, "crypt32.lib")
 #pragma comment(lib, "Ws2_32.lib")
 #pragma comment(lib, "Normaliz.lib")
-#endif
-
 #pragma comment(lib, "libcurl_a.lib")
+#endif
 
 #define CURL_STATICLIB
 #include <curl/curl.h>
@@ -47,7 +55,11 @@ void safe_strcpy(char* dest, size_t destSize, char const* src) {
 #define CHANNELINFO_BUFSIZE 512
 #define RETURNCODE_BUFSIZE 128
 
+#define METRICS_FILE_NAME "aurora_gsi_stats.json"
+
 static char* pluginID = nullptr;
+// Where "/aurora stats json" writes to, the config folder. Room for the longest config path plus the file name
+static char metricsPath[PATH_BUFSIZE + sizeof(METRICS_FILE_NAME)];
 
 /* Unique name identifying this plugin */
 const char* ts3plugin_name() {
@@ -101,6 +113,20 @@ int ts3plugin_init() {
 
 	printf("PLUGIN: App path: %s\nResources path: %s\nConfig path: %s\nPlugin path: %s\n", appPath, resourcesPath, configPath, pluginPath);
 
+	loadPluginSettings(configPath);
+	snprintf(metricsPath, sizeof(metricsPath), "%s%s", configPath, METRICS_FILE_NAME);
+	resetPluginMetrics();
+	startHookLog(configPath);
+	startTraceLog(configPath);
+	registerVoiceLevelTask();
+	registerCaptureLevelTask();
+	registerServerSummaryTask();
+	focusConnection(ts3Functions.getCurrentServerConnectionHandlerID());
+
+	// Events are delivered from a background thread so hooks never wait on HTTP
+	startAuroraSender();
+	startSpectrumAnalyzer();
+
 	return 0;  /* 0 = success, 1 = failure, -2 = failure but client will not show a "failed to load" warning */
 	/* -2 is a very special case and should only be used if a plugin displays a dialog (e.g. overlay) asking the user to disable
 	 * the plugin again, avoiding the show another dialog by the client telling the user the plugin failed to load.
@@ -111,6 +137,13 @@ void ts3plugin_shutdown() {
 	/* Your plugin cleanup code here */
 	printf("PLUGIN: shutdown\n");
 
+	// The analyzer feeds the sender, and the sender thread still uses CURL, stop both first
+	stopSpectrumAnalyzer();
+	stopAuroraSender();
+	releaseClientDisplayNameCache();
+	stopHookLog();
+	stopTraceLog();
+
 	// CURL Cleanup
 	curl_global_cleanup();
 
@@ -134,33 +167,65 @@ void ts3plugin_registerPluginID(const char* id) {
 	printf("PLUGIN: registerPluginID: %s\n", pluginID);
 }
 
-int sendJSON_to_Aurora(rapidjson::Document& json) {
-	CURL* curlHandle;
-	CURLcode curlResult;
-
-	/* get a curl handle */
-	curlHandle = curl_easy_init();
-	if (curlHandle) {
-		struct curl_slist* headerstruct = curl_slist_append(NULL, "Content-Type: application/json");
-		curl_easy_setopt(curlHandle, CURLOPT_HTTPHEADER, headerstruct);
-		curl_easy_setopt(curlHandle, CURLOPT_URL, "http://localhost:9088");
-
-
-		rapidjson::StringBuffer buffer; rapidjson::Writer<rapidjson::StringBuffer> writer(buffer); json.Accept(writer);
+/* Chat command prefix, "/aurora stats" reaches ts3plugin_processCommand as "stats" */
+const char* ts3plugin_commandKeyword() {
+	return "aurora";
+}
 
-		curl_easy_setopt(curlHandle, CURLOPT_POSTFIELDS, buffer.GetString());
+static bool writeMetricsFile(const std::string& json) {
+	FILE* file = fopen(metricsPath, "wb");
+	if (!file) {
+		return false;
+	}
+	const bool written = fwrite(json.data(), 1, json.size(), file) == json.size();
+	return fclose(file) == 0 && written;
+}
 
-		curlResult = curl_easy_perform(curlHandle);
+/* stats: metrics into the current tab, stats json: metrics into aurora_gsi_stats.json, stats reset: start counting anew.
+ * Returns 0 if the command was handled, 1 if not */
+int ts3plugin_processCommand(uint64 serverConnectionHandlerID, const char* command) {
+	std::string message;
+	if (!strcmp(command, "stats")) {
+		formatMetricsText(message, true);
+	}
+	else if (!strcmp(command, "stats json")) {
+		std::string json;
+		formatMetricsJson(json);
+		message = writeMetricsFile(json) ? "Aurora GSI metrics written to " : "Aurora GSI metrics could not be written to ";
+		message += metricsPath;
+	}
+	else if (!strcmp(command, "stats reset")) {
+		resetPluginMetrics();
+		message = "Aurora GSI metrics reset";
+	}
+	else {
+		ts3Functions.printMessageToCurrentTab("Usage: /aurora stats [json|reset]");
+		return 1;
+	}
+	ts3Functions.printMessageToCurrentTab(message.c_str());
+	return 0;
+}
 
-		// If sending request fails, print the error message
-		if (curlResult != CURLE_OK)
-		{
-			fprintf(stderr, "curl_easy_perform() failed: %s\n", curl_easy_strerror(curlResult));
-		}
+/* Heading of the plugin's part of the info panel */
+const char* ts3plugin_infoTitle() {
+	return "Aurora GSI";
+}
 
-		curl_easy_cleanup(curlHandle);
+/* Pipeline metrics under the selected server. The metrics cover every tab, so channels and clients show nothing */
+void ts3plugin_infoData(uint64 serverConnectionHandlerID, uint64 id, enum PluginItemType type, char** data) {
+	if (type != PLUGIN_SERVER) {
+		*data = nullptr;
+		return;
+	}
+	std::string text;
+	formatMetricsText(text, false);
+	// The client hands the text back to ts3plugin_freeMemory once shown
+	*data = (char*)malloc(text.size() + 1);
+	if (*data) {
+		memcpy(*data, text.c_str(), text.size() + 1);
 	}
-
-	return 0;
 }
 
+void ts3plugin_freeMemory(void* data) {
+	free(data);
+}
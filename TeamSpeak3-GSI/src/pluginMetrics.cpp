@@ -0,0 +1,246 @@
+#include <stdarg.h>
+#include <stdio.h>
+
+#include <algorithm>
+
+#include <rapidjson/writer.h>
+#include <rapidjson/stringbuffer.h>
+
+#include "pluginMetrics.hpp"
+#include "sinkHealth.hpp"
+
+PluginMetrics pluginMetrics;
+
+thread_local uint64_t hookEntryNs = 0;
+
+LatencyHistogram::LatencyHistogram() {
+	reset();
+}
+
+void LatencyHistogram::reset() {
+	for (std::atomic<uint64_t>& bucket : buckets) {
+		bucket.store(0, std::memory_order_relaxed);
+	}
+	totalNs.store(0, std::memory_order_relaxed);
+	maxNs.store(0, std::memory_order_relaxed);
+}
+
+/* Upper bound of a bucket in microseconds */
+static uint64_t bucketLimitUs(size_t index) {
+	return (uint64_t)1 << index;
+}
+
+LatencySummary LatencyHistogram::summary() const {
+	uint64_t counts[LATENCY_BUCKETS];
+	uint64_t count = 0;
+	for (size_t i = 0; i < LATENCY_BUCKETS; i++) {
+		counts[i] = buckets[i].load(std::memory_order_relaxed);
+		count += counts[i];
+	}
+	LatencySummary result = { count, 0, 0, 0, maxNs.load(std::memory_order_relaxed) / 1000 };
+	if (count == 0) {
+		return result;
+	}
+	result.meanUs = totalNs.load(std::memory_order_relaxed) / count / 1000;
+
+	// Ranks of the percentiles, rounded up so p99 of a handful of samples is the slowest one
+	const uint64_t p50Rank = (count + 1) / 2;
+	const uint64_t p99Rank = (count * 99 + 99) / 100;
+	uint64_t seen = 0;
+	for (size_t i = 0; i < LATENCY_BUCKETS; i++) {
+		const uint64_t before = seen;
+		seen += counts[i];
+		// Never above the slowest sample, which is also the only bound of the open ended last bucket
+		const uint64_t limit = i == LATENCY_BUCKETS - 1 ? result.maxUs : std::min(bucketLimitUs(i), result.maxUs);
+		if (before < p50Rank && seen >= p50Rank) {
+			result.p50Us = limit;
+		}
+		if (before < p99Rank && seen >= p99Rank) {
+			result.p99Us = limit;
+		}
+	}
+	return result;
+}
+
+void resetPluginMetrics() {
+	PluginMetrics& metrics = pluginMetrics;
+	for (EventCounters& counters : metrics.events) {
+		counters.queued.store(0, std::memory_order_relaxed);
+		counters.sent.store(0, std::memory_order_relaxed);
+		counters.dropped.store(0, std::memory_order_relaxed);
+		counters.coalesced.store(0, std::memory_order_relaxed);
+	}
+	metrics.hookToEnqueue.reset();
+	metrics.serialize.reset();
+	for (LatencyHistogram& laneWait : metrics.queueWait) {
+		laneWait.reset();
+	}
+	metrics.send.reset();
+	metrics.queueDepthPeak.store(metrics.queueDepth.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	metrics.sinkRequests.store(0, std::memory_order_relaxed);
+	metrics.sinkErrors.store(0, std::memory_order_relaxed);
+	metrics.sinkBytes.store(0, std::memory_order_relaxed);
+	metrics.startedNs.store(metricsNowNs(), std::memory_order_relaxed);
+}
+
+static const char* breakerStateName(unsigned int state) {
+	switch (state) {
+	case SinkHealth::OPEN:
+		return "open";
+	case SinkHealth::HALF_OPEN:
+		return "half open";
+	default:
+		return "closed";
+	}
+}
+
+struct EventTotals {
+	uint64_t queued = 0;
+	uint64_t sent = 0;
+	uint64_t dropped = 0;
+	uint64_t coalesced = 0;
+
+	void add(const EventCounters& counters) {
+		queued += counters.queued.load(std::memory_order_relaxed);
+		sent += counters.sent.load(std::memory_order_relaxed);
+		dropped += counters.dropped.load(std::memory_order_relaxed);
+		coalesced += counters.coalesced.load(std::memory_order_relaxed);
+	}
+};
+
+static void appendFormat(std::string& out, const char* format, ...) {
+	char line[256];
+	va_list arguments;
+	va_start(arguments, format);
+	int length = vsnprintf(line, sizeof(line), format, arguments);
+	va_end(arguments);
+	if (length > 0) {
+		out.append(line, (size_t)length < sizeof(line) ? (size_t)length : sizeof(line) - 1);
+	}
+}
+
+static void appendLatencyLine(std::string& out, const char* name, const LatencyHistogram& histogram) {
+	const LatencySummary latency = histogram.summary();
+	appendFormat(out, "%s: p50 %llu us, p99 %llu us, max %llu us (%llu samples)\n", name,
+		(unsigned long long)latency.p50Us, (unsigned long long)latency.p99Us, (unsigned long long)latency.maxUs, (unsigned long long)latency.count);
+}
+
+void formatMetricsText(std::string& out, bool perEvent) {
+	const PluginMetrics& metrics = pluginMetrics;
+	EventTotals totals;
+	for (const EventCounters& counters : metrics.events) {
+		totals.add(counters);
+	}
+	const uint64_t uptimeS = (metricsNowNs() - metrics.startedNs.load(std::memory_order_relaxed)) / 1000000000ULL;
+
+	appendFormat(out, "Events over %llu s: %llu queued, %llu sent, %llu dropped, %llu coalesced\n", (unsigned long long)uptimeS,
+		(unsigned long long)totals.queued, (unsigned long long)totals.sent, (unsigned long long)totals.dropped, (unsigned long long)totals.coalesced);
+	appendFormat(out, "Queue depth %llu (peak %llu), %llu sink requests, %llu sink errors, breaker %s\n",
+		(unsigned long long)metrics.queueDepth.load(std::memory_order_relaxed), (unsigned long long)metrics.queueDepthPeak.load(std::memory_order_relaxed),
+		(unsigned long long)metrics.sinkRequests.load(std::memory_order_relaxed), (unsigned long long)metrics.sinkErrors.load(std::memory_order_relaxed),
+		breakerStateName(metrics.breakerState.load(std::memory_order_relaxed)));
+	appendLatencyLine(out, "Hook to enqueue", metrics.hookToEnqueue);
+	appendLatencyLine(out, "Serialize", metrics.serialize);
+	appendLatencyLine(out, "Queue wait, high lane", metrics.queueWait[(size_t)EventLane::high]);
+	appendLatencyLine(out, "Queue wait, normal lane", metrics.queueWait[(size_t)EventLane::normal]);
+	appendLatencyLine(out, "Queue wait, low lane", metrics.queueWait[(size_t)EventLane::low]);
+	appendLatencyLine(out, "Send", metrics.send);
+
+	if (!perEvent) {
+		return;
+	}
+	for (size_t i = 0; i < (size_t)AuroraEvent::count; i++) {
+		EventTotals event;
+		event.add(metrics.events[i]);
+		if (event.queued || event.dropped) {
+			appendFormat(out, "  %s: %llu queued, %llu sent, %llu dropped, %llu coalesced\n", auroraEventName((AuroraEvent)i),
+				(unsigned long long)event.queued, (unsigned long long)event.sent, (unsigned long long)event.dropped, (unsigned long long)event.coalesced);
+		}
+	}
+}
+
+typedef rapidjson::Writer<rapidjson::StringBuffer> MetricsWriter;
+
+static void writeCounter(MetricsWriter& writer, const char* name, const std::atomic<uint64_t>& value) {
+	writer.Key(name);
+	writer.Uint64(value.load(std::memory_order_relaxed));
+}
+
+static void writeLatency(MetricsWriter& writer, const char* name, const LatencyHistogram& histogram) {
+	const LatencySummary latency = histogram.summary();
+	writer.Key(name);
+	writer.StartObject();
+	writer.Key("count");
+	writer.Uint64(latency.count);
+	writer.Key("meanUs");
+	writer.Uint64(latency.meanUs);
+	writer.Key("p50Us");
+	writer.Uint64(latency.p50Us);
+	writer.Key("p99Us");
+	writer.Uint64(latency.p99Us);
+	writer.Key("maxUs");
+	writer.Uint64(latency.maxUs);
+	// Bucket i counts samples below 2^i us, see pluginMetrics.hpp
+	writer.Key("buckets");
+	writer.StartArray();
+	for (size_t i = 0; i < LATENCY_BUCKETS; i++) {
+		writer.Uint64(histogram.bucket(i));
+	}
+	writer.EndArray();
+	writer.EndObject();
+}
+
+void formatMetricsJson(std::string& out) {
+	const PluginMetrics& metrics = pluginMetrics;
+	rapidjson::StringBuffer buffer;
+	MetricsWriter writer(buffer);
+
+	writer.StartObject();
+	writer.Key("uptimeMs");
+	writer.Uint64((metricsNowNs() - metrics.startedNs.load(std::memory_order_relaxed)) / 1000000);
+
+	writer.Key("queue");
+	writer.StartObject();
+	writeCounter(writer, "depth", metrics.queueDepth);
+	writeCounter(writer, "peak", metrics.queueDepthPeak);
+	writer.EndObject();
+
+	writer.Key("sink");
+	writer.StartObject();
+	writeCounter(writer, "requests", metrics.sinkRequests);
+	writeCounter(writer, "errors", metrics.sinkErrors);
+	writeCounter(writer, "bytes", metrics.sinkBytes);
+	writer.Key("breaker");
+	writer.String(breakerStateName(metrics.breakerState.load(std::memory_order_relaxed)));
+	writer.EndObject();
+
+	writer.Key("events");
+	writer.StartObject();
+	for (size_t i = 0; i < (size_t)AuroraEvent::count; i++) {
+		const EventCounters& counters = metrics.events[i];
+		writer.Key(auroraEventName((AuroraEvent)i));
+		writer.StartObject();
+		writeCounter(writer, "queued", counters.queued);
+		writeCounter(writer, "sent", counters.sent);
+		writeCounter(writer, "dropped", counters.dropped);
+		writeCounter(writer, "coalesced", counters.coalesced);
+		writer.EndObject();
+	}
+	writer.EndObject();
+
+	writer.Key("latency");
+	writer.StartObject();
+	writeLatency(writer, "hookToEnqueue", metrics.hookToEnqueue);
+	writeLatency(writer, "serialize", metrics.serialize);
+	writer.Key("queueWait");
+	writer.StartObject();
+	for (size_t i = 0; i < (size_t)EventLane::count; i++) {
+		writeLatency(writer, eventLaneName((EventLane)i), metrics.queueWait[i]);
+	}
+	writer.EndObject();
+	writeLatency(writer, "send", metrics.send);
+	writer.EndObject();
+	writer.EndObject();
+
+	out.assign(buffer.GetString(), buffer.GetSize());
+}
@@ -0,0 +1,421 @@
+#include <stddef.h>
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <teamspeak/public_errors.h>
+#include <teamspeak/public_definitions.h>
+#include <ts3_functions.h>
+
+#include "auroraSender.hpp"
+#include "channelTree.hpp"
+#include "eventHooks.hpp"
+#include "serverState.hpp"
+#include "settings.hpp"
+
+// A burst whose Finished callback went missing stops holding back snapshots after this long
+#define STATE_BURST_TIMEOUT_MS 2000
+
+typedef std::chrono::steady_clock BurstClock;
+
+struct ClientState {
+	int talkStatus;
+	std::string name;
+};
+
+/* The tree holds the structure, names and talk status live next to it under the tree's indices */
+struct ConnectionState {
+	anyID ownClientID = 0;
+	ChannelTree tree;
+	std::vector<std::string> channelNames;
+	std::vector<ClientState> clients;
+
+	/* StateBurst bits of the open bursts, and whether the snapshot changed since the first one opened */
+	unsigned int openBursts = 0;
+	bool burstChanged = false;
+	BurstClock::time_point burstOpened;
+
+	/* Background connection that changed since its last serverSummary */
+	bool summaryDue = false;
+
+	TreeIndex ownChannel() const {
+		const TreeIndex own = tree.findClient(ownClientID);
+		return own != noTreeIndex ? tree.clientChannel(own) : noTreeIndex;
+	}
+
+	uint64 ownChannelID() const {
+		const TreeIndex channel = ownChannel();
+		return channel != noTreeIndex ? tree.channelID(channel) : 0;
+	}
+
+	std::string& channelName(TreeIndex channel) {
+		if (channel >= channelNames.size()) {
+			channelNames.resize(tree.channelCapacity());
+		}
+		return channelNames[channel];
+	}
+
+	ClientState& client(TreeIndex client) {
+		if (client >= clients.size()) {
+			clients.resize(tree.clientCapacity());
+		}
+		return clients[client];
+	}
+
+	/* Result of an update function, false while a burst is open */
+	bool snapshotChanged(bool changed) {
+		if (!openBursts) {
+			return changed;
+		}
+		if (BurstClock::now() - burstOpened < std::chrono::milliseconds(STATE_BURST_TIMEOUT_MS)) {
+			burstChanged = burstChanged || changed;
+			return false;
+		}
+		openBursts = 0;
+		changed = changed || burstChanged;
+		burstChanged = false;
+		return changed;
+	}
+};
+
+static std::mutex stateMutex;
+static std::unordered_map<uint64, ConnectionState> connections;
+
+std::atomic<uint64> focusedConnection(0);
+
+static std::string readClientName(uint64 serverConnectionHandlerID, anyID clientID) {
+	std::string name;
+	char* result;
+	if (ts3Functions.getClientVariableAsString(serverConnectionHandlerID, clientID, CLIENT_NICKNAME, &result) == ERROR_ok) {
+		name = result;
+		ts3Functions.freeMemory(result);
+	}
+	return name;
+}
+
+static std::string readChannelName(uint64 serverConnectionHandlerID, uint64 channelID) {
+	std::string name;
+	char* result;
+	if (ts3Functions.getChannelVariableAsString(serverConnectionHandlerID, channelID, CHANNEL_NAME, &result) == ERROR_ok) {
+		name = result;
+		ts3Functions.freeMemory(result);
+	}
+	return name;
+}
+
+static ConnectionState* findConnection(uint64 serverConnectionHandlerID) {
+	auto connection = connections.find(serverConnectionHandlerID);
+	return connection != connections.end() ? &connection->second : nullptr;
+}
+
+bool seedServerState(uint64 serverConnectionHandlerID) {
+	ConnectionState state;
+	uint64* channelList;
+
+	if (ts3Functions.getClientID(serverConnectionHandlerID, &state.ownClientID) != ERROR_ok) {
+		return false;
+	}
+	if (ts3Functions.getChannelList(serverConnectionHandlerID, &channelList) != ERROR_ok) {
+		return false;
+	}
+
+	size_t channelCount = 0;
+	while (channelList[channelCount]) {
+		channelCount++;
+	}
+	std::vector<uint64> parentIDs(channelCount, 0);
+	for (size_t i = 0; i < channelCount; i++) {
+		ts3Functions.getParentChannelOfChannel(serverConnectionHandlerID, channelList[i], &parentIDs[i]);
+	}
+	state.tree.build(channelList, parentIDs.data(), channelCount);
+	state.channelNames.resize(channelCount);
+
+	// build() gives the channels the indices of their position in the list
+	for (size_t i = 0; i < channelCount; i++) {
+		state.channelNames[i] = readChannelName(serverConnectionHandlerID, channelList[i]);
+
+		anyID* clientList;
+		if (ts3Functions.getChannelClientList(serverConnectionHandlerID, channelList[i], &clientList) == ERROR_ok) {
+			for (anyID* clientID = clientList; *clientID; clientID++) {
+				ClientState& client = state.client(state.tree.moveClient(*clientID, channelList[i]));
+				client.talkStatus = STATUS_NOT_TALKING;
+				client.name = readClientName(serverConnectionHandlerID, *clientID);
+			}
+			ts3Functions.freeMemory(clientList);
+		}
+	}
+	ts3Functions.freeMemory(channelList);
+
+	std::lock_guard<std::mutex> lock(stateMutex);
+	connections[serverConnectionHandlerID] = std::move(state);
+	return true;
+}
+
+void clearServerState(uint64 serverConnectionHandlerID) {
+	std::lock_guard<std::mutex> lock(stateMutex);
+	connections.erase(serverConnectionHandlerID);
+}
+
+bool updateStateClientMoved(uint64 serverConnectionHandlerID, anyID clientID, uint64 oldChannelID, uint64 newChannelID) {
+	std::string name;
+	if (oldChannelID == 0) {
+		// Read outside the lock, the client library may take a while
+		name = readClientName(serverConnectionHandlerID, clientID);
+	}
+
+	std::lock_guard<std::mutex> lock(stateMutex);
+	ConnectionState* state = findConnection(serverConnectionHandlerID);
+	if (!state) {
+		return false;
+	}
+
+	// Only joins, leaves and moves in or out of our channel change the snapshot
+	const TreeIndex ownChannel = state->ownChannel();
+	const TreeIndex previous = state->tree.findClient(clientID);
+	const bool visible = previous == noTreeIndex || clientID == state->ownClientID || state->tree.clientChannel(previous) == ownChannel;
+
+	const TreeIndex index = state->tree.moveClient(clientID, newChannelID);
+	if (index == noTreeIndex) {
+		return state->snapshotChanged(previous != noTreeIndex);
+	}
+	if (previous == noTreeIndex || oldChannelID == 0) {
+		ClientState& client = state->client(index);
+		client.talkStatus = STATUS_NOT_TALKING;
+		client.name = std::move(name);
+	}
+	return state->snapshotChanged(visible || state->tree.clientChannel(index) == ownChannel);
+}
+
+bool updateStateClientUpdated(uint64 serverConnectionHandlerID, anyID clientID) {
+	std::string name = readClientName(serverConnectionHandlerID, clientID);
+
+	std::lock_guard<std::mutex> lock(stateMutex);
+	ConnectionState* state = findConnection(serverConnectionHandlerID);
+	if (!state) {
+		return false;
+	}
+
+	const TreeIndex index = state->tree.findClient(clientID);
+	if (index == noTreeIndex || state->client(index).name == name) {
+		return false;
+	}
+	state->client(index).name = std::move(name);
+	return state->snapshotChanged(state->tree.clientChannel(index) == state->ownChannel());
+}
+
+bool updateStateClientIDs(uint64 serverConnectionHandlerID, anyID clientID, const char* clientName) {
+	std::lock_guard<std::mutex> lock(stateMutex);
+	ConnectionState* state = findConnection(serverConnectionHandlerID);
+	if (!state) {
+		return false;
+	}
+
+	const TreeIndex index = state->tree.findClient(clientID);
+	if (index == noTreeIndex || !clientName || state->client(index).name == clientName) {
+		return false;
+	}
+	state->client(index).name = clientName;
+	return state->snapshotChanged(state->tree.clientChannel(index) == state->ownChannel());
+}
+
+bool updateStateTalkStatus(uint64 serverConnectionHandlerID, anyID clientID, int status) {
+	std::lock_guard<std::mutex> lock(stateMutex);
+	ConnectionState* state = findConnection(serverConnectionHandlerID);
+	if (!state) {
+		return false;
+	}
+
+	const TreeIndex index = state->tree.findClient(clientID);
+	if (index == noTreeIndex || state->client(index).talkStatus == status) {
+		return false;
+	}
+	state->client(index).talkStatus = status;
+	if (state->tree.setTalking(index, status == STATUS_TALKING) && !isFocusedConnection(serverConnectionHandlerID)) {
+		// Talkers anywhere on the server count towards the summary
+		state->summaryDue = true;
+	}
+	return state->snapshotChanged(state->tree.clientChannel(index) == state->ownChannel());
+}
+
+bool updateStateChannelAdded(uint64 serverConnectionHandlerID, uint64 channelID, uint64 channelParentID) {
+	std::string name = readChannelName(serverConnectionHandlerID, channelID);
+
+	std::lock_guard<std::mutex> lock(stateMutex);
+	ConnectionState* state = findConnection(serverConnectionHandlerID);
+	if (!state) {
+		return false;
+	}
+
+	state->channelName(state->tree.addChannel(channelID, channelParentID)) = std::move(name);
+	return state->snapshotChanged(true);
+}
+
+bool updateStateChannelDeleted(uint64 serverConnectionHandlerID, uint64 channelID) {
+	std::lock_guard<std::mutex> lock(stateMutex);
+	ConnectionState* state = findConnection(serverConnectionHandlerID);
+	if (!state) {
+		return false;
+	}
+
+	return state->snapshotChanged(state->tree.removeChannel(channelID));
+}
+
+bool updateStateChannelMoved(uint64 serverConnectionHandlerID, uint64 channelID, uint64 newChannelParentID) {
+	std::lock_guard<std::mutex> lock(stateMutex);
+	ConnectionState* state = findConnection(serverConnectionHandlerID);
+	if (!state) {
+		return false;
+	}
+
+	state->tree.moveChannel(channelID, newChannelParentID);
+	// Parents are not part of the snapshot
+	return false;
+}
+
+bool updateStateChannelUpdated(uint64 serverConnectionHandlerID, uint64 channelID) {
+	std::string name = readChannelName(serverConnectionHandlerID, channelID);
+
+	std::lock_guard<std::mutex> lock(stateMutex);
+	ConnectionState* state = findConnection(serverConnectionHandlerID);
+	if (!state) {
+		return false;
+	}
+
+	const TreeIndex index = state->tree.findChannel(channelID);
+	if (index == noTreeIndex || state->channelName(index) == name) {
+		return false;
+	}
+	state->channelName(index) = std::move(name);
+	return state->snapshotChanged(index == state->ownChannel());
+}
+
+void beginStateBurst(uint64 serverConnectionHandlerID, StateBurst burst) {
+	std::lock_guard<std::mutex> lock(stateMutex);
+	ConnectionState* state = findConnection(serverConnectionHandlerID);
+	if (!state) {
+		return;
+	}
+
+	// The timeout counts from the latest subscribe or client ID callback
+	state->openBursts |= (unsigned int)burst;
+	state->burstOpened = BurstClock::now();
+}
+
+bool endStateBurst(uint64 serverConnectionHandlerID, StateBurst burst) {
+	std::lock_guard<std::mutex> lock(stateMutex);
+	ConnectionState* state = findConnection(serverConnectionHandlerID);
+	if (!state || !(state->openBursts & (unsigned int)burst)) {
+		return false;
+	}
+
+	state->openBursts &= ~(unsigned int)burst;
+	if (state->openBursts) {
+		return false;
+	}
+	const bool changed = state->burstChanged;
+	state->burstChanged = false;
+	return changed;
+}
+
+void focusConnection(uint64 serverConnectionHandlerID) {
+	const uint64 previous = focusedConnection.exchange(serverConnectionHandlerID);
+	if (previous == serverConnectionHandlerID) {
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(stateMutex);
+		ConnectionState* state = findConnection(previous);
+		if (state) {
+			state->summaryDue = true;
+		}
+	}
+	sendServerStateSnapshot(serverConnectionHandlerID);
+}
+
+static void sendServerSummaries() {
+	std::lock_guard<std::mutex> lock(stateMutex);
+	for (auto& connection : connections) {
+		ConnectionState& state = connection.second;
+		if (!state.summaryDue || isFocusedConnection(connection.first)) {
+			continue;
+		}
+		state.summaryDue = false;
+
+		uint64 serverConnectionHandlerID = connection.first;
+		const TreeIndex ownChannel = state.ownChannel();
+		uint64 channelID = state.ownChannelID();
+		unsigned int channelClientCount = ownChannel != noTreeIndex ? (unsigned int)state.tree.memberCount(ownChannel) : 0;
+		unsigned int channelTalkerCount = ownChannel != noTreeIndex ? state.tree.talkerCount(ownChannel) : 0;
+		unsigned int channelCount = (unsigned int)state.tree.channelCount();
+		unsigned int clientCount = (unsigned int)state.tree.clientCount();
+		unsigned int talkerCount = (unsigned int)state.tree.talkerCount();
+		SEND_LATEST_EVENT_TO_AURORA(latestOnly(AuroraEvent::serverSummary, serverConnectionHandlerID, 0), serverSummary,
+			EVENT_FIELD(serverConnectionHandlerID),
+			EVENT_FIELD(channelID),
+			EVENT_FIELD(channelClientCount),
+			EVENT_FIELD(channelTalkerCount),
+			EVENT_FIELD(channelCount),
+			EVENT_FIELD(clientCount),
+			EVENT_FIELD(talkerCount));
+	}
+}
+
+void registerServerSummaryTask() {
+	if (pluginSettings.backgroundSummaryMs && eventSubscribed(AuroraEvent::serverSummary)) {
+		addSenderTask(sendServerSummaries, pluginSettings.backgroundSummaryMs);
+	}
+}
+
+void sendServerStateSnapshot(uint64 serverConnectionHandlerID) {
+	std::lock_guard<std::mutex> lock(stateMutex);
+	ConnectionState* state = findConnection(serverConnectionHandlerID);
+	if (!state) {
+		return;
+	}
+	if (!isFocusedConnection(serverConnectionHandlerID)) {
+		// The summary task sends what changed
+		state->summaryDue = true;
+		return;
+	}
+	if (!eventSubscribed(AuroraEvent::serverState)) {
+		return;
+	}
+
+	anyID clientID = state->ownClientID;
+	const TreeIndex ownChannel = state->ownChannel();
+	uint64 channelID = state->ownChannelID();
+	const char* channelName = ownChannel != noTreeIndex && ownChannel < state->channelNames.size() ? state->channelNames[ownChannel].c_str() : nullptr;
+	unsigned int channelCount = (unsigned int)state->tree.channelCount();
+	unsigned int clientCount = (unsigned int)state->tree.clientCount();
+
+	auto channelClients = makeEventValueWriter([state, ownChannel](auto& writer) {
+		writer.StartArray();
+		const size_t memberCount = ownChannel != noTreeIndex ? state->tree.memberCount(ownChannel) : 0;
+		for (size_t i = 0; i < memberCount; i++) {
+			const TreeIndex member = state->tree.members(ownChannel)[i];
+			const ClientState& client = state->clients[member];
+			writer.StartObject();
+			writeEventKey(writer, EVENT_KEY(clientID));
+			writeEventValue(writer, state->tree.clientID(member));
+			writeEventKey(writer, EVENT_KEY(name));
+			writeEventValue(writer, client.name.c_str());
+			writeEventKey(writer, EVENT_KEY(talkStatus));
+			writeEventValue(writer, client.talkStatus);
+			writer.EndObject();
+		}
+		writer.EndArray();
+	});
+
+	// A newer snapshot makes any unsent one obsolete
+	SEND_LATEST_EVENT_TO_AURORA(latestOnly(AuroraEvent::serverState, serverConnectionHandlerID, 0), serverState,
+		EVENT_FIELD(serverConnectionHandlerID),
+		EVENT_FIELD(clientID),
+		EVENT_FIELD(channelID),
+		EVENT_FIELD(channelName),
+		EVENT_FIELD(channelCount),
+		EVENT_FIELD(clientCount),
+		EVENT_FIELD(channelClients));
+}
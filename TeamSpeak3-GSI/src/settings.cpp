@@ -0,0 +1,235 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "settings.hpp"
+
+#define SETTINGS_FILE_NAME "aurora_gsi.ini"
+#define SETTINGS_PATH_BUFSIZE 1024
+#define SETTINGS_LINE_BUFSIZE 512
+
+PluginSettings pluginSettings;
+
+static char* trim(char* text) {
+	while (*text == ' ' || *text == '\t') {
+		text++;
+	}
+	char* end = text + strlen(text);
+	while (end > text && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r' || end[-1] == '\n')) {
+		*--end = '\0';
+	}
+	return text;
+}
+
+static bool parseUnsigned(const char* key, const char* value, unsigned int* result) {
+	char* end;
+	unsigned long parsed = strtoul(value, &end, 10);
+	if (end == value || *end != '\0') {
+		printf("PLUGIN: settings: invalid number \"%s\" for %s\n", value, key);
+		return false;
+	}
+	*result = (unsigned int)parsed;
+	return true;
+}
+
+struct UnsignedSetting {
+	const char* key;
+	unsigned int PluginSettings::* value;
+};
+
+static const UnsignedSetting unsignedSettings[] = {
+	{ "batchWindowMs", &PluginSettings::batchWindowMs },
+	{ "batchMaxEvents", &PluginSettings::batchMaxEvents },
+	{ "laneMaxEvents", &PluginSettings::laneMaxEvents },
+	{ "backgroundSummaryMs", &PluginSettings::backgroundSummaryMs },
+	{ "talkStopHoldMs", &PluginSettings::talkStopHoldMs },
+	{ "sinkPort", &PluginSettings::sinkPort },
+	{ "sinkShmSizeKB", &PluginSettings::sinkShmSizeKB },
+	{ "sinkConnectTimeoutMs", &PluginSettings::sinkConnectTimeoutMs },
+	{ "sinkRequestTimeoutMs", &PluginSettings::sinkRequestTimeoutMs },
+	{ "breakerFailureThreshold", &PluginSettings::breakerFailureThreshold },
+	{ "breakerInitialBackoffMs", &PluginSettings::breakerInitialBackoffMs },
+	{ "breakerMaxBackoffMs", &PluginSettings::breakerMaxBackoffMs },
+	{ "voiceLevelRateHz", &PluginSettings::voiceLevelRateHz },
+	{ "captureLevelRateHz", &PluginSettings::captureLevelRateHz },
+	{ "spectrumBands", &PluginSettings::spectrumBands },
+	{ "spectrumRateHz", &PluginSettings::spectrumRateHz },
+	{ "hookLog", &PluginSettings::hookLog },
+	{ "hookLogAudio", &PluginSettings::hookLogAudio },
+	{ "hookLogMaxMB", &PluginSettings::hookLogMaxMB },
+	{ "trace", &PluginSettings::trace },
+	{ "traceSpansPerThread", &PluginSettings::traceSpansPerThread },
+};
+
+static const char* const sinkTransportNames[] = { "http", "udp", "tcp", "unix", "shm" };
+static const char* const payloadEncodingNames[] = { "json", "msgpack" };
+
+static_assert((size_t)AuroraEvent::count <= 32, "subscribedEvents holds a bit per event");
+
+static bool findEvent(const char* name, size_t length, AuroraEvent* result) {
+	for (unsigned int i = 0; i < (unsigned int)AuroraEvent::count; i++) {
+		const char* eventName = auroraEventName((AuroraEvent)i);
+		if (strlen(eventName) == length && !strncmp(name, eventName, length)) {
+			*result = (AuroraEvent)i;
+			return true;
+		}
+	}
+	return false;
+}
+
+static bool findField(const char* name, size_t length, EventFieldTag* result) {
+	for (unsigned int i = 0; i < (unsigned int)EventFieldTag::count; i++) {
+		const char* fieldName = eventFieldName((EventFieldTag)i);
+		if (strlen(fieldName) == length && !strncmp(name, fieldName, length)) {
+			*result = (EventFieldTag)i;
+			return true;
+		}
+	}
+	return false;
+}
+
+/* Calls item for every name of a comma or space separated list */
+template <typename F>
+static void forEachListItem(const char* list, F item) {
+	while (*list) {
+		const size_t length = strcspn(list, ", \t");
+		if (length) {
+			item(list, length);
+		}
+		list += length;
+		list += strspn(list, ", \t");
+	}
+}
+
+/* events = all, or the event names that are sent */
+static void parseEvents(const char* key, const char* value) {
+	if (!strcmp(value, "all")) {
+		pluginSettings.subscribedEvents = (1u << (unsigned int)AuroraEvent::count) - 1;
+		return;
+	}
+	pluginSettings.subscribedEvents = 0;
+	forEachListItem(value, [key](const char* name, size_t length) {
+		AuroraEvent event;
+		if (findEvent(name, length, &event)) {
+			pluginSettings.subscribedEvents |= 1u << (unsigned int)event;
+		}
+		else {
+			printf("PLUGIN: settings: unknown event \"%.*s\" for %s\n", (int)length, name, key);
+		}
+	});
+}
+
+/* omitFields = field names left out of every event, or event.field for a single event type */
+static void parseOmittedFields(const char* key, const char* value) {
+	for (uint64_t& omitted : pluginSettings.omittedFields) {
+		omitted = 0;
+	}
+	forEachListItem(value, [key](const char* name, size_t length) {
+		const char* dot = (const char*)memchr(name, '.', length);
+		const char* fieldName = dot ? dot + 1 : name;
+		const size_t fieldLength = length - (size_t)(fieldName - name);
+		AuroraEvent event = AuroraEvent::count;
+		EventFieldTag field;
+		if ((dot && !findEvent(name, (size_t)(dot - name), &event)) || !findField(fieldName, fieldLength, &field)) {
+			printf("PLUGIN: settings: unknown field \"%.*s\" for %s\n", (int)length, name, key);
+			return;
+		}
+		for (unsigned int i = 0; i < (unsigned int)AuroraEvent::count; i++) {
+			if (!dot || (AuroraEvent)i == event) {
+				pluginSettings.omittedFields[i] |= (uint64_t)1 << (unsigned int)field;
+			}
+		}
+	});
+}
+
+static void applySetting(const char* key, const char* value) {
+	for (const UnsignedSetting& setting : unsignedSettings) {
+		if (!strcmp(key, setting.key)) {
+			parseUnsigned(key, value, &(pluginSettings.*setting.value));
+			return;
+		}
+	}
+
+	if (!strcmp(key, "sinkTransport")) {
+		for (unsigned int i = 0; i < sizeof(sinkTransportNames) / sizeof(sinkTransportNames[0]); i++) {
+			if (!strcmp(value, sinkTransportNames[i])) {
+				pluginSettings.sinkTransport = (SinkTransport)i;
+				return;
+			}
+		}
+		printf("PLUGIN: settings: invalid transport \"%s\" for %s\n", value, key);
+		return;
+	}
+	if (!strcmp(key, "sinkEncoding")) {
+		for (unsigned int i = 0; i < sizeof(payloadEncodingNames) / sizeof(payloadEncodingNames[0]); i++) {
+			if (!strcmp(value, payloadEncodingNames[i])) {
+				pluginSettings.sinkEncoding = (PayloadEncoding)i;
+				return;
+			}
+		}
+		printf("PLUGIN: settings: invalid encoding \"%s\" for %s\n", value, key);
+		return;
+	}
+	if (!strcmp(key, "events")) {
+		parseEvents(key, value);
+		return;
+	}
+	if (!strcmp(key, "omitFields")) {
+		parseOmittedFields(key, value);
+		return;
+	}
+	if (!strcmp(key, "sinkSocketPath")) {
+		pluginSettings.sinkSocketPath = value;
+		return;
+	}
+	if (!strcmp(key, "sinkShmName")) {
+		pluginSettings.sinkShmName = value;
+		return;
+	}
+
+	printf("PLUGIN: settings: unknown key %s\n", key);
+}
+
+void loadPluginSettings(const char* configPath) {
+	char path[SETTINGS_PATH_BUFSIZE];
+	snprintf(path, sizeof(path), "%s%s", configPath, SETTINGS_FILE_NAME);
+
+	FILE* file = fopen(path, "r");
+	if (!file) {
+		printf("PLUGIN: no %s found, using default settings\n", path);
+		return;
+	}
+
+	char line[SETTINGS_LINE_BUFSIZE];
+	while (fgets(line, sizeof(line), file)) {
+		char* comment = strpbrk(line, "#;");
+		if (comment) {
+			*comment = '\0';
+		}
+		char* separator = strchr(line, '=');
+		if (!separator) {
+			continue;
+		}
+		*separator = '\0';
+
+		char* key = trim(line);
+		char* value = trim(separator + 1);
+		if (*key) {
+			applySetting(key, value);
+		}
+	}
+
+	fclose(file);
+
+	// Nobody listens to the audio events, so their taps stay off
+	if (!eventSubscribed(AuroraEvent::voiceLevel)) {
+		pluginSettings.voiceLevelRateHz = 0;
+	}
+	if (!eventSubscribed(AuroraEvent::captureLevel)) {
+		pluginSettings.captureLevelRateHz = 0;
+	}
+	if (!eventSubscribed(AuroraEvent::spectrum)) {
+		pluginSettings.spectrumRateHz = 0;
+	}
+	printf("PLUGIN: settings loaded from %s\n", path);
+}
@@ -0,0 +1,167 @@
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+#endif
+
+#include "shmSink.hpp"
+
+ShmRingSink::ShmRingSink(const char* name, size_t capacity) : name(name), capacity(capacity), nextSequence(0), ring(nullptr), data(nullptr)
+#ifdef _WIN32
+	, mapping(nullptr), wakeEvent(nullptr)
+#endif
+{
+	// Records are 8 byte aligned, so is the ring
+	this->capacity &= ~(uint64_t)(SHM_RING_ALIGNMENT - 1);
+	if (this->capacity < SHM_RING_MIN_CAPACITY) {
+		this->capacity = SHM_RING_MIN_CAPACITY;
+	}
+	open();
+}
+
+ShmRingSink::~ShmRingSink() {
+	close();
+}
+
+bool ShmRingSink::open() {
+	const size_t segmentSize = shmSegmentSize(capacity);
+	bool existing = false;
+#ifdef _WIN32
+	std::string mappingName = "Local\\" + name;
+	mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, (DWORD)((unsigned long long)segmentSize >> 32), (DWORD)segmentSize, mappingName.c_str());
+	if (!mapping) {
+		fprintf(stderr, "PLUGIN: could not create shared memory %s (%lu)\n", mappingName.c_str(), GetLastError());
+		return false;
+	}
+	// A reader still holding the segment of an earlier run keeps it alive, the ring then continues where it stopped
+	existing = GetLastError() == ERROR_ALREADY_EXISTS;
+	ring = (ShmRingHeader*)MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, segmentSize);
+	if (!ring) {
+		fprintf(stderr, "PLUGIN: could not map shared memory %s (%lu)\n", mappingName.c_str(), GetLastError());
+		close();
+		return false;
+	}
+	wakeEvent = CreateEventA(nullptr, FALSE, FALSE, (mappingName + "_wake").c_str());
+#else
+	// A fresh segment every time, a reader still mapping the old one notices writerClosed or the replaced name
+	std::string segmentName = "/" + name;
+	shm_unlink(segmentName.c_str());
+	int file = shm_open(segmentName.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+	if (file < 0) {
+		fprintf(stderr, "PLUGIN: could not create shared memory %s\n", segmentName.c_str());
+		return false;
+	}
+	void* address = MAP_FAILED;
+	if (ftruncate(file, (off_t)segmentSize) == 0) {
+		address = mmap(nullptr, segmentSize, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+	}
+	::close(file);
+	if (address == MAP_FAILED) {
+		fprintf(stderr, "PLUGIN: could not map shared memory %s\n", segmentName.c_str());
+		shm_unlink(segmentName.c_str());
+		return false;
+	}
+	ring = (ShmRingHeader*)address;
+#endif
+
+	if (existing && ring->version.load(std::memory_order_acquire) == SHM_RING_VERSION) {
+		if (ring->capacity != capacity) {
+			fprintf(stderr, "PLUGIN: shared memory %s is in use with a different size\n", name.c_str());
+			close();
+			return false;
+		}
+		ring->writerClosed.store(0);
+	}
+	else {
+		memcpy(ring->magic, SHM_RING_MAGIC, sizeof(ring->magic));
+		ring->dataOffset = (uint32_t)(segmentSize - capacity);
+		ring->capacity = capacity;
+		ring->writerClosed.store(0, std::memory_order_relaxed);
+		ring->writePosition.store(0, std::memory_order_relaxed);
+		ring->droppedPayloads.store(0, std::memory_order_relaxed);
+		ring->wakeCounter.store(0, std::memory_order_relaxed);
+		ring->readPosition.store(0, std::memory_order_relaxed);
+		ring->readerWaiting.store(0, std::memory_order_relaxed);
+		ring->version.store(SHM_RING_VERSION, std::memory_order_release);
+	}
+	data = (char*)ring + ring->dataOffset;
+	return true;
+}
+
+void ShmRingSink::close() {
+	if (ring) {
+		ring->writerClosed.store(1);
+		ring->wakeCounter.fetch_add(1);
+		wakeReader();
+#ifdef _WIN32
+		UnmapViewOfFile(ring);
+#else
+		munmap(ring, shmSegmentSize(capacity));
+		shm_unlink(("/" + name).c_str());
+#endif
+		ring = nullptr;
+		data = nullptr;
+	}
+#ifdef _WIN32
+	if (wakeEvent) {
+		CloseHandle(wakeEvent);
+		wakeEvent = nullptr;
+	}
+	if (mapping) {
+		CloseHandle(mapping);
+		mapping = nullptr;
+	}
+#endif
+}
+
+void ShmRingSink::wakeReader() {
+#ifdef _WIN32
+	if (wakeEvent) {
+		SetEvent(wakeEvent);
+	}
+#elif defined(__linux__)
+	syscall(SYS_futex, (uint32_t*)&ring->wakeCounter, FUTEX_WAKE, 1, nullptr, nullptr, 0);
+#endif
+}
+
+bool ShmRingSink::post(const char* payload, size_t length) {
+	if (length > maxPayload() || (!ring && !open())) {
+		return false;
+	}
+	const uint64_t sequence = nextSequence++;
+	const uint64_t recordSize = shmRecordSize(length);
+	const uint64_t write = ring->writePosition.load(std::memory_order_relaxed);
+	const uint64_t tail = capacity - write % capacity;
+	const uint64_t skip = tail < recordSize ? tail : 0;
+
+	if (write + skip + recordSize - ring->readPosition.load(std::memory_order_acquire) > capacity) {
+		ring->droppedPayloads.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	if (skip >= sizeof(ShmRecordHeader)) {
+		ShmRecordHeader padding = { (uint32_t)(skip - sizeof(ShmRecordHeader)), SHM_RECORD_PADDING, 0 };
+		memcpy(data + write % capacity, &padding, sizeof(padding));
+	}
+	char* record = data + (write + skip) % capacity;
+	ShmRecordHeader header = { (uint32_t)length, SHM_RECORD_PAYLOAD, sequence };
+	memcpy(record, &header, sizeof(header));
+	memcpy(record + sizeof(header), payload, length);
+
+	// Publishing and checking readerWaiting pair up with the reader's store and check, one side always sees the other
+	ring->writePosition.store(write + skip + recordSize, std::memory_order_seq_cst);
+	if (ring->readerWaiting.load(std::memory_order_seq_cst)) {
+		ring->wakeCounter.fetch_add(1);
+		wakeReader();
+	}
+	return true;
+}
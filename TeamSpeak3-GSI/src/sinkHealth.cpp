@@ -0,0 +1,58 @@
+#include <stdio.h>
+
+#include "sinkHealth.hpp"
+
+SinkHealth::SinkHealth(unsigned int failureThreshold, unsigned int initialBackoffMs, unsigned int maxBackoffMs) :
+	failureThreshold(failureThreshold ? failureThreshold : 1),
+	initialBackoff(initialBackoffMs),
+	maxBackoff(maxBackoffMs > initialBackoffMs ? maxBackoffMs : initialBackoffMs),
+	currentState(CLOSED),
+	consecutiveFailures(0),
+	backoff(initialBackoffMs) {
+}
+
+bool SinkHealth::allowRequest(Clock::time_point now) {
+	switch (currentState) {
+	case CLOSED:
+		return true;
+	case OPEN:
+		if (now < retryAt) {
+			return false;
+		}
+		// Backoff is over, let exactly one probe through
+		currentState = HALF_OPEN;
+		return true;
+	case HALF_OPEN:
+	default:
+		return false;
+	}
+}
+
+void SinkHealth::recordSuccess() {
+	if (currentState != CLOSED) {
+		printf("PLUGIN: Aurora is reachable again, resuming delivery\n");
+	}
+	currentState = CLOSED;
+	consecutiveFailures = 0;
+	backoff = initialBackoff;
+}
+
+void SinkHealth::recordFailure(Clock::time_point now) {
+	if (currentState == HALF_OPEN) {
+		// Probe failed, wait longer before the next one
+		backoff = backoff * 2 < maxBackoff ? backoff * 2 : maxBackoff;
+		open(now);
+		return;
+	}
+
+	if (++consecutiveFailures >= failureThreshold) {
+		printf("PLUGIN: Aurora is not reachable, dropping events until it is back\n");
+		open(now);
+	}
+}
+
+void SinkHealth::open(Clock::time_point now) {
+	currentState = OPEN;
+	consecutiveFailures = 0;
+	retryAt = now + backoff;
+}
@@ -0,0 +1,277 @@
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#endif
+
+#include "socketSink.hpp"
+
+/*
+ * Thin portability layer over BSD sockets and Winsock.
+ * Winsock needs no WSAStartup of its own, curl_global_init in ts3plugin_init already did it.
+ */
+#ifdef _WIN32
+#define INVALID_SINK_SOCKET ((SinkSocket)INVALID_SOCKET)
+#define SEND_FLAGS 0
+
+static SOCKET nativeSocket(SinkSocket handle) {
+	return (SOCKET)handle;
+}
+
+static void closeSocket(SinkSocket handle) {
+	closesocket((SOCKET)handle);
+}
+
+static int lastSocketError() {
+	return WSAGetLastError();
+}
+
+static bool setNonBlocking(SinkSocket handle, bool enabled) {
+	u_long mode = enabled ? 1 : 0;
+	return ioctlsocket((SOCKET)handle, FIONBIO, &mode) == 0;
+}
+
+static bool connectInProgress(int error) {
+	return error == WSAEWOULDBLOCK;
+}
+
+static void setSendTimeout(SinkSocket handle, long timeoutMs) {
+	DWORD timeout = (DWORD)timeoutMs;
+	setsockopt((SOCKET)handle, SOL_SOCKET, SO_SNDTIMEO, (const char*)&timeout, sizeof(timeout));
+}
+
+static int pollSocket(SinkSocket handle, short events, int timeoutMs) {
+	WSAPOLLFD pollHandle = { (SOCKET)handle, events, 0 };
+	return WSAPoll(&pollHandle, 1, timeoutMs) > 0 ? pollHandle.revents : 0;
+}
+#else
+#define INVALID_SINK_SOCKET ((SinkSocket)-1)
+#ifdef MSG_NOSIGNAL
+#define SEND_FLAGS MSG_NOSIGNAL
+#else
+#define SEND_FLAGS 0
+#endif
+
+static int nativeSocket(SinkSocket handle) {
+	return handle;
+}
+
+static void closeSocket(SinkSocket handle) {
+	::close(handle);
+}
+
+static int lastSocketError() {
+	return errno;
+}
+
+static bool setNonBlocking(SinkSocket handle, bool enabled) {
+	int flags = fcntl(handle, F_GETFL, 0);
+	return flags >= 0 && fcntl(handle, F_SETFL, enabled ? flags | O_NONBLOCK : flags & ~O_NONBLOCK) == 0;
+}
+
+static bool connectInProgress(int error) {
+	return error == EINPROGRESS || error == EAGAIN;
+}
+
+static void setSendTimeout(SinkSocket handle, long timeoutMs) {
+	timeval timeout;
+	timeout.tv_sec = timeoutMs / 1000;
+	timeout.tv_usec = (timeoutMs % 1000) * 1000;
+	setsockopt(handle, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+}
+
+static int pollSocket(SinkSocket handle, short events, int timeoutMs) {
+	pollfd pollHandle = { handle, events, 0 };
+	return poll(&pollHandle, 1, timeoutMs) > 0 ? pollHandle.revents : 0;
+}
+#endif
+
+static sockaddr_in loopbackAddress(unsigned short port) {
+	sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_port = htons(port);
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	return address;
+}
+
+DatagramSink::DatagramSink(unsigned short port) : port(port), socketHandle(INVALID_SINK_SOCKET) {
+	open();
+}
+
+DatagramSink::~DatagramSink() {
+	close();
+}
+
+bool DatagramSink::open() {
+	socketHandle = (SinkSocket)socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if (socketHandle == INVALID_SINK_SOCKET) {
+		return false;
+	}
+	sockaddr_in address = loopbackAddress(port);
+	if (connect(nativeSocket(socketHandle), (const sockaddr*)&address, sizeof(address)) != 0) {
+		close();
+		return false;
+	}
+	return true;
+}
+
+void DatagramSink::close() {
+	if (socketHandle != INVALID_SINK_SOCKET) {
+		closeSocket(socketHandle);
+		socketHandle = INVALID_SINK_SOCKET;
+	}
+}
+
+bool DatagramSink::post(const char* payload, size_t length) {
+	if (length > DATAGRAM_SINK_MAX_PAYLOAD || (socketHandle == INVALID_SINK_SOCKET && !open())) {
+		return false;
+	}
+	// A refused earlier datagram is reported here, the payload itself may still have gone out
+	if (send(nativeSocket(socketHandle), payload, (int)length, SEND_FLAGS) != (int)length) {
+		fprintf(stderr, "PLUGIN: udp send failed (%d)\n", lastSocketError());
+		return false;
+	}
+	return true;
+}
+
+StreamSink::StreamSink(unsigned short port, const char* socketPath, long connectTimeoutMs, long sendTimeoutMs) :
+	port(port), socketPath(socketPath ? socketPath : ""), connectTimeoutMs(connectTimeoutMs), sendTimeoutMs(sendTimeoutMs), socketHandle(INVALID_SINK_SOCKET) {
+	connectSocket();
+}
+
+StreamSink::~StreamSink() {
+	close();
+}
+
+bool StreamSink::connectSocket() {
+	sockaddr_storage address;
+	socklen_t addressLength;
+	memset(&address, 0, sizeof(address));
+#ifndef _WIN32
+	if (!socketPath.empty()) {
+		sockaddr_un* local = (sockaddr_un*)&address;
+		if (socketPath.size() >= sizeof(local->sun_path)) {
+			fprintf(stderr, "PLUGIN: socket path %s is too long\n", socketPath.c_str());
+			return false;
+		}
+		local->sun_family = AF_UNIX;
+		memcpy(local->sun_path, socketPath.c_str(), socketPath.size() + 1);
+		addressLength = (socklen_t)sizeof(sockaddr_un);
+	}
+	else
+#endif
+	{
+		sockaddr_in loopback = loopbackAddress(port);
+		memcpy(&address, &loopback, sizeof(loopback));
+		addressLength = (socklen_t)sizeof(loopback);
+	}
+
+	socketHandle = (SinkSocket)socket(address.ss_family, SOCK_STREAM, 0);
+	if (socketHandle == INVALID_SINK_SOCKET) {
+		return false;
+	}
+	if (address.ss_family == AF_INET) {
+		int noDelay = 1;
+		setsockopt(nativeSocket(socketHandle), IPPROTO_TCP, TCP_NODELAY, (const char*)&noDelay, sizeof(noDelay));
+	}
+
+	// Connect without blocking longer than sinkConnectTimeoutMs, a hung Aurora must not hold the sender
+	setNonBlocking(socketHandle, true);
+	if (connect(nativeSocket(socketHandle), (const sockaddr*)&address, addressLength) != 0) {
+		if (!connectInProgress(lastSocketError()) || !(pollSocket(socketHandle, POLLOUT, (int)connectTimeoutMs) & POLLOUT)) {
+			close();
+			return false;
+		}
+		int error = 0;
+		socklen_t errorLength = sizeof(error);
+		getsockopt(nativeSocket(socketHandle), SOL_SOCKET, SO_ERROR, (char*)&error, &errorLength);
+		if (error != 0) {
+			close();
+			return false;
+		}
+	}
+	setNonBlocking(socketHandle, false);
+	setSendTimeout(socketHandle, sendTimeoutMs);
+	return true;
+}
+
+void StreamSink::close() {
+	if (socketHandle != INVALID_SINK_SOCKET) {
+		closeSocket(socketHandle);
+		socketHandle = INVALID_SINK_SOCKET;
+	}
+}
+
+/* Aurora never writes to us, so a readable socket means it closed its end */
+bool StreamSink::peerClosed() {
+	return pollSocket(socketHandle, POLLIN, 0) != 0;
+}
+
+bool StreamSink::sendFrame(const char* payload, size_t length) {
+	const unsigned char header[4] = {
+		(unsigned char)(length >> 24), (unsigned char)(length >> 16), (unsigned char)(length >> 8), (unsigned char)length
+	};
+	size_t headerLeft = sizeof(header);
+	size_t payloadLeft = length;
+
+	// Header and payload in one call, so small events go out as one segment
+	while (headerLeft + payloadLeft > 0) {
+		const char* headerPart = (const char*)header + sizeof(header) - headerLeft;
+		const char* payloadPart = payload + length - payloadLeft;
+#ifdef _WIN32
+		WSABUF buffers[2] = { { (ULONG)headerLeft, (CHAR*)headerPart }, { (ULONG)payloadLeft, (CHAR*)payloadPart } };
+		DWORD sent = 0;
+		if (WSASend((SOCKET)socketHandle, headerLeft ? buffers : buffers + 1, headerLeft ? 2 : 1, &sent, 0, nullptr, nullptr) != 0) {
+			return false;
+		}
+#else
+		iovec buffers[2] = { { (void*)headerPart, headerLeft }, { (void*)payloadPart, payloadLeft } };
+		msghdr message;
+		memset(&message, 0, sizeof(message));
+		message.msg_iov = headerLeft ? buffers : buffers + 1;
+		message.msg_iovlen = headerLeft ? 2 : 1;
+		ssize_t sent = sendmsg(socketHandle, &message, SEND_FLAGS);
+		if (sent <= 0) {
+			return false;
+		}
+#endif
+		size_t fromHeader = (size_t)sent < headerLeft ? (size_t)sent : headerLeft;
+		headerLeft -= fromHeader;
+		payloadLeft -= (size_t)sent - fromHeader;
+	}
+	return true;
+}
+
+bool StreamSink::post(const char* payload, size_t length) {
+	if ((uint64_t)length > 0xFFFFFFFFull) {
+		return false;
+	}
+	if (socketHandle != INVALID_SINK_SOCKET && peerClosed()) {
+		close();
+	}
+	if (socketHandle == INVALID_SINK_SOCKET && !connectSocket()) {
+		return false;
+	}
+	if (sendFrame(payload, length)) {
+		return true;
+	}
+
+	// A frame cut in half leaves the stream unusable, start over on a fresh connection
+	fprintf(stderr, "PLUGIN: stream send failed (%d)\n", lastSocketError());
+	close();
+	return false;
+}
@@ -0,0 +1,233 @@
+#include <math.h>
+#include <string.h>
+
+#include "spectrum.hpp"
+#include "audioLevel.hpp"
+
+#if defined(_M_X64) || defined(__SSE__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define SPECTRUM_SSE 1
+#endif
+
+#define SPECTRUM_HALF_SIZE (SPECTRUM_FFT_SIZE / 2)
+#define SPECTRUM_LOWEST_HZ 50.0
+#define SPECTRUM_HIGHEST_HZ 16000.0
+
+static const double pi = 3.14159265358979323846;
+
+SampleRing::SampleRing() : writePosition(0), readPosition(0), dropped(0) {
+	static_assert((SPECTRUM_RING_CAPACITY & (SPECTRUM_RING_CAPACITY - 1)) == 0, "Ring capacity must be a power of two");
+}
+
+size_t SampleRing::pushFrames(const short* input, size_t frames, int channels) {
+	const size_t write = writePosition.load(std::memory_order_relaxed);
+	const size_t read = readPosition.load(std::memory_order_acquire);
+	const size_t space = SPECTRUM_RING_CAPACITY - (write - read);
+	const size_t count = frames < space ? frames : space;
+	if (count < frames) {
+		dropped.fetch_add(frames - count, std::memory_order_relaxed);
+	}
+
+	if (channels >= 2) {
+		for (size_t i = 0; i < count; i++) {
+			samples[(write + i) & (SPECTRUM_RING_CAPACITY - 1)] = (short)((input[i * channels] + input[i * channels + 1]) >> 1);
+		}
+	}
+	else {
+		for (size_t i = 0; i < count; i++) {
+			samples[(write + i) & (SPECTRUM_RING_CAPACITY - 1)] = input[i];
+		}
+	}
+
+	writePosition.store(write + count, std::memory_order_release);
+	return count;
+}
+
+size_t SampleRing::popLatest(float* out, size_t maxCount) {
+	const size_t write = writePosition.load(std::memory_order_acquire);
+	size_t read = readPosition.load(std::memory_order_relaxed);
+	if (write - read > maxCount) {
+		read = write - maxCount;
+	}
+
+	const size_t count = write - read;
+	for (size_t i = 0; i < count; i++) {
+		out[i] = samples[(read + i) & (SPECTRUM_RING_CAPACITY - 1)] * (1.0f / 32768.0f);
+	}
+	readPosition.store(write, std::memory_order_release);
+	return count;
+}
+
+void SampleRing::clear() {
+	readPosition.store(writePosition.load(std::memory_order_acquire), std::memory_order_release);
+}
+
+SpectrumAnalyzer::SpectrumAnalyzer(unsigned int bands) :
+	bandCount(bands < 1 ? 1 : (bands > SPECTRUM_MAX_BANDS ? SPECTRUM_MAX_BANDS : bands)),
+	window(SPECTRUM_FFT_SIZE), history(SPECTRUM_FFT_SIZE, 0.0f),
+	real(SPECTRUM_HALF_SIZE), imaginary(SPECTRUM_HALF_SIZE), power(SPECTRUM_HALF_SIZE),
+	fftCos(SPECTRUM_HALF_SIZE / 2), fftSin(SPECTRUM_HALF_SIZE / 2), splitCos(SPECTRUM_HALF_SIZE), splitSin(SPECTRUM_HALF_SIZE),
+	bitReverse(SPECTRUM_HALF_SIZE), bandFirstBin(bandCount), bandEndBin(bandCount) {
+
+	for (size_t i = 0; i < SPECTRUM_FFT_SIZE; i++) {
+		window[i] = (float)(0.5 - 0.5 * cos(2.0 * pi * i / SPECTRUM_FFT_SIZE));
+	}
+	for (size_t i = 0; i < SPECTRUM_HALF_SIZE / 2; i++) {
+		fftCos[i] = (float)cos(2.0 * pi * i / SPECTRUM_HALF_SIZE);
+		fftSin[i] = (float)sin(2.0 * pi * i / SPECTRUM_HALF_SIZE);
+	}
+	for (size_t i = 0; i < SPECTRUM_HALF_SIZE; i++) {
+		splitCos[i] = (float)cos(2.0 * pi * i / SPECTRUM_FFT_SIZE);
+		splitSin[i] = (float)sin(2.0 * pi * i / SPECTRUM_FFT_SIZE);
+	}
+
+	unsigned int bits = 0;
+	while ((1u << bits) < SPECTRUM_HALF_SIZE) {
+		bits++;
+	}
+	for (unsigned int i = 0; i < SPECTRUM_HALF_SIZE; i++) {
+		unsigned int reversed = 0;
+		for (unsigned int bit = 0; bit < bits; bit++) {
+			reversed |= ((i >> bit) & 1) << (bits - 1 - bit);
+		}
+		bitReverse[i] = (unsigned short)reversed;
+	}
+
+	// Log spaced edges, but every band gets at least one bin of its own
+	const double binHz = (double)SPECTRUM_SAMPLE_RATE / SPECTRUM_FFT_SIZE;
+	unsigned int previousEnd = 1;
+	for (unsigned int band = 0; band < bandCount; band++) {
+		double upperHz = SPECTRUM_LOWEST_HZ * pow(SPECTRUM_HIGHEST_HZ / SPECTRUM_LOWEST_HZ, (band + 1.0) / bandCount);
+		unsigned int end = (unsigned int)(upperHz / binHz + 0.5);
+		if (end <= previousEnd) {
+			end = previousEnd + 1;
+		}
+		if (end > SPECTRUM_HALF_SIZE) {
+			end = SPECTRUM_HALF_SIZE;
+		}
+		bandFirstBin[band] = (unsigned short)(previousEnd < end ? previousEnd : end - 1);
+		bandEndBin[band] = (unsigned short)end;
+		previousEnd = end;
+	}
+}
+
+void SpectrumAnalyzer::addSamples(const float* samples, size_t count) {
+	if (count >= SPECTRUM_FFT_SIZE) {
+		memcpy(history.data(), samples + count - SPECTRUM_FFT_SIZE, SPECTRUM_FFT_SIZE * sizeof(float));
+		return;
+	}
+	memmove(history.data(), history.data() + count, (SPECTRUM_FFT_SIZE - count) * sizeof(float));
+	memcpy(history.data() + SPECTRUM_FFT_SIZE - count, samples, count * sizeof(float));
+}
+
+/* |X|^2 of split complex bins, four at a time with SSE */
+static void binPowers(const float* real, const float* imaginary, float* power, size_t count) {
+	size_t i = 0;
+#ifdef SPECTRUM_SSE
+	const size_t vectorCount = count & ~(size_t)3;
+	for (; i < vectorCount; i += 4) {
+		__m128 re = _mm_loadu_ps(real + i);
+		__m128 im = _mm_loadu_ps(imaginary + i);
+		_mm_storeu_ps(power + i, _mm_add_ps(_mm_mul_ps(re, re), _mm_mul_ps(im, im)));
+	}
+#endif
+	for (; i < count; i++) {
+		power[i] = real[i] * real[i] + imaginary[i] * imaginary[i];
+	}
+}
+
+/*
+ * Real FFT of SPECTRUM_FFT_SIZE samples as a complex FFT of half the size: even samples go into the real part,
+ * odd samples into the imaginary part, and a split step with its own twiddles untangles the two afterwards.
+ * Leaves the power of bins 0..N/2-1 in power.
+ */
+void SpectrumAnalyzer::transform(const float* input) {
+	for (size_t i = 0; i < SPECTRUM_HALF_SIZE; i++) {
+		real[bitReverse[i]] = input[2 * i];
+		imaginary[bitReverse[i]] = input[2 * i + 1];
+	}
+
+	// Iterative radix-2 decimation in time
+	for (size_t size = 2; size <= SPECTRUM_HALF_SIZE; size *= 2) {
+		const size_t half = size / 2;
+		const size_t twiddleStep = SPECTRUM_HALF_SIZE / size;
+		for (size_t start = 0; start < SPECTRUM_HALF_SIZE; start += size) {
+			for (size_t j = 0; j < half; j++) {
+				const float wr = fftCos[j * twiddleStep];
+				const float wi = -fftSin[j * twiddleStep];
+				const size_t a = start + j;
+				const size_t b = a + half;
+				const float tr = wr * real[b] - wi * imaginary[b];
+				const float ti = wr * imaginary[b] + wi * real[b];
+				real[b] = real[a] - tr;
+				imaginary[b] = imaginary[a] - ti;
+				real[a] += tr;
+				imaginary[a] += ti;
+			}
+		}
+	}
+
+	// Split step, bins k and N/2-k use each other's values, so they are computed in pairs
+	float* outReal = power.data();
+	float outImaginary[SPECTRUM_HALF_SIZE];
+	for (size_t k = 0; k <= SPECTRUM_HALF_SIZE / 2; k++) {
+		const size_t mirror = (SPECTRUM_HALF_SIZE - k) & (SPECTRUM_HALF_SIZE - 1);
+		const float zr = real[k];
+		const float zi = imaginary[k];
+		const float mr = real[mirror];
+		const float mi = imaginary[mirror];
+
+		// Bin k
+		float evenR = 0.5f * (zr + mr);
+		float evenI = 0.5f * (zi - mi);
+		float oddR = 0.5f * (zi + mi);
+		float oddI = -0.5f * (zr - mr);
+		float tr = splitCos[k];
+		float ti = -splitSin[k];
+		outReal[k] = evenR + tr * oddR - ti * oddI;
+		outImaginary[k] = evenI + tr * oddI + ti * oddR;
+
+		// Bin N/2-k
+		if (mirror != k && mirror != 0) {
+			evenR = 0.5f * (mr + zr);
+			evenI = 0.5f * (mi - zi);
+			oddR = 0.5f * (mi + zi);
+			oddI = -0.5f * (mr - zr);
+			tr = splitCos[mirror];
+			ti = -splitSin[mirror];
+			outReal[mirror] = evenR + tr * oddR - ti * oddI;
+			outImaginary[mirror] = evenI + tr * oddI + ti * oddR;
+		}
+	}
+	binPowers(outReal, outImaginary, power.data(), SPECTRUM_HALF_SIZE);
+}
+
+void SpectrumAnalyzer::powerSpectrum(const float* input, float* binPowerOut) {
+	transform(input);
+	memcpy(binPowerOut, power.data(), SPECTRUM_HALF_SIZE * sizeof(float));
+}
+
+void SpectrumAnalyzer::analyze(float* levels) {
+	float windowed[SPECTRUM_FFT_SIZE];
+#ifdef SPECTRUM_SSE
+	for (size_t i = 0; i < SPECTRUM_FFT_SIZE; i += 4) {
+		_mm_storeu_ps(windowed + i, _mm_mul_ps(_mm_loadu_ps(history.data() + i), _mm_loadu_ps(window.data() + i)));
+	}
+#else
+	for (size_t i = 0; i < SPECTRUM_FFT_SIZE; i++) {
+		windowed[i] = history[i] * window[i];
+	}
+#endif
+	transform(windowed);
+
+	// A full scale sine through the Hann window spreads 3 N^2 / 32 of power over its neighbouring bins, that is level 100
+	const float reference = 32.0f / (3.0f * SPECTRUM_FFT_SIZE * SPECTRUM_FFT_SIZE);
+	for (unsigned int band = 0; band < bandCount; band++) {
+		float energy = 0.0f;
+		for (unsigned int bin = bandFirstBin[band]; bin < bandEndBin[band]; bin++) {
+			energy += power[bin];
+		}
+		const float level = audioLoudnessScale(sqrtf(energy * reference));
+		levels[band] = level < 100.0f ? level : 100.0f;
+	}
+}
@@ -0,0 +1,141 @@
+#include <stddef.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "eventHooks.hpp"
+#include "spectrum.hpp"
+#include "spectrumPublisher.hpp"
+#include "settings.hpp"
+
+// Aurora renders at most this many frames per second, faster updates would never be seen
+#define SPECTRUM_MAX_RATE_HZ 60
+// Points of the 0..100 scale a band falls per second once it got quieter
+#define SPECTRUM_RELEASE_PER_SECOND 200.0f
+// Analysis ticks without audio before the current connection gives up the ring
+#define SPECTRUM_IDLE_SECONDS 1
+
+static SampleRing playbackRing;
+// Connection whose mixed playback feeds the ring, 0 while nobody plays audio
+static std::atomic<uint64> ringConnection(0);
+static std::atomic<bool> analyzerRunning(false);
+
+static std::thread analyzerThread;
+static std::mutex analyzerStopMutex;
+static std::condition_variable analyzerStopCondition;
+
+static unsigned int spectrumRateHz() {
+	unsigned int rateHz = pluginSettings.spectrumRateHz;
+	return rateHz > SPECTRUM_MAX_RATE_HZ ? SPECTRUM_MAX_RATE_HZ : rateHz;
+}
+
+void recordMixedPlayback(uint64 serverConnectionHandlerID, const short* samples, int sampleCount, int channels) {
+	if (sampleCount <= 0 || channels <= 0 || !analyzerRunning.load(std::memory_order_relaxed)) {
+		return;
+	}
+	uint64 owner = ringConnection.load(std::memory_order_relaxed);
+	if (owner != serverConnectionHandlerID) {
+		if (owner != 0 || !ringConnection.compare_exchange_strong(owner, serverConnectionHandlerID, std::memory_order_relaxed)) {
+			return;
+		}
+	}
+	playbackRing.pushFrames(samples, (size_t)sampleCount, channels);
+}
+
+static void analyzerLoop() {
+	const unsigned int rateHz = spectrumRateHz();
+	const std::chrono::microseconds period(1000000 / rateHz);
+	const float release = SPECTRUM_RELEASE_PER_SECOND / rateHz;
+
+	SpectrumAnalyzer analyzer(pluginSettings.spectrumBands);
+	const unsigned int bandCount = analyzer.bands();
+	float fresh[SPECTRUM_FFT_SIZE];
+	float measured[SPECTRUM_MAX_BANDS];
+	float levels[SPECTRUM_MAX_BANDS] = {};
+	unsigned int sentLevels[SPECTRUM_MAX_BANDS] = {};
+	unsigned int idleTicks = 0;
+	uint64 serverConnectionHandlerID = 0;
+
+	std::chrono::steady_clock::time_point due = std::chrono::steady_clock::now();
+	std::unique_lock<std::mutex> lock(analyzerStopMutex);
+	while (analyzerRunning.load()) {
+		due += period;
+		analyzerStopCondition.wait_until(lock, due, [] { return !analyzerRunning.load(); });
+		if (!analyzerRunning.load()) {
+			break;
+		}
+
+		// Behind by more than a tick, e.g. after a suspend: skip ahead instead of catching up
+		const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		if (now - due > period) {
+			due = now;
+		}
+
+		const uint64 owner = ringConnection.load(std::memory_order_relaxed);
+		const size_t count = playbackRing.popLatest(fresh, SPECTRUM_FFT_SIZE);
+		if (count) {
+			idleTicks = 0;
+			serverConnectionHandlerID = owner;
+			analyzer.addSamples(fresh, count);
+			analyzer.analyze(measured);
+		}
+		else {
+			// Silence, let the bands fall and hand the ring to whoever plays next
+			for (unsigned int band = 0; band < bandCount; band++) {
+				measured[band] = 0.0f;
+			}
+			if (owner && ++idleTicks >= rateHz * SPECTRUM_IDLE_SECONDS) {
+				uint64 expected = owner;
+				ringConnection.compare_exchange_strong(expected, 0, std::memory_order_relaxed);
+				idleTicks = 0;
+			}
+		}
+
+		bool changed = false;
+		for (unsigned int band = 0; band < bandCount; band++) {
+			levels[band] = measured[band] > levels[band] - release ? measured[band] : levels[band] - release;
+			unsigned int rounded = levels[band] > 0.0f ? (unsigned int)(levels[band] + 0.5f) : 0;
+			changed |= rounded != sentLevels[band];
+			sentLevels[band] = rounded;
+		}
+		if (!changed || !serverConnectionHandlerID) {
+			continue;
+		}
+
+		auto bands = makeEventValueWriter([&sentLevels, bandCount](auto& writer) {
+			writer.StartArray();
+			for (unsigned int band = 0; band < bandCount; band++) {
+				writer.Uint(sentLevels[band]);
+			}
+			writer.EndArray();
+		});
+		SEND_LATEST_EVENT_TO_AURORA(latestOnly(AuroraEvent::spectrum, serverConnectionHandlerID, 0), spectrum,
+			EVENT_FIELD(serverConnectionHandlerID),
+			EVENT_FIELD(bands));
+	}
+}
+
+void startSpectrumAnalyzer() {
+	if (!pluginSettings.spectrumBands || !spectrumRateHz() || analyzerRunning.exchange(true)) {
+		return;
+	}
+	playbackRing.clear();
+	analyzerThread = std::thread(analyzerLoop);
+}
+
+void stopSpectrumAnalyzer() {
+	if (!analyzerRunning.exchange(false)) {
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(analyzerStopMutex);
+		analyzerStopCondition.notify_one();
+	}
+	if (analyzerThread.joinable()) {
+		analyzerThread.join();
+	}
+	ringConnection.store(0);
+}
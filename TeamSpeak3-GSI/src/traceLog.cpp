@@ -0,0 +1,189 @@
+#include <stdio.h>
+#include <time.h>
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "traceLog.hpp"
+#include "pluginMetrics.hpp"
+#include "settings.hpp"
+
+#define TRACE_LOG_PATH_BUFSIZE 1024
+
+std::atomic<bool> traceActive(false);
+
+struct TraceRecord {
+	const char* name;
+	uint64_t startNs;
+	uint64_t endNs;
+	uint32_t count;
+	TraceCategory category;
+	bool async;
+};
+
+/* Spans of one thread. Only that thread appends, count is published with release so the writer at shutdown sees whole records */
+struct TraceBuffer {
+	std::unique_ptr<TraceRecord[]> records;
+	size_t capacity;
+	std::atomic<size_t> count;
+	std::atomic<uint64_t> dropped;
+	unsigned int track;
+	std::string threadName;
+};
+
+static std::mutex traceMutex;
+static std::vector<std::unique_ptr<TraceBuffer>> traceBuffers;
+static std::string tracePath;
+static uint64_t traceStartNs = 0;
+// Bumped by every stop, so threads do not keep buffers of an earlier trace
+static std::atomic<unsigned int> traceGeneration(0);
+
+static thread_local TraceBuffer* threadTraceBuffer = nullptr;
+static thread_local unsigned int threadTraceGeneration = 0;
+
+static const char* const traceCategoryNames[] = { "hook", "serialize", "queue", "send" };
+
+/* The calling thread's buffer, created on its first span. nullptr once tracing stopped */
+static TraceBuffer* traceBuffer() {
+	const unsigned int generation = traceGeneration.load(std::memory_order_acquire);
+	if (threadTraceBuffer && threadTraceGeneration == generation) {
+		return threadTraceBuffer;
+	}
+
+	std::lock_guard<std::mutex> lock(traceMutex);
+	if (!traceActive.load()) {
+		return nullptr;
+	}
+	std::unique_ptr<TraceBuffer> buffer(new TraceBuffer());
+	buffer->capacity = pluginSettings.traceSpansPerThread;
+	buffer->records.reset(new TraceRecord[buffer->capacity]);
+	buffer->count.store(0, std::memory_order_relaxed);
+	buffer->dropped.store(0, std::memory_order_relaxed);
+	buffer->track = (unsigned int)traceBuffers.size() + 1;
+	buffer->threadName = "TeamSpeak thread " + std::to_string(buffer->track);
+	threadTraceBuffer = buffer.get();
+	threadTraceGeneration = generation;
+	traceBuffers.push_back(std::move(buffer));
+	return threadTraceBuffer;
+}
+
+static void appendTraceRecord(const TraceRecord& record) {
+	TraceBuffer* buffer = traceBuffer();
+	if (!buffer) {
+		return;
+	}
+	const size_t index = buffer->count.load(std::memory_order_relaxed);
+	if (index == buffer->capacity) {
+		buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+	buffer->records[index] = record;
+	buffer->count.store(index + 1, std::memory_order_release);
+}
+
+void traceSpan(TraceCategory category, const char* name, uint64_t startNs, uint64_t endNs, uint32_t count) {
+	appendTraceRecord(TraceRecord{ name, startNs, endNs, count, category, false });
+}
+
+void traceAsyncSpan(TraceCategory category, const char* name, uint64_t startNs, uint64_t endNs) {
+	appendTraceRecord(TraceRecord{ name, startNs, endNs, 0, category, true });
+}
+
+uint64_t traceNowNs() {
+	return metricsNowNs();
+}
+
+void TraceScope::finish() {
+	traceSpan(category, name, startNs, metricsNowNs());
+}
+
+void setTraceThreadName(const char* name) {
+	if (!tracing()) {
+		return;
+	}
+	TraceBuffer* buffer = traceBuffer();
+	if (buffer) {
+		std::lock_guard<std::mutex> lock(traceMutex);
+		buffer->threadName = name;
+	}
+}
+
+void startTraceLog(const char* configPath) {
+	if (!pluginSettings.trace || pluginSettings.traceSpansPerThread == 0 || tracing()) {
+		return;
+	}
+
+	char path[TRACE_LOG_PATH_BUFSIZE];
+	char stamp[32];
+	time_t now = time(nullptr);
+	strftime(stamp, sizeof(stamp), "%Y%m%d_%H%M%S", localtime(&now));
+	snprintf(path, sizeof(path), "%saurora_gsi_trace_%s.json", configPath, stamp);
+
+	std::lock_guard<std::mutex> lock(traceMutex);
+	tracePath = path;
+	traceStartNs = metricsNowNs();
+	traceActive.store(true);
+	printf("PLUGIN: tracing to %s at shutdown\n", path);
+}
+
+/* Microseconds since the trace started, spans of hooks that were already running count from the start */
+static double traceTimestampUs(uint64_t ns) {
+	return ns > traceStartNs ? (ns - traceStartNs) / 1000.0 : 0.0;
+}
+
+static void writeTraceRecord(FILE* file, const TraceRecord& record, unsigned int track, unsigned long long& asyncID) {
+	const char* category = traceCategoryNames[(size_t)record.category];
+	const double start = traceTimestampUs(record.startNs);
+	const double end = traceTimestampUs(record.endNs);
+	if (record.async) {
+		asyncID++;
+		fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"b\",\"id\":%llu,\"pid\":1,\"tid\":%u,\"ts\":%.3f}", record.name, category, asyncID, track, start);
+		fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"e\",\"id\":%llu,\"pid\":1,\"tid\":%u,\"ts\":%.3f}", record.name, category, asyncID, track, end);
+	}
+	else {
+		fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f", record.name, category, track, start, end - start);
+		if (record.count) {
+			fprintf(file, ",\"args\":{\"events\":%u}", record.count);
+		}
+		fputc('}', file);
+	}
+}
+
+void stopTraceLog() {
+	if (!traceActive.exchange(false)) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(traceMutex);
+	FILE* file = fopen(tracePath.c_str(), "wb");
+	if (!file) {
+		printf("PLUGIN: trace: could not create %s\n", tracePath.c_str());
+	}
+	else {
+		size_t spans = 0;
+		unsigned long long dropped = 0;
+		unsigned long long asyncID = 0;
+		fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"Aurora GSI\"}}");
+		for (const std::unique_ptr<TraceBuffer>& buffer : traceBuffers) {
+			fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}", buffer->track, buffer->threadName.c_str());
+			const size_t count = buffer->count.load(std::memory_order_acquire);
+			for (size_t i = 0; i < count; i++) {
+				writeTraceRecord(file, buffer->records[i], buffer->track, asyncID);
+			}
+			spans += count;
+			dropped += buffer->dropped.load(std::memory_order_relaxed);
+		}
+		fprintf(file, "\n]}\n");
+		fclose(file);
+		printf("PLUGIN: trace of %zu spans written to %s", spans, tracePath.c_str());
+		if (dropped) {
+			printf(", %llu spans dropped (traceSpansPerThread)", dropped);
+		}
+		printf("\n");
+	}
+
+	traceBuffers.clear();
+	traceGeneration.fetch_add(1, std::memory_order_release);
+}
@@ -0,0 +1,171 @@
+#include <stddef.h>
+
+#include <atomic>
+
+#include "eventHooks.hpp"
+#include "audioLevel.hpp"
+#include "voiceLevel.hpp"
+#include "settings.hpp"
+
+// Clients metered at the same time, more than ever talk on one server in practice
+#define VOICE_LEVEL_SLOT_BITS 7
+#define VOICE_LEVEL_SLOTS (1 << VOICE_LEVEL_SLOT_BITS)
+// Set in a published value the sender has not read yet
+#define VOICE_LEVEL_UNREAD (1ULL << 32)
+// How fast the reported level falls once a client got quieter, in points of the 0..100 scale per second
+#define VOICE_LEVEL_RELEASE_PER_SECOND 150.0f
+#define VOICE_LEVEL_MAX_RATE_HZ 100
+
+struct alignas(64) VoiceLevelSlot {
+	/* (serverConnectionHandlerID << 16) | clientID, 0 while free */
+	std::atomic<uint64_t> key;
+	/* VOICE_LEVEL_UNREAD | peak << 16 | rms, both linear 0..65535. Loudest buffer since the sender's last read */
+	std::atomic<uint64_t> published;
+
+	// Sender thread only
+	uint64_t ownerKey;
+	float loudness;
+	float peak;
+	unsigned int sentLoudness;
+	unsigned int sentPeak;
+};
+
+static VoiceLevelSlot voiceLevelSlots[VOICE_LEVEL_SLOTS];
+
+static uint64_t voiceLevelKey(uint64 serverConnectionHandlerID, anyID clientID) {
+	return ((serverConnectionHandlerID & 0xFFFFFFFFFFFFULL) << 16) | clientID;
+}
+
+/*
+ * Open addressing without tombstones: a lookup scans on past free slots, so freeing a slot never hides another client.
+ * Only a client's first buffer, or one that finds the table full, pays for a scan of every slot.
+ */
+static VoiceLevelSlot* findVoiceLevelSlot(uint64_t key, bool claim) {
+	const size_t start = (size_t)((key * 0x9E3779B97F4A7C15ULL) >> (64 - VOICE_LEVEL_SLOT_BITS));
+	VoiceLevelSlot* freeSlot = nullptr;
+	for (size_t i = 0; i < VOICE_LEVEL_SLOTS; i++) {
+		VoiceLevelSlot& slot = voiceLevelSlots[(start + i) & (VOICE_LEVEL_SLOTS - 1)];
+		uint64_t slotKey = slot.key.load(std::memory_order_acquire);
+		if (slotKey == key) {
+			return &slot;
+		}
+		if (slotKey == 0 && !freeSlot) {
+			freeSlot = &slot;
+		}
+	}
+
+	uint64_t expected = 0;
+	if (claim && freeSlot && freeSlot->key.compare_exchange_strong(expected, key, std::memory_order_acq_rel)) {
+		return freeSlot;
+	}
+	return nullptr;
+}
+
+static uint64_t packVoiceLevel(float rms, float peak) {
+	return ((uint64_t)(peak * 65535.0f + 0.5f) << 16) | (uint64_t)(rms * 65535.0f + 0.5f);
+}
+
+void recordVoiceLevel(uint64 serverConnectionHandlerID, anyID clientID, const short* samples, int sampleCount, int channels) {
+	if (sampleCount <= 0 || channels <= 0) {
+		return;
+	}
+	const size_t count = (size_t)sampleCount * (size_t)channels;
+	const AudioLevel level = measureAudioLevel(samples, count);
+	const uint64_t value = packVoiceLevel(audioLevelRms(level, count), audioLevelPeak(level));
+
+	VoiceLevelSlot* slot = findVoiceLevelSlot(voiceLevelKey(serverConnectionHandlerID, clientID), true);
+	if (!slot) {
+		return;
+	}
+
+	// Keep the loudest buffer until the sender picked it up, so short bursts between two samples are not lost
+	uint64_t previous = slot->published.load(std::memory_order_relaxed);
+	uint64_t next;
+	do {
+		next = value;
+		if (previous & VOICE_LEVEL_UNREAD) {
+			uint64_t rms = (previous & 0xFFFF) > (value & 0xFFFF) ? (previous & 0xFFFF) : (value & 0xFFFF);
+			uint64_t peak = (previous & 0xFFFF0000) > (value & 0xFFFF0000) ? (previous & 0xFFFF0000) : (value & 0xFFFF0000);
+			next = peak | rms;
+		}
+		next |= VOICE_LEVEL_UNREAD;
+	} while (!slot->published.compare_exchange_weak(previous, next, std::memory_order_release, std::memory_order_relaxed));
+}
+
+static unsigned int voiceLevelRateHz() {
+	unsigned int rateHz = pluginSettings.voiceLevelRateHz;
+	return rateHz > VOICE_LEVEL_MAX_RATE_HZ ? VOICE_LEVEL_MAX_RATE_HZ : rateHz;
+}
+
+static void publishVoiceLevels() {
+	const float release = VOICE_LEVEL_RELEASE_PER_SECOND / voiceLevelRateHz();
+
+	for (VoiceLevelSlot& slot : voiceLevelSlots) {
+		uint64_t key = slot.key.load(std::memory_order_acquire);
+		if (key == 0) {
+			continue;
+		}
+		if (key != slot.ownerKey) {
+			// Slot was handed to another client since the last round
+			slot.ownerKey = key;
+			slot.loudness = 0.0f;
+			slot.peak = 0.0f;
+			slot.sentLoudness = 0;
+			slot.sentPeak = 0;
+		}
+
+		// Nothing unread means the client was silent since the last round
+		uint64_t published = slot.published.exchange(0, std::memory_order_acquire);
+		float loudness = 0.0f;
+		float peak = 0.0f;
+		if (published & VOICE_LEVEL_UNREAD) {
+			loudness = audioLoudnessScale((published & 0xFFFF) / 65535.0f);
+			peak = audioLoudnessScale(((published >> 16) & 0xFFFF) / 65535.0f);
+		}
+		slot.loudness = loudness > slot.loudness - release ? loudness : slot.loudness - release;
+		slot.peak = peak > slot.peak - release ? peak : slot.peak - release;
+
+		unsigned int roundedLoudness = slot.loudness > 0.0f ? (unsigned int)(slot.loudness + 0.5f) : 0;
+		unsigned int roundedPeak = slot.peak > 0.0f ? (unsigned int)(slot.peak + 0.5f) : 0;
+		if (roundedLoudness == slot.sentLoudness && roundedPeak == slot.sentPeak) {
+			continue;
+		}
+		slot.sentLoudness = roundedLoudness;
+		slot.sentPeak = roundedPeak;
+
+		uint64 serverConnectionHandlerID = key >> 16;
+		anyID clientID = (anyID)(key & 0xFFFF);
+		unsigned int loudnessLevel = roundedLoudness;
+		unsigned int peakLevel = roundedPeak;
+		SEND_LATEST_EVENT_TO_AURORA(latestOnly(AuroraEvent::voiceLevel, serverConnectionHandlerID, clientID), voiceLevel,
+			EVENT_FIELD(serverConnectionHandlerID),
+			EVENT_FIELD(clientID),
+			NAMED_EVENT_FIELD(loudness, loudnessLevel),
+			NAMED_EVENT_FIELD(peak, peakLevel));
+	}
+}
+
+void registerVoiceLevelTask() {
+	if (voiceLevelRateHz()) {
+		addSenderTask(publishVoiceLevels, 1000 / voiceLevelRateHz());
+	}
+}
+
+void forgetVoiceLevel(uint64 serverConnectionHandlerID, anyID clientID) {
+	VoiceLevelSlot* slot = findVoiceLevelSlot(voiceLevelKey(serverConnectionHandlerID, clientID), false);
+	if (slot) {
+		slot->published.store(0, std::memory_order_relaxed);
+		slot->key.store(0, std::memory_order_release);
+	}
+}
+
+void forgetVoiceLevels(uint64 serverConnectionHandlerID) {
+	const uint64_t connection = serverConnectionHandlerID & 0xFFFFFFFFFFFFULL;
+	for (VoiceLevelSlot& slot : voiceLevelSlots) {
+		uint64_t key = slot.key.load(std::memory_order_acquire);
+		if (key && (key >> 16) == connection) {
+			slot.published.store(0, std::memory_order_relaxed);
+			slot.key.store(0, std::memory_order_release);
+		}
+	}
+}
@@ -0,0 +1,184 @@
+/*
+ * Hook side of sending an event is allocation free once warm: every AuroraEvent goes through sendEvent_to_Aurora
+ * in both encodings while the sender runs, and the hook thread must not allocate a single time.
+ *
+ * Warming up means what the plugin's first events do anyway: the thread's serializationContext() exists and every
+ * pooled buffer has held the largest payload once. Only the calling thread is counted, the sender thread's posts are not.
+ */
+#include <stdio.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <teamspeak/public_definitions.h>
+#include <teamspeak/clientlib_publicdefinitions.h>
+
+#include "allocationCounter.hpp"
+#include "auroraSender.hpp"
+#include "eventSerializer.hpp"
+#include "settings.hpp"
+
+#define TEST_ROUNDS 100
+
+#define TEST_EVENT(eventName, ...) send(AuroraEvent::eventName, AURORA_EVENT_PREFIX(eventName), __VA_ARGS__)
+
+/* Calls send(type, prefix, fields...) once for every AuroraEvent, with the fields the hooks send */
+template <typename F>
+static void forEachEvent(F send) {
+	// Hook arguments, named like the hook parameters so EVENT_FIELD picks the right keys
+	uint64 serverConnectionHandlerID = 1;
+	int newStatus = STATUS_CONNECTION_ESTABLISHED;
+	unsigned int errorNumber = 0;
+	anyID clientID = 42;
+	uint64 oldChannelID = 3;
+	uint64 newChannelID = 7;
+	int visibility = ENTER_VISIBILITY;
+	const char* moveMessage = "";
+	anyID kickerID = 5;
+	const char* kickerName = "Server Admin";
+	const char* kickerUniqueIdentifier = "Kz4Wm0cX1b3T9JQ2mZ0pXq8yH6s=";
+	const char* kickMessage = "Please stop spamming the channel";
+	anyID fromClientID = 17;
+	const char* pokerName = "Client 17";
+	const char* pokerUniqueIdentity = "Lq2Vn8eY7a1R5KP0wX3oZt6uJ4c=";
+	const char* message = "hey, are you around for the raid tonight?";
+	int ffIgnored = 0;
+	anyID toID = 42;
+	const char* fromName = "Client 17";
+	const char* fromUniqueIdentifier = "Lq2Vn8eY7a1R5KP0wX3oZt6uJ4c=";
+	int status = STATUS_TALKING;
+	int isReceivedWhisper = 0;
+	const char* name = "Client 42";
+	int flag = CLIENT_INPUT_MUTED;
+	const char* oldValue = "0";
+	const char* newValue = "1";
+	uint64 channelID = 7;
+	const char* channelName = "Raid Channel";
+	unsigned int channelCount = 50;
+	unsigned int clientCount = 200;
+	auto channelClients = makeEventValueWriter([](auto& writer) {
+		static const char* const names[] = { "Client 42", "Client 17", "Client 5", "Client 108", "Client 64", "Client 99" };
+		writer.StartArray();
+		for (unsigned int i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+			writer.StartObject();
+			writeEventKey(writer, EVENT_KEY(clientID));
+			writeEventValue(writer, (anyID)(40 + i));
+			writeEventKey(writer, EVENT_KEY(name));
+			writeEventValue(writer, names[i]);
+			writeEventKey(writer, EVENT_KEY(talkStatus));
+			writeEventValue(writer, (int)(i == 0));
+			writer.EndObject();
+		}
+		writer.EndArray();
+	});
+	unsigned int channelClientCount = 6;
+	unsigned int channelTalkerCount = 1;
+	unsigned int talkerCount = 4;
+	unsigned int loudness = 63;
+	unsigned int peak = 88;
+	unsigned int clipped = 0;
+	auto bands = makeEventValueWriter([](auto& writer) {
+		static const unsigned int levels[16] = { 71, 78, 80, 76, 69, 64, 61, 57, 52, 49, 44, 38, 31, 22, 12, 0 };
+		writer.StartArray();
+		for (unsigned int level : levels) {
+			writer.Uint(level);
+		}
+		writer.EndArray();
+	});
+
+	TEST_EVENT(onConnectStatusChangeEvent, EVENT_FIELD(serverConnectionHandlerID), EVENT_FIELD(newStatus), EVENT_FIELD(errorNumber));
+	TEST_EVENT(onClientMoveEvent, EVENT_FIELD(serverConnectionHandlerID), EVENT_FIELD(clientID), EVENT_FIELD(oldChannelID),
+		EVENT_FIELD(newChannelID), EVENT_FIELD(visibility), EVENT_FIELD(moveMessage));
+	TEST_EVENT(onClientKickFromChannelEvent, EVENT_FIELD(serverConnectionHandlerID), EVENT_FIELD(clientID), EVENT_FIELD(oldChannelID),
+		EVENT_FIELD(newChannelID), EVENT_FIELD(visibility), EVENT_FIELD(kickerID), EVENT_FIELD(kickerName), EVENT_FIELD(kickerUniqueIdentifier),
+		EVENT_FIELD(kickMessage));
+	TEST_EVENT(onClientKickFromServerEvent, EVENT_FIELD(serverConnectionHandlerID), EVENT_FIELD(clientID), EVENT_FIELD(oldChannelID),
+		EVENT_FIELD(newChannelID), EVENT_FIELD(visibility), EVENT_FIELD(kickerID), EVENT_FIELD(kickerName), EVENT_FIELD(kickerUniqueIdentifier),
+		EVENT_FIELD(kickMessage));
+	TEST_EVENT(onClientPokeEvent, EVENT_FIELD(serverConnectionHandlerID), EVENT_FIELD(fromClientID), EVENT_FIELD(pokerName),
+		EVENT_FIELD(pokerUniqueIdentity), EVENT_FIELD(message), EVENT_FIELD(ffIgnored));
+	TEST_EVENT(onTextMessageEvent, EVENT_FIELD(serverConnectionHandlerID), EVENT_FIELD(toID), EVENT_FIELD(fromName),
+		EVENT_FIELD(fromUniqueIdentifier), EVENT_FIELD(message), EVENT_FIELD(ffIgnored));
+	TEST_EVENT(onTalkStatusChangeEvent, EVENT_FIELD(serverConnectionHandlerID), EVENT_FIELD(status), EVENT_FIELD(isReceivedWhisper),
+		EVENT_FIELD(clientID), EVENT_FIELD(name));
+	TEST_EVENT(onClientSelfVariableUpdateEvent, EVENT_FIELD(serverConnectionHandlerID), EVENT_FIELD(flag), EVENT_FIELD(oldValue),
+		EVENT_FIELD(newValue));
+	TEST_EVENT(serverState, EVENT_FIELD(serverConnectionHandlerID), EVENT_FIELD(clientID), EVENT_FIELD(channelID), EVENT_FIELD(channelName),
+		EVENT_FIELD(channelCount), EVENT_FIELD(clientCount), EVENT_FIELD(channelClients));
+	TEST_EVENT(voiceLevel, EVENT_FIELD(serverConnectionHandlerID), EVENT_FIELD(clientID), EVENT_FIELD(loudness), EVENT_FIELD(peak));
+	TEST_EVENT(captureLevel, EVENT_FIELD(serverConnectionHandlerID), EVENT_FIELD(loudness), EVENT_FIELD(peak), EVENT_FIELD(clipped));
+	TEST_EVENT(spectrum, EVENT_FIELD(serverConnectionHandlerID), EVENT_FIELD(bands));
+	TEST_EVENT(serverSummary, EVENT_FIELD(serverConnectionHandlerID), EVENT_FIELD(channelID), EVENT_FIELD(channelClientCount),
+		EVENT_FIELD(channelTalkerCount), EVENT_FIELD(channelCount), EVENT_FIELD(clientCount), EVENT_FIELD(talkerCount));
+}
+
+/* Serializes every event into every pooled buffer once, so no buffer has to grow later. False if an event type is missing above */
+static bool warmUp(PayloadEncoding encoding) {
+	std::vector<OutboundBuffer*> buffers;
+	// Takes the whole pool, the one failed acquire at the end shows up as a dropped event on shutdown
+	while (OutboundBuffer* buffer = acquireOutboundBuffer()) {
+		buffers.push_back(buffer);
+	}
+	uint64_t types = 0;
+	for (OutboundBuffer* buffer : buffers) {
+		forEachEvent([&](AuroraEvent type, const auto& prefix, const auto&... fields) {
+			buffer->payload.Clear();
+			serializeEvent(buffer->payload, encoding, type, prefix, fields...);
+			types |= (uint64_t)1 << (unsigned int)type;
+		});
+		releaseOutboundBuffer(buffer);
+	}
+	return buffers.size() && types == ((uint64_t)1 << (size_t)AuroraEvent::count) - 1;
+}
+
+/* Allocations on this thread while sending every event TEST_ROUNDS times, refused counts the events the sender did not take */
+static size_t countAllocations(size_t& refused) {
+	size_t allocations = 0;
+	refused = 0;
+	for (int round = 0; round < TEST_ROUNDS; round++) {
+		beginCountingAllocations();
+		forEachEvent([&](AuroraEvent type, const auto& prefix, const auto&... fields) {
+			refused += sendEvent_to_Aurora(EventDelivery{ 0, 0 }, type, prefix, fields...);
+		});
+		allocations += endCountingAllocations();
+		// Gives the sender time to drain, an event dropped for lack of buffers would skip the serializer
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	return allocations;
+}
+
+int main() {
+	// A ring nobody reads, large enough for every event of the test, the sender's side does not matter here
+	pluginSettings.sinkTransport = SinkTransport::shm;
+	pluginSettings.sinkShmName = "aurora_gsi_alloc_test_" + std::to_string((long)getpid());
+	pluginSettings.sinkShmSizeKB = 16 << 10;
+	pluginSettings.batchWindowMs = 0;
+
+	bool ok = true;
+	const PayloadEncoding encodings[] = { PayloadEncoding::json, PayloadEncoding::msgPack };
+	for (PayloadEncoding encoding : encodings) {
+		const char* encodingName = encoding == PayloadEncoding::msgPack ? "msgpack" : "json";
+		pluginSettings.sinkEncoding = encoding;
+		startAuroraSender();
+		if (!warmUp(encoding)) {
+			fprintf(stderr, "allocationTest: not every AuroraEvent is sent by forEachEvent\n");
+			stopAuroraSender();
+			return 1;
+		}
+
+		size_t refused;
+		const size_t allocations = countAllocations(refused);
+		stopAuroraSender();
+
+		printf("allocationTest: %s, %d events of each of %zu types, %zu allocations, %zu refused\n", encodingName, TEST_ROUNDS,
+			(size_t)AuroraEvent::count, allocations, refused);
+		if (allocations != 0 || refused != 0) {
+			fprintf(stderr, "allocationTest: %s events %s\n", encodingName, allocations ? "allocate on the hook thread" : "were refused by the sender");
+			ok = false;
+		}
+	}
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,199 @@
+/*
+ * Shared memory transport across two processes: the parent writes through ShmRingSink, a forked child reads through
+ * ShmRingReader, the same pair as the plugin and an Aurora on one machine.
+ *
+ * The parent posts rounds of payloads of varying length into the smallest ring, so records wrap and pad many times, and
+ * waits for the child to read each round. The child checks order, contents and sequence numbers. Then the child goes idle
+ * and the parent posts once more, which has to wake it through the futex well before its wait times out. Closing the
+ * sink has to wake it as well and make it let go of the segment.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "shmRingReader.hpp"
+#include "shmSink.hpp"
+
+typedef std::chrono::steady_clock TestClock;
+
+#define TEST_ROUNDS 64
+#define TEST_ROUND_PAYLOADS 200
+#define TEST_MAX_PAYLOAD 320
+// Sleeping on the futex for this long means the writer's wakeup never came
+#define TEST_IDLE_WAIT_MS 10000
+// How long the parent lets the child sleep before posting
+#define TEST_IDLE_MS 200
+
+/* Payload number index, its length and every byte follow from the index */
+static size_t makePayload(uint64_t index, char* payload) {
+	const size_t length = 16 + (size_t)(index * 37 % (TEST_MAX_PAYLOAD - 16));
+	for (size_t i = 0; i < length; i++) {
+		payload[i] = (char)('a' + (index + i) % 26);
+	}
+	return length;
+}
+
+static long long elapsedMs(TestClock::time_point since) {
+	return (long long)std::chrono::duration_cast<std::chrono::milliseconds>(TestClock::now() - since).count();
+}
+
+static bool readPayloads(ShmRingReader& reader, uint64_t& next, uint64_t end) {
+	char expected[TEST_MAX_PAYLOAD];
+	const TestClock::time_point started = TestClock::now();
+	while (next < end) {
+		ShmPayload payload;
+		if (!reader.peek(payload)) {
+			if (elapsedMs(started) > TEST_IDLE_WAIT_MS) {
+				fprintf(stderr, "shmRingTest: reader timed out waiting for payload %llu\n", (unsigned long long)next);
+				return false;
+			}
+			reader.wait(100);
+			continue;
+		}
+		if (payload.sequence != next) {
+			fprintf(stderr, "shmRingTest: expected payload %llu, read %llu\n", (unsigned long long)next, (unsigned long long)payload.sequence);
+			return false;
+		}
+		const size_t length = makePayload(next, expected);
+		if (payload.length != length || memcmp(payload.data, expected, length) != 0) {
+			fprintf(stderr, "shmRingTest: payload %llu has the wrong contents (%zu bytes, expected %zu)\n", (unsigned long long)next, payload.length, length);
+			return false;
+		}
+		reader.release();
+		next++;
+	}
+	return true;
+}
+
+static bool acknowledge(int pipe) {
+	const char ack = 1;
+	return write(pipe, &ack, 1) == 1;
+}
+
+static int runReader(const char* name, int ackPipe) {
+	ShmRingReader reader(name);
+	if (!reader.attach()) {
+		fprintf(stderr, "shmRingTest: reader could not attach to %s\n", name);
+		return 1;
+	}
+
+	uint64_t next = 0;
+	for (int round = 0; round < TEST_ROUNDS; round++) {
+		if (!readPayloads(reader, next, next + TEST_ROUND_PAYLOADS) || !acknowledge(ackPipe)) {
+			return 1;
+		}
+	}
+
+	// Idle: the ring is drained and the only way out of the wait before its timeout is the writer's wakeup
+	ShmPayload payload;
+	if (reader.peek(payload)) {
+		fprintf(stderr, "shmRingTest: payload %llu was never posted\n", (unsigned long long)payload.sequence);
+		return 1;
+	}
+	TestClock::time_point idleSince = TestClock::now();
+	while (!reader.peek(payload) && elapsedMs(idleSince) < TEST_IDLE_WAIT_MS) {
+		reader.wait(TEST_IDLE_WAIT_MS);
+	}
+	const long long wokenAfterMs = elapsedMs(idleSince);
+	if (wokenAfterMs >= TEST_IDLE_WAIT_MS / 2) {
+		fprintf(stderr, "shmRingTest: idle reader was not woken, waited %lld ms\n", wokenAfterMs);
+		return 1;
+	}
+	if (!readPayloads(reader, next, next + 1) || !acknowledge(ackPipe)) {
+		return 1;
+	}
+
+	// The writer closing wakes the reader as well, which then unmaps the segment
+	idleSince = TestClock::now();
+	while (reader.attached() && elapsedMs(idleSince) < TEST_IDLE_WAIT_MS) {
+		reader.wait(TEST_IDLE_WAIT_MS);
+	}
+	if (reader.attached() || elapsedMs(idleSince) >= TEST_IDLE_WAIT_MS / 2) {
+		fprintf(stderr, "shmRingTest: reader did not notice the writer closing\n");
+		return 1;
+	}
+	if (reader.lostPayloads()) {
+		fprintf(stderr, "shmRingTest: reader lost %llu payloads\n", (unsigned long long)reader.lostPayloads());
+		return 1;
+	}
+	printf("shmRingTest: read %llu payloads, idle reader woken after %lld ms\n", (unsigned long long)next, wokenAfterMs);
+	return 0;
+}
+
+static bool postPayloads(ShmRingSink& sink, uint64_t& next, uint64_t end) {
+	char payload[TEST_MAX_PAYLOAD];
+	for (; next < end; next++) {
+		if (!sink.post(payload, makePayload(next, payload))) {
+			fprintf(stderr, "shmRingTest: ring refused payload %llu\n", (unsigned long long)next);
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool awaitAcknowledge(int pipe) {
+	char ack;
+	if (read(pipe, &ack, 1) != 1) {
+		fprintf(stderr, "shmRingTest: reader went away\n");
+		return false;
+	}
+	return true;
+}
+
+static bool runWriter(ShmRingSink& sink, int ackPipe) {
+	uint64_t next = 0;
+	// Every round fits into the ring, so the writer never has to drop and the reader sees no gaps
+	for (int round = 0; round < TEST_ROUNDS; round++) {
+		if (!postPayloads(sink, next, next + TEST_ROUND_PAYLOADS) || !awaitAcknowledge(ackPipe)) {
+			return false;
+		}
+	}
+	std::this_thread::sleep_for(std::chrono::milliseconds(TEST_IDLE_MS));
+	return postPayloads(sink, next, next + 1) && awaitAcknowledge(ackPipe);
+}
+
+int main() {
+	const std::string name = "aurora_gsi_test_" + std::to_string((long)getpid());
+	int ackPipe[2];
+	if (pipe(ackPipe) != 0) {
+		fprintf(stderr, "shmRingTest: could not create a pipe\n");
+		return 1;
+	}
+
+	// The segment exists before the fork, so the child can attach right away
+	ShmRingSink* sink = new ShmRingSink(name.c_str(), SHM_RING_MIN_CAPACITY);
+	const pid_t child = fork();
+	if (child < 0) {
+		fprintf(stderr, "shmRingTest: fork failed\n");
+		delete sink;
+		return 1;
+	}
+	if (child == 0) {
+		close(ackPipe[0]);
+		// Leaves the parent's sink alone, destroying it here would close the ring under the parent
+		const int result = runReader(name.c_str(), ackPipe[1]);
+		fflush(stdout);
+		_exit(result);
+	}
+
+	close(ackPipe[1]);
+	const bool written = runWriter(*sink, ackPipe[0]);
+	delete sink;
+	if (!written) {
+		kill(child, SIGKILL);
+	}
+	int status = 0;
+	waitpid(child, &status, 0);
+	close(ackPipe[0]);
+	if (!written || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+		fprintf(stderr, "shmRingTest: failed\n");
+		return 1;
+	}
+	return 0;
+}
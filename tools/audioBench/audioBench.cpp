@@ -0,0 +1,179 @@
+/*
+ * Microbenchmark of the audio thread code paths against their per buffer budget.
+ * Buffers are 10 ms of 48 kHz stereo, the size TeamSpeak hands to the voice data hooks.
+ * Also checks the spectrum FFT against a plain DFT and times one analysis, which runs off the audio thread.
+ *
+ *   audioBench [--iterations n]
+ *
+ * Exits with 1 if a kernel that would be picked on this CPU is over budget.
+ */
+#include <stdio.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "audioLevel.hpp"
+#include "spectrum.hpp"
+
+#define BUFFER_FRAMES 480
+#define BUFFER_CHANNELS 2
+#define BUFFER_SAMPLES (BUFFER_FRAMES * BUFFER_CHANNELS)
+// Cost budget of the playback and capture taps per 10 ms buffer
+#define VOICE_LEVEL_BUDGET_NS 1000.0
+// Cost budget of the mixed playback tap, which only copies into the spectrum ring
+#define SPECTRUM_PUSH_BUDGET_NS 2000.0
+// Largest FFT error accepted, relative to the largest bin
+#define SPECTRUM_MAX_ERROR 1e-4
+
+typedef std::chrono::steady_clock BenchClock;
+
+// Keeps the compiler from dropping the measured calls
+static volatile uint64_t benchSink;
+
+/* Median ns per call over rounds of calls */
+template <typename F>
+static double measureNs(unsigned long iterations, F call) {
+	const unsigned long rounds = 31;
+	const unsigned long perRound = iterations / rounds + 1;
+	std::vector<double> results;
+	for (unsigned long round = 0; round < rounds; round++) {
+		BenchClock::time_point start = BenchClock::now();
+		for (unsigned long i = 0; i < perRound; i++) {
+			call();
+		}
+		results.push_back(std::chrono::duration<double, std::nano>(BenchClock::now() - start).count() / perRound);
+	}
+	std::sort(results.begin(), results.end());
+	return results[rounds / 2];
+}
+
+static bool reportLevelKernel(const char* name, AudioLevelKernel kernel, const short* samples, const AudioLevel& expected, unsigned long iterations, bool selected) {
+	AudioLevel level = kernel(samples, BUFFER_SAMPLES);
+	if (level.sumSquares != expected.sumSquares || level.peak != expected.peak || level.clipped != expected.clipped) {
+		printf("%-12s MISMATCH sum %llu peak %u clipped %u, scalar sum %llu peak %u clipped %u\n", name,
+			(unsigned long long)level.sumSquares, level.peak, level.clipped, (unsigned long long)expected.sumSquares, expected.peak, expected.clipped);
+		return false;
+	}
+
+	double ns = measureNs(iterations, [&] {
+		benchSink = benchSink + kernel(samples, BUFFER_SAMPLES).sumSquares;
+	});
+	bool withinBudget = ns <= VOICE_LEVEL_BUDGET_NS;
+	printf("%-12s %10.1f ns/buffer %8.2f samples/ns  %s%s\n", name, ns, BUFFER_SAMPLES / ns,
+		withinBudget ? "ok" : "OVER BUDGET", selected ? " (selected)" : "");
+	return withinBudget || !selected;
+}
+
+static bool reportLevelKernels(const char* title, const std::vector<short>& samples, unsigned long iterations) {
+	const AudioLevel expected = measureAudioLevelScalar(samples.data(), BUFFER_SAMPLES);
+	const char* selected = audioLevelKernelName();
+	printf("%s: %d samples per 10 ms buffer, %u clipped, budget %.0f ns\n", title, BUFFER_SAMPLES, expected.clipped, VOICE_LEVEL_BUDGET_NS);
+
+	bool ok = reportLevelKernel("scalar", measureAudioLevelScalar, samples.data(), expected, iterations, !strcmp(selected, "scalar"));
+#ifdef AUDIO_LEVEL_X86
+	ok = reportLevelKernel("sse2", measureAudioLevelSSE2, samples.data(), expected, iterations, !strcmp(selected, "sse2")) && ok;
+	if (audioLevelAVX2Supported()) {
+		ok = reportLevelKernel("avx2", measureAudioLevelAVX2, samples.data(), expected, iterations, !strcmp(selected, "avx2")) && ok;
+	}
+#endif
+	return ok;
+}
+
+/* Compares the FFT with a plain DFT in double precision and times the ring copy and one analysis */
+static bool reportSpectrum(const std::vector<short>& samples, unsigned long iterations) {
+	const size_t half = SPECTRUM_FFT_SIZE / 2;
+	std::vector<float> input(SPECTRUM_FFT_SIZE);
+	for (size_t i = 0; i < SPECTRUM_FFT_SIZE; i++) {
+		input[i] = samples[i % BUFFER_SAMPLES] / 32768.0f;
+	}
+
+	SpectrumAnalyzer analyzer(16);
+	std::vector<float> power(half);
+	analyzer.powerSpectrum(input.data(), power.data());
+
+	double largest = 0.0;
+	double worst = 0.0;
+	for (size_t k = 0; k < half; k++) {
+		double re = 0.0;
+		double im = 0.0;
+		for (size_t n = 0; n < SPECTRUM_FFT_SIZE; n++) {
+			double angle = 2.0 * 3.14159265358979323846 * (double)((k * n) % SPECTRUM_FFT_SIZE) / SPECTRUM_FFT_SIZE;
+			re += input[n] * cos(angle);
+			im -= input[n] * sin(angle);
+		}
+		double magnitude = sqrt(re * re + im * im);
+		largest = std::max(largest, magnitude);
+		worst = std::max(worst, fabs(sqrt((double)power[k]) - magnitude));
+	}
+	bool ok = worst <= largest * SPECTRUM_MAX_ERROR;
+	printf("spectrum: FFT of %d samples vs DFT, max error %.2e of largest bin  %s\n", SPECTRUM_FFT_SIZE, worst / largest, ok ? "ok" : "MISMATCH");
+
+	// A full scale 1 kHz sine has to land in a single band near the top of the scale
+	std::vector<float> sine(SPECTRUM_FFT_SIZE);
+	for (size_t i = 0; i < SPECTRUM_FFT_SIZE; i++) {
+		sine[i] = (float)sin(2.0 * 3.14159265358979323846 * 1000.0 * i / SPECTRUM_SAMPLE_RATE);
+	}
+	float levels[SPECTRUM_MAX_BANDS];
+	analyzer.addSamples(sine.data(), sine.size());
+	analyzer.analyze(levels);
+	unsigned int loudest = 0;
+	for (unsigned int band = 1; band < analyzer.bands(); band++) {
+		loudest = levels[band] > levels[loudest] ? band : loudest;
+	}
+	printf("spectrum: 1 kHz sine peaks in band %u of %u at %.1f\n", loudest, analyzer.bands(), levels[loudest]);
+	ok = ok && levels[loudest] > 90.0f;
+
+	static SampleRing ring;
+	unsigned long pushes = 0;
+	double pushNs = measureNs(iterations, [&] {
+		benchSink = benchSink + ring.pushFrames(samples.data(), BUFFER_FRAMES, BUFFER_CHANNELS);
+		// Stand-in for the analyzer draining the ring, well before it fills up
+		if (++pushes % 16 == 0) {
+			ring.clear();
+		}
+	});
+	bool withinBudget = pushNs <= SPECTRUM_PUSH_BUDGET_NS;
+	printf("%-12s %10.1f ns/buffer, budget %.0f ns  %s\n", "ring push", pushNs, SPECTRUM_PUSH_BUDGET_NS, withinBudget ? "ok" : "OVER BUDGET");
+
+	double analyzeNs = measureNs(iterations / 50 + 1, [&] {
+		analyzer.addSamples(input.data(), BUFFER_FRAMES);
+		analyzer.analyze(levels);
+		benchSink = benchSink + (uint64_t)levels[0];
+	});
+	printf("%-12s %10.1f ns/analysis on the analyzer thread\n", "analyze", analyzeNs);
+	return ok && withinBudget;
+}
+
+int main(int argc, char** argv) {
+	unsigned long iterations = 200000;
+	for (int i = 1; i + 1 < argc; i += 2) {
+		if (!strcmp(argv[i], "--iterations")) {
+			iterations = strtoul(argv[i + 1], nullptr, 10);
+		}
+	}
+
+	std::vector<short> samples(BUFFER_SAMPLES);
+	std::mt19937 random(7);
+	std::normal_distribution<double> noise(0.0, 6000.0);
+	for (short& sample : samples) {
+		double value = noise(random);
+		sample = (short)std::max(-32766.0, std::min(32766.0, value));
+	}
+	bool ok = reportLevelKernels("speech", samples, iterations);
+
+	// Both extremes and their neighbours, so the clip counts are checked at the edges too
+	samples[17] = -32768;
+	samples[18] = -32768;
+	samples[40] = -32767;
+	samples[41] = -32766;
+	samples[42] = 32766;
+	samples[BUFFER_SAMPLES - 1] = 32767;
+	ok = reportLevelKernels("clipping", samples, iterations) && ok;
+	ok = reportSpectrum(samples, iterations) && ok;
+	return ok ? 0 : 1;
+}
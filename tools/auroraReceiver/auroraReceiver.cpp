@@ -0,0 +1,583 @@
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <poll.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <chrono>
+#include <string>
+
+#include "auroraReceiver.hpp"
+#include "eventTypes.hpp"
+#include "shmRingReader.hpp"
+
+// How often blocked threads look at the running flag
+#define RECEIVER_POLL_MS 100
+
+static const char okResponse[] = "HTTP/1.1 200 OK\r\nContent-Length: 0\r\n\r\n";
+static const char errorResponse[] = "HTTP/1.1 500 Internal Server Error\r\nContent-Length: 0\r\n\r\n";
+
+bool parseReceiverTransport(const char* name, ReceiverTransport& transport) {
+	static const char* const names[] = { "http", "udp", "tcp", "unix", "shm" };
+	for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+		if (!strcmp(name, names[i])) {
+			transport = (ReceiverTransport)i;
+			return true;
+		}
+	}
+	return false;
+}
+
+int64_t receiverClockNs() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+AuroraReceiver::AuroraReceiver(const ReceiverOptions& options, PayloadHandler handler) :
+	options(options), handler(std::move(handler)), listenSocket(-1), running(false), randomState(0x9E3779B97F4A7C15ull), requestCount(0), errorCount(0), refusedCount(0) {
+}
+
+AuroraReceiver::~AuroraReceiver() {
+	stop();
+}
+
+bool AuroraReceiver::start() {
+	if (options.transport == ReceiverTransport::shm) {
+		running = true;
+		acceptThread = std::thread(&AuroraReceiver::shmLoop, this);
+		return true;
+	}
+
+	const bool datagrams = options.transport == ReceiverTransport::udp;
+	const bool local = options.transport == ReceiverTransport::unixSocket;
+	listenSocket = socket(local ? AF_UNIX : AF_INET, datagrams ? SOCK_DGRAM : SOCK_STREAM, 0);
+	if (listenSocket < 0) {
+		perror("auroraReceiver: socket");
+		return false;
+	}
+
+	int bound;
+	if (local) {
+		sockaddr_un address;
+		memset(&address, 0, sizeof(address));
+		address.sun_family = AF_UNIX;
+		snprintf(address.sun_path, sizeof(address.sun_path), "%s", options.socketPath.c_str());
+		// A stale socket file from an earlier run would make bind fail
+		unlink(address.sun_path);
+		bound = bind(listenSocket, (sockaddr*)&address, sizeof(address));
+	}
+	else {
+		int reuse = 1;
+		setsockopt(listenSocket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+		if (datagrams) {
+			// Room for bursts while the handler is busy, the kernel drops what does not fit
+			int bufferSize = 8 << 20;
+			setsockopt(listenSocket, SOL_SOCKET, SO_RCVBUF, &bufferSize, sizeof(bufferSize));
+		}
+
+		sockaddr_in address;
+		memset(&address, 0, sizeof(address));
+		address.sin_family = AF_INET;
+		address.sin_port = htons(options.port);
+		address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		bound = bind(listenSocket, (sockaddr*)&address, sizeof(address));
+	}
+	if (bound != 0 || (!datagrams && listen(listenSocket, 16) != 0)) {
+		perror("auroraReceiver: bind");
+		close(listenSocket);
+		listenSocket = -1;
+		return false;
+	}
+
+	running = true;
+	acceptThread = std::thread(datagrams ? &AuroraReceiver::datagramLoop : &AuroraReceiver::acceptLoop, this);
+	return true;
+}
+
+void AuroraReceiver::stop() {
+	if (!running.exchange(false)) {
+		return;
+	}
+	acceptThread.join();
+	for (std::thread& connection : connectionThreads) {
+		connection.join();
+	}
+	connectionThreads.clear();
+	if (listenSocket >= 0) {
+		close(listenSocket);
+		listenSocket = -1;
+	}
+	if (options.transport == ReceiverTransport::unixSocket) {
+		unlink(options.socketPath.c_str());
+	}
+}
+
+bool AuroraReceiver::chance(double rate) {
+	if (rate <= 0) {
+		return false;
+	}
+	std::lock_guard<std::mutex> lock(randomMutex);
+	// xorshift64, good enough to pick which requests fail
+	randomState ^= randomState << 13;
+	randomState ^= randomState >> 7;
+	randomState ^= randomState << 17;
+	return (randomState >> 11) * (1.0 / 9007199254740992.0) < rate;
+}
+
+void AuroraReceiver::acceptLoop() {
+	pollfd listener = { listenSocket, POLLIN, 0 };
+	while (running) {
+		if (poll(&listener, 1, RECEIVER_POLL_MS) <= 0) {
+			continue;
+		}
+		int connection = accept(listenSocket, nullptr, nullptr);
+		if (connection < 0) {
+			continue;
+		}
+
+		if (chance(options.refuseRate)) {
+			// Zero linger makes close() send a RST, the client sees the connection reset
+			linger reset = { 1, 0 };
+			setsockopt(connection, SOL_SOCKET, SO_LINGER, &reset, sizeof(reset));
+			close(connection);
+			refusedCount++;
+			continue;
+		}
+
+		std::lock_guard<std::mutex> lock(connectionsMutex);
+		if (options.transport == ReceiverTransport::http) {
+			int noDelay = 1;
+			setsockopt(connection, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+			connectionThreads.emplace_back(&AuroraReceiver::serveConnection, this, connection);
+		}
+		else {
+			connectionThreads.emplace_back(&AuroraReceiver::serveFramedConnection, this, connection);
+		}
+	}
+}
+
+void AuroraReceiver::datagramLoop() {
+	std::vector<char> datagram(65536);
+	pollfd receiver = { listenSocket, POLLIN, 0 };
+	while (running) {
+		if (poll(&receiver, 1, RECEIVER_POLL_MS) <= 0) {
+			continue;
+		}
+		ssize_t received = recv(listenSocket, datagram.data(), datagram.size(), 0);
+		if (received > 0) {
+			receivePayload(datagram.data(), (size_t)received);
+		}
+	}
+}
+
+/* Payloads are handed to the handler straight from the shared memory, the ring slot is freed afterwards */
+void AuroraReceiver::shmLoop() {
+	ShmRingReader reader(options.shmName.c_str());
+	while (running) {
+		ShmPayload payload;
+		while (running && reader.peek(payload)) {
+			receivePayload(payload.data, payload.length);
+			reader.release();
+
+			if (options.latencyMs) {
+				std::this_thread::sleep_for(std::chrono::milliseconds(options.latencyMs));
+			}
+		}
+		reader.wait(RECEIVER_POLL_MS);
+	}
+	if (reader.lostPayloads()) {
+		fprintf(stderr, "auroraReceiver: %llu payloads were lost to a full ring\n", (unsigned long long)reader.lostPayloads());
+	}
+}
+
+bool AuroraReceiver::receivePayload(const char* body, size_t length) {
+	int64_t arrivalNs = receiverClockNs();
+	bool fail = chance(options.errorRate);
+	requestCount++;
+	if (fail) {
+		errorCount++;
+	}
+	handler(arrivalNs, body, length, !fail);
+	return !fail;
+}
+
+/* Returns the Content-Length of a request head, 0 if there is none */
+static size_t parseContentLength(const std::string& request, size_t headEnd) {
+	static const char header[] = "\r\nContent-Length:";
+	size_t position = 0;
+	while ((position = request.find("\r\n", position)) != std::string::npos && position < headEnd) {
+		if (!strncasecmp(request.c_str() + position, header, sizeof(header) - 1)) {
+			return (size_t)strtoul(request.c_str() + position + sizeof(header) - 1, nullptr, 10);
+		}
+		position += 2;
+	}
+	return 0;
+}
+
+static bool sendAll(int socket, const char* data, size_t length) {
+	while (length > 0) {
+		ssize_t sent = send(socket, data, length, MSG_NOSIGNAL);
+		if (sent <= 0) {
+			return false;
+		}
+		data += sent;
+		length -= (size_t)sent;
+	}
+	return true;
+}
+
+void AuroraReceiver::serveConnection(int socket) {
+	std::string request;
+	char chunk[16384];
+	pollfd connection = { socket, POLLIN, 0 };
+
+	while (running) {
+		if (poll(&connection, 1, RECEIVER_POLL_MS) <= 0) {
+			continue;
+		}
+		ssize_t received = recv(socket, chunk, sizeof(chunk), 0);
+		if (received <= 0) {
+			break;
+		}
+		request.append(chunk, (size_t)received);
+
+		// A keep-alive connection may carry several requests in one read
+		for (;;) {
+			size_t headEnd = request.find("\r\n\r\n");
+			if (headEnd == std::string::npos) {
+				break;
+			}
+			size_t bodyStart = headEnd + 4;
+			size_t bodyLength = parseContentLength(request, headEnd);
+			if (request.size() < bodyStart + bodyLength) {
+				break;
+			}
+
+			bool fail = !receivePayload(request.c_str() + bodyStart, bodyLength);
+			request.erase(0, bodyStart + bodyLength);
+
+			if (options.latencyMs) {
+				std::this_thread::sleep_for(std::chrono::milliseconds(options.latencyMs));
+			}
+			const char* response = fail ? errorResponse : okResponse;
+			if (!sendAll(socket, response, strlen(response))) {
+				request.clear();
+				break;
+			}
+		}
+	}
+	close(socket);
+}
+
+/* Frames of the stream transports: 4 byte big endian length, then the payload. Nothing is sent back */
+void AuroraReceiver::serveFramedConnection(int socket) {
+	std::string stream;
+	char chunk[16384];
+	pollfd connection = { socket, POLLIN, 0 };
+
+	while (running) {
+		if (poll(&connection, 1, RECEIVER_POLL_MS) <= 0) {
+			continue;
+		}
+		ssize_t received = recv(socket, chunk, sizeof(chunk), 0);
+		if (received <= 0) {
+			break;
+		}
+		stream.append(chunk, (size_t)received);
+
+		size_t position = 0;
+		while (stream.size() - position >= 4) {
+			const unsigned char* header = (const unsigned char*)stream.data() + position;
+			size_t length = ((size_t)header[0] << 24) | ((size_t)header[1] << 16) | ((size_t)header[2] << 8) | header[3];
+			if (stream.size() - position - 4 < length) {
+				break;
+			}
+			receivePayload(stream.data() + position + 4, length);
+			position += 4 + length;
+
+			if (options.latencyMs) {
+				std::this_thread::sleep_for(std::chrono::milliseconds(options.latencyMs));
+			}
+		}
+		stream.erase(0, position);
+	}
+	close(socket);
+}
+
+bool isMsgPackPayload(const char* body, size_t length) {
+	return length > 0 && body[0] != '{' && body[0] != '[';
+}
+
+/* Reads MessagePack values, only the types the plugin writes: integers, strings, nil, booleans, arrays and maps */
+class MsgPackReader {
+public:
+	MsgPackReader(const char* body, size_t length) : position((const unsigned char*)body), end((const unsigned char*)body + length), failed(false) {}
+
+	bool done() const { return !failed && position == end; }
+	bool ok() const { return !failed; }
+
+	/* Element count if the next value is an array, moves past the header */
+	bool readArrayHeader(size_t& count) {
+		return readContainerHeader(0x90, 0xdc, 0xdd, count);
+	}
+
+	bool readMapHeader(size_t& count) {
+		return readContainerHeader(0x80, 0xde, 0xdf, count);
+	}
+
+	bool readUnsigned(uint64_t& value) {
+		if (!available(1)) {
+			return false;
+		}
+		const unsigned char type = *position++;
+		if (type < 0x80) {
+			value = type;
+			return true;
+		}
+		if (type >= 0xcc && type <= 0xcf) {
+			return readBigEndian((size_t)1 << (type - 0xcc), value);
+		}
+		failed = true;
+		return false;
+	}
+
+	/* Appends the next value as JSON, map keys that are integers are field tags */
+	bool appendJson(std::string& json) {
+		if (!available(1)) {
+			return false;
+		}
+		const unsigned char type = *position;
+		size_t count;
+		if (type < 0x80 || (type >= 0xcc && type <= 0xcf)) {
+			uint64_t value;
+			readUnsigned(value);
+			json += std::to_string(value);
+		}
+		else if (type >= 0xe0 || (type >= 0xd0 && type <= 0xd3)) {
+			position++;
+			uint64_t bits = 0;
+			int64_t value = (int8_t)type;
+			if (type < 0xe0) {
+				const size_t size = (size_t)1 << (type - 0xd0);
+				if (!readBigEndian(size, bits)) {
+					return false;
+				}
+				// Sign extend from the stored width
+				const unsigned shift = (unsigned)(64 - 8 * size);
+				value = (int64_t)(bits << shift) >> shift;
+			}
+			json += std::to_string(value);
+		}
+		else if ((type >= 0xa0 && type <= 0xbf) || (type >= 0xd9 && type <= 0xdb)) {
+			position++;
+			uint64_t length = type & 0x1f;
+			if (type >= 0xd9 && !readBigEndian((size_t)1 << (type - 0xd9), length)) {
+				return false;
+			}
+			if (!available((size_t)length)) {
+				return false;
+			}
+			appendJsonString(json, (const char*)position, (size_t)length);
+			position += length;
+		}
+		else if (type == 0xc0 || type == 0xc2 || type == 0xc3) {
+			position++;
+			json += type == 0xc0 ? "null" : type == 0xc3 ? "true" : "false";
+		}
+		else if (readArrayHeader(count)) {
+			json += '[';
+			for (size_t i = 0; i < count; i++) {
+				if (i) {
+					json += ',';
+				}
+				if (!appendJson(json)) {
+					return false;
+				}
+			}
+			json += ']';
+		}
+		else if (!failed && readMapHeader(count)) {
+			json += '{';
+			for (size_t i = 0; i < count; i++) {
+				if (i) {
+					json += ',';
+				}
+				if (!appendKey(json) || !appendJson(json)) {
+					return false;
+				}
+			}
+			json += '}';
+		}
+		else {
+			failed = true;
+		}
+		return !failed;
+	}
+
+private:
+	bool available(size_t bytes) {
+		if (failed || (size_t)(end - position) < bytes) {
+			failed = true;
+		}
+		return !failed;
+	}
+
+	bool readBigEndian(size_t size, uint64_t& value) {
+		if (!available(size)) {
+			return false;
+		}
+		value = 0;
+		for (size_t i = 0; i < size; i++) {
+			value = (value << 8) | *position++;
+		}
+		return true;
+	}
+
+	bool readContainerHeader(unsigned char fixType, unsigned char type16, unsigned char type32, size_t& count) {
+		if (!available(1)) {
+			return false;
+		}
+		const unsigned char type = *position;
+		uint64_t value;
+		if ((type & 0xf0) == fixType) {
+			position++;
+			count = type & 0x0f;
+			return true;
+		}
+		if (type == type16 || type == type32) {
+			position++;
+			if (!readBigEndian(type == type16 ? 2 : 4, value)) {
+				return false;
+			}
+			count = (size_t)value;
+			return true;
+		}
+		return false;
+	}
+
+	bool appendKey(std::string& json) {
+		if (available(1) && *position < 0x80) {
+			const char* name = eventFieldName((EventFieldTag)*position++);
+			if (!name) {
+				failed = true;
+				return false;
+			}
+			json += '"';
+			json += name;
+			json += "\":";
+			return true;
+		}
+		if (!appendJson(json)) {
+			return false;
+		}
+		json += ':';
+		return true;
+	}
+
+	/* Escapes like rapidjson's Writer */
+	static void appendJsonString(std::string& json, const char* value, size_t length) {
+		static const char hex[] = "0123456789ABCDEF";
+		json += '"';
+		for (size_t i = 0; i < length; i++) {
+			const unsigned char c = (unsigned char)value[i];
+			switch (c) {
+			case '"': json += "\\\""; break;
+			case '\\': json += "\\\\"; break;
+			case '\b': json += "\\b"; break;
+			case '\f': json += "\\f"; break;
+			case '\n': json += "\\n"; break;
+			case '\r': json += "\\r"; break;
+			case '\t': json += "\\t"; break;
+			default:
+				if (c < 0x20) {
+					json += "\\u00";
+					json += hex[c >> 4];
+					json += hex[c & 0xf];
+				}
+				else {
+					json += (char)c;
+				}
+			}
+		}
+		json += '"';
+	}
+
+	const unsigned char* position;
+	const unsigned char* end;
+	bool failed;
+};
+
+/* One event, [<event tag>, {<fields>}] */
+static bool appendEventJson(MsgPackReader& reader, std::string& json) {
+	size_t count;
+	uint64_t type;
+	if (!reader.readArrayHeader(count) || count != 2 || !reader.readUnsigned(type)) {
+		return false;
+	}
+	const char* name = auroraEventName((AuroraEvent)type);
+	if (!name) {
+		return false;
+	}
+	json += "{\"provider\":{\"name\":\"TeamSpeak\",\"appid\":-1},\"data\":{\"";
+	json += name;
+	json += "\":";
+	if (!reader.appendJson(json)) {
+		return false;
+	}
+	json += "}}";
+	return true;
+}
+
+/* A single event is an array of two starting with the event tag, a batch is an array of events */
+static bool msgPackBatchSize(const char* body, size_t length, size_t& count) {
+	MsgPackReader reader(body, length);
+	if (length >= 2 && (unsigned char)body[0] == 0x92 && (unsigned char)body[1] < 0x80) {
+		count = 0;
+		return true;
+	}
+	return reader.readArrayHeader(count);
+}
+
+bool msgPackPayloadToJson(const char* body, size_t length, std::string& json) {
+	json.clear();
+	size_t count;
+	if (!msgPackBatchSize(body, length, count)) {
+		return false;
+	}
+	MsgPackReader reader(body, length);
+	if (count == 0) {
+		return appendEventJson(reader, json) && reader.done();
+	}
+	reader.readArrayHeader(count);
+	json += '[';
+	for (size_t i = 0; i < count; i++) {
+		if (i) {
+			json += ',';
+		}
+		if (!appendEventJson(reader, json)) {
+			return false;
+		}
+	}
+	json += ']';
+	return reader.done();
+}
+
+size_t countPostedEvents(const char* body, size_t length) {
+	if (isMsgPackPayload(body, length)) {
+		size_t count;
+		return msgPackBatchSize(body, length, count) ? (count ? count : 1) : 0;
+	}
+
+	static const char marker[] = "{\"provider\":";
+	size_t count = 0;
+	const char* end = body + length;
+	for (const char* position = body; (position = (const char*)memmem(position, end - position, marker, sizeof(marker) - 1)) != nullptr; position += sizeof(marker) - 1) {
+		count++;
+	}
+	return count;
+}
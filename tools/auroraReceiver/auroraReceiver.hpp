@@ -0,0 +1,102 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+ * Stand-in for Aurora's GSI endpoint: a minimal HTTP/1.1 server that accepts POSTs on keep-alive connections,
+ * or the receiving end of one of the plugin's other transports (UDP datagrams, length framed TCP or Unix socket streams,
+ * the shared memory ring).
+ * Faults can be injected to see how the plugin copes with a slow or failing Aurora.
+ */
+
+enum class ReceiverTransport {
+	http,
+	udp,
+	tcp,
+	unixSocket,
+	shm
+};
+
+/* Parses http, udp, tcp, unix or shm, returns false for anything else */
+bool parseReceiverTransport(const char* name, ReceiverTransport& transport);
+
+struct ReceiverOptions {
+	ReceiverTransport transport = ReceiverTransport::http;
+	unsigned short port = 9088;
+	/* Socket file of the unix transport */
+	std::string socketPath = "/tmp/aurora_gsi.sock";
+	/* Shared memory segment of the shm transport */
+	std::string shmName = "aurora_gsi";
+	/* Delay before every response, or before reading on after every payload of the other transports */
+	unsigned int latencyMs = 0;
+	/* Share of requests answered with 500 instead of 200, the other transports have no answer and drop them */
+	double errorRate = 0;
+	/* Share of new connections that are reset right after accept, as if Aurora refused them */
+	double refuseRate = 0;
+};
+
+/*
+ * Called on a connection thread for every POST body, arrivalNs is steady_clock time when the body was complete.
+ * accepted is false for requests that are about to be answered with an injected error
+ */
+typedef std::function<void(int64_t arrivalNs, const char* body, size_t length, bool accepted)> PayloadHandler;
+
+class AuroraReceiver {
+public:
+	AuroraReceiver(const ReceiverOptions& options, PayloadHandler handler);
+	~AuroraReceiver();
+
+	AuroraReceiver(const AuroraReceiver&) = delete;
+	AuroraReceiver& operator=(const AuroraReceiver&) = delete;
+
+	/* Binds to 127.0.0.1 (or the socket path) and starts receiving, returns false if the port is taken.
+	 * The shm transport waits for the plugin to create the segment */
+	bool start();
+	void stop();
+
+	uint64_t requests() const { return requestCount.load(); }
+	uint64_t failedRequests() const { return errorCount.load(); }
+	uint64_t refusedConnections() const { return refusedCount.load(); }
+
+private:
+	void acceptLoop();
+	void datagramLoop();
+	void shmLoop();
+	void serveConnection(int socket);
+	void serveFramedConnection(int socket);
+	bool receivePayload(const char* body, size_t length);
+	bool chance(double rate);
+
+	ReceiverOptions options;
+	PayloadHandler handler;
+	int listenSocket;
+	std::atomic<bool> running;
+	std::thread acceptThread;
+	std::mutex connectionsMutex;
+	std::vector<std::thread> connectionThreads;
+	std::mutex randomMutex;
+	uint64_t randomState;
+	std::atomic<uint64_t> requestCount;
+	std::atomic<uint64_t> errorCount;
+	std::atomic<uint64_t> refusedCount;
+};
+
+/* steady_clock now in nanoseconds, the clock arrival times are measured with */
+int64_t receiverClockNs();
+
+/* Number of events in a posted body, a batch holds several. Works for JSON and MessagePack bodies */
+size_t countPostedEvents(const char* body, size_t length);
+
+/* True for MessagePack bodies (sinkEncoding = msgpack), JSON ones start with { or [ */
+bool isMsgPackPayload(const char* body, size_t length);
+
+/* Turns a MessagePack body back into the JSON the plugin sends with sinkEncoding = json, false if it is malformed */
+bool msgPackPayloadToJson(const char* body, size_t length, std::string& json);
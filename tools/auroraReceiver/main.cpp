@@ -0,0 +1,135 @@
+/*
+ * Local stand-in for Aurora, receives what the plugin posts and records it.
+ *
+ *   auroraReceiver [--transport http|udp|tcp|unix|shm] [--port 9088] [--socket-path /tmp/aurora_gsi.sock] [--shm-name aurora_gsi]
+ *                  [--latency-ms n] [--error-rate 0..1] [--refuse-rate 0..1] [--record file]
+ *
+ * Every payload is written to the record file (stdout by default) as "<arrival ns>\t<status>\t<body>" lines,
+ * arrival times are steady_clock nanoseconds. MessagePack bodies are written as the JSON they stand for. Request and event rates are printed to stderr every second.
+ */
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "auroraReceiver.hpp"
+
+static std::atomic<bool> interrupted(false);
+
+static void onSignal(int) {
+	interrupted = true;
+}
+
+int main(int argc, char** argv) {
+	ReceiverOptions options;
+	const char* recordPath = nullptr;
+
+	for (int i = 1; i + 1 < argc; i += 2) {
+		const char* option = argv[i];
+		const char* value = argv[i + 1];
+		if (!strcmp(option, "--transport")) {
+			if (!parseReceiverTransport(value, options.transport)) {
+				fprintf(stderr, "auroraReceiver: unknown transport %s\n", value);
+				return 2;
+			}
+		}
+		else if (!strcmp(option, "--port")) {
+			options.port = (unsigned short)strtoul(value, nullptr, 10);
+		}
+		else if (!strcmp(option, "--socket-path")) {
+			options.socketPath = value;
+		}
+		else if (!strcmp(option, "--shm-name")) {
+			options.shmName = value;
+		}
+		else if (!strcmp(option, "--latency-ms")) {
+			options.latencyMs = (unsigned int)strtoul(value, nullptr, 10);
+		}
+		else if (!strcmp(option, "--error-rate")) {
+			options.errorRate = strtod(value, nullptr);
+		}
+		else if (!strcmp(option, "--refuse-rate")) {
+			options.refuseRate = strtod(value, nullptr);
+		}
+		else if (!strcmp(option, "--record")) {
+			recordPath = value;
+		}
+		else {
+			fprintf(stderr, "auroraReceiver: unknown option %s\n", option);
+			return 2;
+		}
+	}
+	if (argc % 2 == 0) {
+		fprintf(stderr, "auroraReceiver: %s needs a value\n", argv[argc - 1]);
+		return 2;
+	}
+
+	FILE* record = recordPath ? fopen(recordPath, "w") : stdout;
+	if (!record) {
+		perror("auroraReceiver: record file");
+		return 1;
+	}
+
+	std::mutex recordMutex;
+	std::atomic<uint64_t> events(0);
+	std::string decoded;
+	AuroraReceiver receiver(options, [&](int64_t arrivalNs, const char* body, size_t length, bool accepted) {
+		if (accepted) {
+			events += countPostedEvents(body, length);
+		}
+		std::lock_guard<std::mutex> lock(recordMutex);
+		if (isMsgPackPayload(body, length)) {
+			if (!msgPackPayloadToJson(body, length, decoded)) {
+				decoded = "malformed MessagePack";
+			}
+			body = decoded.c_str();
+			length = decoded.size();
+		}
+		fprintf(record, "%lld\t%s\t%.*s\n", (long long)arrivalNs, accepted ? "200" : "500", (int)length, body);
+	});
+	if (!receiver.start()) {
+		return 1;
+	}
+
+	signal(SIGINT, onSignal);
+	signal(SIGTERM, onSignal);
+	if (options.transport == ReceiverTransport::unixSocket) {
+		fprintf(stderr, "auroraReceiver: listening on %s\n", options.socketPath.c_str());
+	}
+	else if (options.transport == ReceiverTransport::shm) {
+		fprintf(stderr, "auroraReceiver: reading shared memory %s\n", options.shmName.c_str());
+	}
+	else {
+		fprintf(stderr, "auroraReceiver: listening on 127.0.0.1:%u\n", options.port);
+	}
+
+	uint64_t lastRequests = 0;
+	uint64_t lastEvents = 0;
+	while (!interrupted) {
+		std::this_thread::sleep_for(std::chrono::seconds(1));
+		uint64_t requests = receiver.requests();
+		uint64_t received = events.load();
+		if (requests != lastRequests) {
+			fprintf(stderr, "auroraReceiver: %llu requests/s, %llu events/s, %llu failed, %llu refused\n",
+				(unsigned long long)(requests - lastRequests), (unsigned long long)(received - lastEvents),
+				(unsigned long long)receiver.failedRequests(), (unsigned long long)receiver.refusedConnections());
+			std::lock_guard<std::mutex> lock(recordMutex);
+			fflush(record);
+		}
+		lastRequests = requests;
+		lastEvents = received;
+	}
+
+	receiver.stop();
+	fprintf(stderr, "auroraReceiver: %llu requests, %llu events\n", (unsigned long long)receiver.requests(), (unsigned long long)events.load());
+	if (record != stdout) {
+		fclose(record);
+	}
+	return 0;
+}
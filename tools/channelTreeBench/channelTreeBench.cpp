@@ -0,0 +1,341 @@
+/*
+ * Microbenchmark of the channel tree index (channelTree.hpp) on a synthetic server, against the
+ * maps of IDs the server state used before: membership and talker questions there meant scanning every client,
+ * subtree questions walking the parents through the channel map.
+ * Also replays random moves, talk changes and channel edits into both and checks that they agree.
+ *
+ *   channelTreeBench [--channels n] [--clients n] [--iterations n] [--seed n]
+ *
+ * Exits with 1 if the tree and the maps disagree.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include "channelTree.hpp"
+
+typedef std::chrono::steady_clock BenchClock;
+
+// Keeps the compiler from dropping the measured calls
+static volatile uint64_t benchSink;
+
+/* Median ns per call over rounds of calls */
+template <typename F>
+static double measureNs(unsigned long iterations, F call) {
+	const unsigned long rounds = 31;
+	const unsigned long perRound = iterations / rounds + 1;
+	std::vector<double> results;
+	for (unsigned long round = 0; round < rounds; round++) {
+		BenchClock::time_point start = BenchClock::now();
+		for (unsigned long i = 0; i < perRound; i++) {
+			call();
+		}
+		results.push_back(std::chrono::duration<double, std::nano>(BenchClock::now() - start).count() / perRound);
+	}
+	std::sort(results.begin(), results.end());
+	return results[rounds / 2];
+}
+
+/* The server state before the tree: everything keyed by TeamSpeak IDs */
+struct MapState {
+	struct Client {
+		uint64 channelID;
+		bool talking;
+	};
+	std::unordered_map<uint64, uint64> parents;
+	std::unordered_map<anyID, Client> clients;
+
+	unsigned int memberCount(uint64 channelID) const {
+		unsigned int count = 0;
+		for (const auto& client : clients) {
+			count += client.second.channelID == channelID;
+		}
+		return count;
+	}
+
+	unsigned int talkerCount(uint64 channelID) const {
+		unsigned int count = 0;
+		for (const auto& client : clients) {
+			count += client.second.channelID == channelID && client.second.talking;
+		}
+		return count;
+	}
+
+	uint64 topLevelChannel(uint64 channelID) const {
+		auto channel = parents.find(channelID);
+		while (channel != parents.end() && channel->second) {
+			channelID = channel->second;
+			channel = parents.find(channelID);
+		}
+		return channelID;
+	}
+
+	bool inSubtree(uint64 channelID, uint64 ancestorID) const {
+		while (channelID) {
+			if (channelID == ancestorID) {
+				return true;
+			}
+			auto channel = parents.find(channelID);
+			channelID = channel != parents.end() ? channel->second : 0;
+		}
+		return false;
+	}
+};
+
+struct SyntheticServer {
+	std::vector<uint64> channelIDs;
+	std::vector<uint64> parentIDs;
+	std::vector<anyID> clientIDs;
+	std::vector<uint64> clientChannels;
+};
+
+/* Channels hang below a random earlier channel up to a few levels deep, listed in random order */
+static SyntheticServer makeServer(size_t channels, size_t clients, std::mt19937& random) {
+	SyntheticServer server;
+	std::vector<unsigned int> depth(channels + 1, 0);
+	for (uint64 id = 1; id <= channels; id++) {
+		uint64 parent = id > 1 && random() % 20 ? random() % (id - 1) + 1 : 0;
+		if (parent && depth[parent] >= 6) {
+			parent = 0;
+		}
+		depth[id] = parent ? depth[parent] + 1 : 0;
+		server.channelIDs.push_back(id);
+		server.parentIDs.push_back(parent);
+	}
+	std::vector<size_t> shuffle(channels);
+	for (size_t i = 0; i < channels; i++) {
+		shuffle[i] = i;
+	}
+	std::shuffle(shuffle.begin(), shuffle.end(), random);
+	SyntheticServer shuffled;
+	for (size_t i : shuffle) {
+		shuffled.channelIDs.push_back(server.channelIDs[i]);
+		shuffled.parentIDs.push_back(server.parentIDs[i]);
+	}
+	for (size_t i = 0; i < clients; i++) {
+		shuffled.clientIDs.push_back((anyID)(i + 1));
+		shuffled.clientChannels.push_back(random() % channels + 1);
+	}
+	return shuffled;
+}
+
+static void buildTree(ChannelTree& tree, const SyntheticServer& server) {
+	tree.build(server.channelIDs.data(), server.parentIDs.data(), server.channelIDs.size());
+	for (size_t i = 0; i < server.clientIDs.size(); i++) {
+		tree.moveClient(server.clientIDs[i], server.clientChannels[i]);
+	}
+}
+
+static void buildMaps(MapState& maps, const SyntheticServer& server) {
+	maps.parents.clear();
+	maps.clients.clear();
+	for (size_t i = 0; i < server.channelIDs.size(); i++) {
+		maps.parents[server.channelIDs[i]] = server.parentIDs[i];
+	}
+	for (size_t i = 0; i < server.clientIDs.size(); i++) {
+		maps.clients[server.clientIDs[i]] = MapState::Client{ server.clientChannels[i], false };
+	}
+}
+
+static void report(const char* name, double treeNs, double mapNs) {
+	printf("%-24s %12.1f ns %14.1f ns %10.1fx\n", name, treeNs, mapNs, mapNs / treeNs);
+}
+
+/* Random edits applied to both, then every channel compared */
+static bool checkConsistency(const SyntheticServer& server, unsigned long steps, std::mt19937& random) {
+	ChannelTree tree;
+	MapState maps;
+	buildTree(tree, server);
+	buildMaps(maps, server);
+	uint64 nextChannelID = server.channelIDs.size() + 1;
+	std::vector<uint64> channelIDs = server.channelIDs;
+
+	for (unsigned long step = 0; step < steps; step++) {
+		const uint64 channelID = channelIDs[random() % channelIDs.size()];
+		const anyID clientID = (anyID)(random() % (server.clientIDs.size() + 100) + 1);
+		switch (random() % 8) {
+		case 0:
+		case 1:
+		case 2:
+			tree.moveClient(clientID, channelID);
+			if (maps.clients.count(clientID)) {
+				maps.clients[clientID].channelID = channelID;
+			}
+			else {
+				maps.clients[clientID] = MapState::Client{ channelID, false };
+			}
+			break;
+		case 3:
+			tree.moveClient(clientID, 0);
+			maps.clients.erase(clientID);
+			break;
+		case 4:
+		case 5: {
+			const bool talking = random() % 2 != 0;
+			const TreeIndex client = tree.findClient(clientID);
+			if (client != noTreeIndex) {
+				tree.setTalking(client, talking);
+				maps.clients[clientID].talking = talking;
+			}
+			break;
+		}
+		case 6: {
+			const uint64 parentID = random() % 4 ? channelIDs[random() % channelIDs.size()] : 0;
+			tree.moveChannel(channelID, parentID);
+			if (!parentID || !maps.inSubtree(parentID, channelID)) {
+				maps.parents[channelID] = parentID;
+			}
+			else {
+				maps.parents[channelID] = 0;
+			}
+			break;
+		}
+		default:
+			if (random() % 2) {
+				tree.addChannel(nextChannelID, channelID);
+				maps.parents[nextChannelID] = channelID;
+				channelIDs.push_back(nextChannelID++);
+			}
+			else if (channelIDs.size() > 1) {
+				// Like TeamSpeak, subchannels and clients go first
+				bool hasChildren = false;
+				for (const auto& channel : maps.parents) {
+					hasChildren = hasChildren || channel.second == channelID;
+				}
+				if (hasChildren) {
+					break;
+				}
+				for (auto client = maps.clients.begin(); client != maps.clients.end();) {
+					client = client->second.channelID == channelID ? maps.clients.erase(client) : std::next(client);
+				}
+				tree.removeChannel(channelID);
+				maps.parents.erase(channelID);
+				channelIDs.erase(std::find(channelIDs.begin(), channelIDs.end(), channelID));
+			}
+			break;
+		}
+	}
+
+	if (tree.channelCount() != maps.parents.size() || tree.clientCount() != maps.clients.size()) {
+		printf("consistency: %zu channels, %zu clients in the tree, %zu and %zu in the maps  MISMATCH\n",
+			tree.channelCount(), tree.clientCount(), maps.parents.size(), maps.clients.size());
+		return false;
+	}
+	for (uint64 channelID : channelIDs) {
+		const TreeIndex channel = tree.findChannel(channelID);
+		if (channel == noTreeIndex || tree.memberCount(channel) != maps.memberCount(channelID) || tree.talkerCount(channel) != maps.talkerCount(channelID)
+			|| tree.channelID(tree.topLevelChannel(channel)) != maps.topLevelChannel(channelID)) {
+			printf("consistency: channel %llu differs  MISMATCH\n", (unsigned long long)channelID);
+			return false;
+		}
+		for (size_t i = 0; i < tree.memberCount(channel); i++) {
+			const TreeIndex member = tree.members(channel)[i];
+			if (tree.clientChannel(member) != channel || maps.clients[tree.clientID(member)].channelID != channelID) {
+				printf("consistency: member %u of channel %llu differs  MISMATCH\n", tree.clientID(member), (unsigned long long)channelID);
+				return false;
+			}
+		}
+	}
+	printf("consistency: %lu random edits, %zu channels and %zu clients agree  ok\n", steps, tree.channelCount(), tree.clientCount());
+	return true;
+}
+
+int main(int argc, char** argv) {
+	unsigned long channels = 5000;
+	unsigned long clients = 10000;
+	unsigned long iterations = 200000;
+	unsigned long seed = 1;
+	for (int i = 1; i + 1 < argc; i += 2) {
+		if (!strcmp(argv[i], "--channels")) {
+			channels = strtoul(argv[i + 1], nullptr, 10);
+		}
+		else if (!strcmp(argv[i], "--clients")) {
+			clients = std::min(strtoul(argv[i + 1], nullptr, 10), 60000UL);
+		}
+		else if (!strcmp(argv[i], "--iterations")) {
+			iterations = strtoul(argv[i + 1], nullptr, 10);
+		}
+		else if (!strcmp(argv[i], "--seed")) {
+			seed = strtoul(argv[i + 1], nullptr, 10);
+		}
+	}
+	channels = std::max(channels, 2UL);
+
+	std::mt19937 random((std::mt19937::result_type)seed);
+	const SyntheticServer server = makeServer(channels, clients, random);
+	ChannelTree tree;
+	MapState maps;
+
+	printf("%lu channels, %lu clients\n%-24s %15s %17s %11s\n", channels, clients, "", "channel tree", "maps of IDs", "speedup");
+	report("build",
+		measureNs(31, [&] { buildTree(tree, server); }),
+		measureNs(31, [&] { buildMaps(maps, server); }));
+
+	// Lookups of random channels, the same sequence for both
+	std::vector<uint64> lookups(4096);
+	for (uint64& channelID : lookups) {
+		channelID = random() % channels + 1;
+	}
+	for (size_t i = 0; i < clients; i += 7) {
+		tree.setTalking(tree.findClient(server.clientIDs[i]), true);
+		maps.clients[server.clientIDs[i]].talking = true;
+	}
+	const unsigned long scanIterations = iterations / 1000 + 31;
+	size_t next = 0;
+	report("clients in channel",
+		measureNs(iterations, [&] { benchSink = benchSink + tree.memberCount(tree.findChannel(lookups[next++ % lookups.size()])); }),
+		measureNs(scanIterations, [&] { benchSink = benchSink + maps.memberCount(lookups[next++ % lookups.size()]); }));
+	report("anyone talking",
+		measureNs(iterations, [&] { benchSink = benchSink + (tree.talkerCount(tree.findChannel(lookups[next++ % lookups.size()])) > 0); }),
+		measureNs(scanIterations, [&] { benchSink = benchSink + (maps.talkerCount(lookups[next++ % lookups.size()]) > 0); }));
+	report("top level channel",
+		measureNs(iterations, [&] { benchSink = benchSink + tree.channelID(tree.topLevelChannel(tree.findChannel(lookups[next++ % lookups.size()]))); }),
+		measureNs(iterations, [&] { benchSink = benchSink + maps.topLevelChannel(lookups[next++ % lookups.size()]); }));
+	report("list channel members",
+		measureNs(iterations, [&] {
+			const TreeIndex channel = tree.findChannel(lookups[next++ % lookups.size()]);
+			for (size_t i = 0; i < tree.memberCount(channel); i++) {
+				benchSink = benchSink + tree.clientID(tree.members(channel)[i]);
+			}
+		}),
+		measureNs(scanIterations, [&] {
+			const uint64 channelID = lookups[next++ % lookups.size()];
+			for (const auto& client : maps.clients) {
+				if (client.second.channelID == channelID) {
+					benchSink = benchSink + client.first;
+				}
+			}
+		}));
+	report("move client",
+		measureNs(iterations, [&] {
+			const uint64 channelID = lookups[next++ % lookups.size()];
+			benchSink = benchSink + tree.moveClient(server.clientIDs[(next * 31) % clients], channelID);
+		}),
+		measureNs(iterations, [&] {
+			const uint64 channelID = lookups[next++ % lookups.size()];
+			maps.clients[server.clientIDs[(next * 31) % clients]].channelID = channelID;
+		}));
+	report("talk status change",
+		measureNs(iterations, [&] {
+			const TreeIndex client = tree.findClient(server.clientIDs[next++ % clients]);
+			benchSink = benchSink + tree.setTalking(client, !tree.talking(client));
+		}),
+		measureNs(iterations, [&] {
+			MapState::Client& client = maps.clients[server.clientIDs[next++ % clients]];
+			client.talking = !client.talking;
+		}));
+	// Back and forth between two top level channels, so the subtree's roots are recomputed every time
+	const uint64 movedChannel = server.channelIDs[0];
+	printf("%-24s %12.1f ns\n", "move channel", measureNs(iterations / 100 + 31, [&] {
+		tree.moveChannel(movedChannel, next++ % 2 ? lookups[0] : 0);
+	}));
+
+	bool ok = checkConsistency(makeServer(std::min(channels, 500UL), std::min(clients, 1000UL), random), iterations, random);
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,201 @@
+/*
+ * Encode cost and payload size of every event type, JSON against MessagePack (sinkEncoding).
+ * The events carry typical values, the fields are the ones the hooks send.
+ * Every MessagePack payload is decoded again and has to give the JSON payload byte for byte.
+ *
+ *   encodeBench [--iterations n]
+ *
+ * Exits with 1 if a round trip does not match.
+ */
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <teamspeak/public_definitions.h>
+#include <teamspeak/clientlib_publicdefinitions.h>
+
+#include "eventSerializer.hpp"
+#include "auroraReceiver.hpp"
+
+typedef std::chrono::steady_clock BenchClock;
+
+// Keeps the compiler from dropping the measured calls
+static volatile size_t benchSink;
+
+/* Median ns per call over rounds of calls */
+template <typename F>
+static double measureNs(unsigned long iterations, F call) {
+	const unsigned long rounds = 31;
+	const unsigned long perRound = iterations / rounds + 1;
+	std::vector<double> results;
+	for (unsigned long round = 0; round < rounds; round++) {
+		BenchClock::time_point start = BenchClock::now();
+		for (unsigned long i = 0; i < perRound; i++) {
+			call();
+		}
+		results.push_back(std::chrono::duration<double, std::nano>(BenchClock::now() - start).count() / perRound);
+	}
+	std::sort(results.begin(), results.end());
+	return results[rounds / 2];
+}
+
+struct EncodingTotals {
+	double jsonNs = 0;
+	double msgPackNs = 0;
+	size_t jsonBytes = 0;
+	size_t msgPackBytes = 0;
+};
+
+/* Times one event in both encodings and checks the MessagePack round trip */
+template <typename F>
+static bool benchEvent(const char* name, F serialize, unsigned long iterations, EncodingTotals& totals) {
+	rapidjson::StringBuffer json;
+	rapidjson::StringBuffer msgPack;
+	serialize(json, PayloadEncoding::json);
+	serialize(msgPack, PayloadEncoding::msgPack);
+
+	// Cleared buffers keep their capacity, like the sender's pooled buffers
+	const double jsonNs = measureNs(iterations, [&]() {
+		json.Clear();
+		serialize(json, PayloadEncoding::json);
+		benchSink = json.GetSize();
+	});
+	const double msgPackNs = measureNs(iterations, [&]() {
+		msgPack.Clear();
+		serialize(msgPack, PayloadEncoding::msgPack);
+		benchSink = msgPack.GetSize();
+	});
+
+	std::string decoded;
+	const bool roundTrip = msgPackPayloadToJson(msgPack.GetString(), msgPack.GetSize(), decoded) &&
+		decoded.size() == json.GetSize() && memcmp(decoded.data(), json.GetString(), json.GetSize()) == 0;
+
+	printf("%-32s %8.0f %8.0f %8zu %8zu %7.0f%%%s\n", name, jsonNs, msgPackNs, json.GetSize(), msgPack.GetSize(),
+		100.0 * msgPack.GetSize() / json.GetSize(), roundTrip ? "" : "  ROUND TRIP MISMATCH");
+	if (!roundTrip) {
+		printf("  json    %.*s\n  decoded %s\n", (int)json.GetSize(), json.GetString(), decoded.c_str());
+	}
+
+	totals.jsonNs += jsonNs;
+	totals.msgPackNs += msgPackNs;
+	totals.jsonBytes += json.GetSize();
+	totals.msgPackBytes += msgPack.GetSize();
+	return roundTrip;
+}
+
+#define BENCH_EVENT(eventName, ...) benchEvent(#eventName, [&](rapidjson::StringBuffer& out, PayloadEncoding encoding) { \
+		serializeEvent(out, encoding, AuroraEvent::eventName, AURORA_EVENT_PREFIX(eventName), __VA_ARGS__); \
+	}, iterations, totals)
+
+int main(int argc, char** argv) {
+	unsigned long iterations = 200000;
+	for (int i = 1; i + 1 < argc; i += 2) {
+		if (!strcmp(argv[i], "--iterations")) {
+			iterations = strtoul(argv[i + 1], nullptr, 10);
+		}
+	}
+	if (iterations == 0) {
+		fprintf(stderr, "encodeBench: --iterations must be at least 1\n");
+		return 2;
+	}
+
+	// Hook arguments, named like the hook parameters so EVENT_FIELD picks the right keys
+	uint64 serverConnectionHandlerID = 1;
+	int newStatus = STATUS_CONNECTION_ESTABLISHED;
+	unsigned int errorNumber = 0;
+	anyID clientID = 42;
+	uint64 oldChannelID = 3;
+	uint64 newChannelID = 7;
+	int visibility = ENTER_VISIBILITY;
+	const char* moveMessage = "";
+	anyID kickerID = 5;
+	const char* kickerName = "Server Admin";
+	const char* kickerUniqueIdentifier = "Kz4Wm0cX1b3T9JQ2mZ0pXq8yH6s=";
+	const char* kickMessage = "Please stop spamming the channel";
+	anyID fromClientID = 17;
+	const char* pokerName = "Client 17";
+	const char* pokerUniqueIdentity = "Lq2Vn8eY7a1R5KP0wX3oZt6uJ4c=";
+	const char* message = "hey, are you around for the raid tonight?";
+	int ffIgnored = 0;
+	anyID toID = 42;
+	const char* fromName = "Client 17";
+	const char* fromUniqueIdentifier = "Lq2Vn8eY7a1R5KP0wX3oZt6uJ4c=";
+	int status = STATUS_TALKING;
+	int isReceivedWhisper = 0;
+	const char* name = "Client 42";
+	int flag = CLIENT_INPUT_MUTED;
+	const char* oldValue = "0";
+	const char* newValue = "1";
+	uint64 channelID = 7;
+	const char* channelName = "Raid Channel";
+	unsigned int channelCount = 50;
+	unsigned int clientCount = 200;
+	auto channelClients = makeEventValueWriter([](auto& writer) {
+		static const char* const names[] = { "Client 42", "Client 17", "Client 5", "Client 108", "Client 64", "Client 99" };
+		writer.StartArray();
+		for (unsigned int i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+			writer.StartObject();
+			writeEventKey(writer, EVENT_KEY(clientID));
+			writeEventValue(writer, (anyID)(40 + i));
+			writeEventKey(writer, EVENT_KEY(name));
+			writeEventValue(writer, names[i]);
+			writeEventKey(writer, EVENT_KEY(talkStatus));
+			writeEventValue(writer, (int)(i == 0));
+			writer.EndObject();
+		}
+		writer.EndArray();
+	});
+	unsigned int channelClientCount = 6;
+	unsigned int channelTalkerCount = 1;
+	unsigned int talkerCount = 4;
+	unsigned int loudness = 63;
+	unsigned int peak = 88;
+	unsigned int clipped = 0;
+	auto bands = makeEventValueWriter([](auto& writer) {
+		static const unsigned int levels[16] = { 71, 78, 80, 76, 69, 64, 61, 57, 52, 49, 44, 38, 31, 22, 12, 0 };
+		writer.StartArray();
+		for (unsigned int level : levels) {
+			writer.Uint(level);
+		}
+		writer.EndArray();
+	});
+
+	printf("%lu iterations per event and encoding\n\n", iterations);
+	printf("%-32s %8s %8s %8s %8s %8s\n", "event", "json ns", "mpack ns", "json B", "mpack B", "size");
+
+	EncodingTotals totals;
+	bool ok = BENCH_EVENT(onConnectStatusChangeEvent, EVENT_FIELD(serverConnectionHandlerID), EVENT_FIELD(newStatus), EVENT_FIELD(errorNumber));
+	ok = BENCH_EVENT(onClientMoveEvent, EVENT_FIELD(serverConnectionHandlerID), EVENT_FIELD(clientID), EVENT_FIELD(oldChannelID),
+		EVENT_FIELD(newChannelID), EVENT_FIELD(visibility), EVENT_FIELD(moveMessage)) && ok;
+	ok = BENCH_EVENT(onClientKickFromChannelEvent, EVENT_FIELD(serverConnectionHandlerID), EVENT_FIELD(clientID), EVENT_FIELD(oldChannelID),
+		EVENT_FIELD(newChannelID), EVENT_FIELD(visibility), EVENT_FIELD(kickerID), EVENT_FIELD(kickerName), EVENT_FIELD(kickerUniqueIdentifier),
+		EVENT_FIELD(kickMessage)) && ok;
+	ok = BENCH_EVENT(onClientKickFromServerEvent, EVENT_FIELD(serverConnectionHandlerID), EVENT_FIELD(clientID), EVENT_FIELD(oldChannelID),
+		EVENT_FIELD(newChannelID), EVENT_FIELD(visibility), EVENT_FIELD(kickerID), EVENT_FIELD(kickerName), EVENT_FIELD(kickerUniqueIdentifier),
+		EVENT_FIELD(kickMessage)) && ok;
+	ok = BENCH_EVENT(onClientPokeEvent, EVENT_FIELD(serverConnectionHandlerID), EVENT_FIELD(fromClientID), EVENT_FIELD(pokerName),
+		EVENT_FIELD(pokerUniqueIdentity), EVENT_FIELD(message), EVENT_FIELD(ffIgnored)) && ok;
+	ok = BENCH_EVENT(onTextMessageEvent, EVENT_FIELD(serverConnectionHandlerID), EVENT_FIELD(toID), EVENT_FIELD(fromName),
+		EVENT_FIELD(fromUniqueIdentifier), EVENT_FIELD(message), EVENT_FIELD(ffIgnored)) && ok;
+	ok = BENCH_EVENT(onTalkStatusChangeEvent, EVENT_FIELD(serverConnectionHandlerID), EVENT_FIELD(status), EVENT_FIELD(isReceivedWhisper),
+		EVENT_FIELD(clientID), EVENT_FIELD(name)) && ok;
+	ok = BENCH_EVENT(onClientSelfVariableUpdateEvent, EVENT_FIELD(serverConnectionHandlerID), EVENT_FIELD(flag), EVENT_FIELD(oldValue),
+		EVENT_FIELD(newValue)) && ok;
+	ok = BENCH_EVENT(serverState, EVENT_FIELD(serverConnectionHandlerID), EVENT_FIELD(clientID), EVENT_FIELD(channelID), EVENT_FIELD(channelName),
+		EVENT_FIELD(channelCount), EVENT_FIELD(clientCount), EVENT_FIELD(channelClients)) && ok;
+	ok = BENCH_EVENT(voiceLevel, EVENT_FIELD(serverConnectionHandlerID), EVENT_FIELD(clientID), EVENT_FIELD(loudness), EVENT_FIELD(peak)) && ok;
+	ok = BENCH_EVENT(captureLevel, EVENT_FIELD(serverConnectionHandlerID), EVENT_FIELD(loudness), EVENT_FIELD(peak), EVENT_FIELD(clipped)) && ok;
+	ok = BENCH_EVENT(spectrum, EVENT_FIELD(serverConnectionHandlerID), EVENT_FIELD(bands)) && ok;
+	ok = BENCH_EVENT(serverSummary, EVENT_FIELD(serverConnectionHandlerID), EVENT_FIELD(channelID), EVENT_FIELD(channelClientCount),
+		EVENT_FIELD(channelTalkerCount), EVENT_FIELD(channelCount), EVENT_FIELD(clientCount), EVENT_FIELD(talkerCount)) && ok;
+
+	printf("%-32s %8.0f %8.0f %8zu %8zu %7.0f%%\n", "all", totals.jsonNs, totals.msgPackNs, totals.jsonBytes, totals.msgPackBytes,
+		100.0 * totals.msgPackBytes / totals.jsonBytes);
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,56 @@
+#include <stddef.h>
+
+#include "allocationCounter.hpp"
+
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* pointer, size_t size);
+}
+
+// __thread instead of thread_local, malloc must not run TLS constructors
+static __thread bool counting = false;
+static __thread size_t allocations = 0;
+
+extern "C" {
+
+void* malloc(size_t size) {
+	if (counting) {
+		allocations++;
+	}
+	return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size) {
+	if (counting) {
+		allocations++;
+	}
+	return __libc_calloc(count, size);
+}
+
+void* realloc(void* pointer, size_t size) {
+	if (counting) {
+		allocations++;
+	}
+	return __libc_realloc(pointer, size);
+}
+
+}
+
+void beginCountingAllocations() {
+	allocations = 0;
+	counting = true;
+}
+
+size_t endCountingAllocations() {
+	counting = false;
+	return allocations;
+}
+
+UncountedAllocations::UncountedAllocations() : wasCounting(counting) {
+	counting = false;
+}
+
+UncountedAllocations::~UncountedAllocations() {
+	counting = wasCounting;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stddef.h>
+
+/*
+ * Counts heap allocations made on the calling thread, by the host and by the loaded plugin alike.
+ * malloc, calloc and realloc are interposed in the host executable (glibc only), operator new ends up there as well.
+ */
+
+/* Starts counting allocations on this thread */
+void beginCountingAllocations();
+
+/* Stops counting and returns the allocations since beginCountingAllocations() */
+size_t endCountingAllocations();
+
+/* Pauses counting for its lifetime, used by the fake TS3Functions so their allocations are not blamed on the plugin */
+class UncountedAllocations {
+public:
+	UncountedAllocations();
+	~UncountedAllocations();
+
+	UncountedAllocations(const UncountedAllocations&) = delete;
+	UncountedAllocations& operator=(const UncountedAllocations&) = delete;
+
+private:
+	bool wasCounting;
+};
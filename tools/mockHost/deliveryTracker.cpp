@@ -0,0 +1,82 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "deliveryTracker.hpp"
+#include "auroraReceiver.hpp"
+
+static const char sequenceMarker[] = "#seq:";
+
+DeliveryTracker::DeliveryTracker(size_t capacity) :
+	capacity(capacity), sent(0), delivered(0), events(0), lastArrivalNs(0), sentAt(new int64_t[capacity]), arrivedAt(new std::atomic<int64_t>[capacity]) {
+	for (size_t i = 0; i < capacity; i++) {
+		arrivedAt[i] = 0;
+	}
+}
+
+long DeliveryTracker::markSent(int64_t entryNs) {
+	size_t sequence = sent.load();
+	if (sequence >= capacity) {
+		return -1;
+	}
+	sentAt[sequence] = entryNs;
+	sent.store(sequence + 1);
+	return (long)sequence;
+}
+
+void DeliveryTracker::onPayload(int64_t arrivalNs, const char* body, size_t length) {
+	events += countPostedEvents(body, length);
+	lastArrivalNs = arrivalNs;
+
+	const char* end = body + length;
+	for (const char* position = body; (position = (const char*)memmem(position, end - position, sequenceMarker, sizeof(sequenceMarker) - 1)) != nullptr;) {
+		position += sizeof(sequenceMarker) - 1;
+		size_t sequence = (size_t)strtoul(position, nullptr, 10);
+		int64_t expected = 0;
+		if (sequence < capacity && arrivedAt[sequence].compare_exchange_strong(expected, arrivalNs)) {
+			delivered++;
+		}
+	}
+}
+
+void DeliveryTracker::waitForDelivery(unsigned int idleMs) {
+	size_t lastDelivered = delivered.load();
+	std::chrono::steady_clock::time_point lastProgress = std::chrono::steady_clock::now();
+	while (delivered.load() < sent.load() && std::chrono::steady_clock::now() - lastProgress < std::chrono::milliseconds(idleMs)) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		if (delivered.load() != lastDelivered) {
+			lastDelivered = delivered.load();
+			lastProgress = std::chrono::steady_clock::now();
+		}
+	}
+}
+
+void DeliveryTracker::print(int64_t startNs) {
+	std::vector<int64_t> latencies;
+	size_t total = sent.load();
+	for (size_t i = 0; i < total; i++) {
+		int64_t arrival = arrivedAt[i].load();
+		if (arrival) {
+			latencies.push_back(arrival - sentAt[i]);
+		}
+	}
+
+	double seconds = (lastArrivalNs.load() - startNs) / 1e9;
+	printf("\nend to end: %llu events received, %.0f events/s, %zu of %zu text messages delivered\n",
+		(unsigned long long)events.load(), seconds > 0 ? events.load() / seconds : 0.0, latencies.size(), total);
+	if (latencies.empty()) {
+		return;
+	}
+
+	std::sort(latencies.begin(), latencies.end());
+	auto percentileUs = [&latencies](double percentile) {
+		return latencies[(size_t)(percentile * (latencies.size() - 1) + 0.5)] / 1000.0;
+	};
+	printf("hook entry to receipt: p50 %.1f us, p90 %.1f us, p99 %.1f us, max %.1f us\n",
+		percentileUs(0.50), percentileUs(0.90), percentileUs(0.99), latencies.back() / 1000.0);
+}
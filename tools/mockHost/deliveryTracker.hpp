@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+
+/*
+ * End to end measurement for mockHost --receiver: text messages carry "#seq:<n>", the tracker remembers when
+ * each was handed to the hook and matches it with its arrival at the in-process receiver.
+ */
+class DeliveryTracker {
+public:
+	explicit DeliveryTracker(size_t capacity);
+
+	/* Records hook entry time, returns the sequence number to put in the message or -1 once full */
+	long markSent(int64_t entryNs);
+
+	/* Payload handler of the receiver, runs on its connection threads */
+	void onPayload(int64_t arrivalNs, const char* body, size_t length);
+
+	/* Waits until every sent message arrived, gives up after idleMs without progress */
+	void waitForDelivery(unsigned int idleMs);
+
+	/* Prints events/s from startNs to the last arrival and the hook entry to receipt latencies */
+	void print(int64_t startNs);
+
+private:
+	size_t capacity;
+	std::atomic<size_t> sent;
+	std::atomic<size_t> delivered;
+	std::atomic<uint64_t> events;
+	std::atomic<int64_t> lastArrivalNs;
+	std::unique_ptr<int64_t[]> sentAt;
+	std::unique_ptr<std::atomic<int64_t>[]> arrivedAt;
+};
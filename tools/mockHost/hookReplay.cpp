@@ -0,0 +1,333 @@
+#include <stdio.h>
+#include <string.h>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <utility>
+
+#include <teamspeak/public_definitions.h>
+
+#include "plugin_exports.hpp"
+#include "hookReplay.hpp"
+#include "allocationCounter.hpp"
+#include "mockServer.hpp"
+
+typedef std::chrono::steady_clock ReplayClock;
+
+/* Decodes the arguments of one record in signature order, see hookLog.hpp for the layout */
+class HookReplay::RecordReader {
+public:
+	void reset(const char* recordData, size_t recordSize) {
+		position = recordData;
+		end = recordData + recordSize;
+		nextBuffer = 0;
+		failed = false;
+	}
+
+	bool ok() const { return !failed && position == end; }
+
+	template <typename T>
+	T read() {
+		return readArg((T*)nullptr);
+	}
+
+private:
+	bool take(size_t bytes) {
+		if (failed || (size_t)(end - position) < bytes) {
+			failed = true;
+			return false;
+		}
+		return true;
+	}
+
+	uint32_t readLength() {
+		uint32_t length = 0;
+		if (take(sizeof(length))) {
+			memcpy(&length, position, sizeof(length));
+			position += sizeof(length);
+		}
+		return length;
+	}
+
+	// Integers
+	template <typename T>
+	T readArg(T*) {
+		T value = T();
+		if (take(sizeof(T))) {
+			memcpy(&value, position, sizeof(T));
+			position += sizeof(T);
+		}
+		return value;
+	}
+
+	// Strings point into the mapped log, they were written with their terminating 0
+	const char* readArg(const char**) {
+		const uint32_t length = readLength();
+		if (failed || length == HOOK_LOG_NULL_STRING || !take((size_t)length + 1)) {
+			return nullptr;
+		}
+		const char* value = position;
+		position += (size_t)length + 1;
+		return value;
+	}
+
+	// Buffers are copied, hooks may write to them
+	template <typename T>
+	T* readArg(T**) {
+		const uint32_t length = readLength();
+		if (failed || !take(length)) {
+			return nullptr;
+		}
+		if (nextBuffer == buffers.size()) {
+			buffers.emplace_back();
+		}
+		std::vector<char>& buffer = buffers[nextBuffer++];
+		buffer.assign(position, position + length);
+		position += length;
+		return length ? (T*)buffer.data() : nullptr;
+	}
+
+	const char* position = nullptr;
+	const char* end = nullptr;
+	bool failed = false;
+	size_t nextBuffer = 0;
+	std::vector<std::vector<char>> buffers;
+};
+
+// Mock server bookkeeping, so the plugin's queries during the replay see the clients from the log
+static MockClient* followClient(uint64 serverConnectionHandlerID, anyID clientID) {
+	UncountedAllocations uncounted;
+	MockServer& server = mockServer();
+	if (serverConnectionHandlerID != server.serverConnectionHandlerID || clientID == 0) {
+		return nullptr;
+	}
+	while (server.clients.size() < clientID) {
+		server.clients.push_back(MockClient{ 0, STATUS_NOT_TALKING, "Client " + std::to_string(server.clients.size() + 1) });
+	}
+	MockClient& client = server.clients[clientID - 1];
+	if (!client.channelID) {
+		client.channelID = 1;
+	}
+	return &client;
+}
+
+static void followMove(uint64 serverConnectionHandlerID, anyID clientID, uint64 newChannelID) {
+	UncountedAllocations uncounted;
+	MockServer& server = mockServer();
+	while (server.channels.size() < newChannelID) {
+		server.channels.push_back(MockChannel{ 0, "Channel " + std::to_string(server.channels.size() + 1) });
+	}
+	MockClient* client = followClient(serverConnectionHandlerID, clientID);
+	if (client) {
+		client->channelID = newChannelID;
+		client->talkStatus = STATUS_NOT_TALKING;
+	}
+}
+
+template <typename F, typename Tuple, size_t... Index>
+static void applyArgs(F& function, Tuple& args, std::index_sequence<Index...>) {
+	function(std::get<Index>(args)...);
+}
+
+struct IgnoreArgs {
+	template <typename... Args>
+	void operator()(Args&&...) const {}
+};
+
+/* Replayer of one hook: decodes its arguments, lets the mock server follow, then times the call into the plugin */
+template <typename R, typename... Args, typename Follow>
+static HookReplay::Replayer makeReplayer(R (*hook)(Args...), HookStats* stats, Follow follow) {
+	return [hook, stats, follow](HookReplay::RecordReader& reader) mutable {
+		// Braced initialization evaluates the reads left to right
+		std::tuple<Args...> args{ reader.template read<Args>()... };
+		if (!reader.ok()) {
+			return;
+		}
+		applyArgs(follow, args, std::index_sequence_for<Args...>());
+
+		beginCountingAllocations();
+		ReplayClock::time_point start = ReplayClock::now();
+		applyArgs(hook, args, std::index_sequence_for<Args...>());
+		ReplayClock::time_point end = ReplayClock::now();
+		size_t allocations = endCountingAllocations();
+		stats->record((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count(), allocations);
+	};
+}
+
+template <typename Hook, typename Follow = IgnoreArgs>
+static bool bindHook(void* library, HookLogID id, Hook, std::vector<HookReplay::Replayer>& replayers, std::vector<std::unique_ptr<HookStats>>& stats, Follow follow = Follow()) {
+	std::string symbol = std::string("ts3plugin_") + hookLogName(id);
+	Hook hook = (Hook)dlsym(library, symbol.c_str());
+	if (!hook) {
+		fprintf(stderr, "mockHost: %s missing in plugin\n", symbol.c_str());
+		return false;
+	}
+	replayers[(size_t)id] = makeReplayer(hook, stats[(size_t)id].get(), follow);
+	return true;
+}
+
+HookReplay::HookReplay() : data(nullptr), size(0), recordCount(0), lastTimestampNs(0), hookCalls((size_t)HookLogID::count, 0),
+	replayers((size_t)HookLogID::count), reader(new RecordReader()) {
+	for (size_t i = 0; i < (size_t)HookLogID::count; i++) {
+		stats.emplace_back(new HookStats(hookLogName((HookLogID)i)));
+	}
+}
+
+HookReplay::~HookReplay() {
+	if (data) {
+		munmap((void*)data, size);
+	}
+}
+
+bool HookReplay::open(const char* path) {
+	int file = ::open(path, O_RDONLY);
+	if (file < 0) {
+		fprintf(stderr, "mockHost: cannot open %s\n", path);
+		return false;
+	}
+	struct stat info;
+	if (fstat(file, &info) != 0 || (size_t)info.st_size < sizeof(HookLogHeader)) {
+		fprintf(stderr, "mockHost: %s is too short for a hook log\n", path);
+		::close(file);
+		return false;
+	}
+	void* mapped = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+	::close(file);
+	if (mapped == MAP_FAILED) {
+		fprintf(stderr, "mockHost: cannot map %s\n", path);
+		return false;
+	}
+	data = (const char*)mapped;
+	size = (size_t)info.st_size;
+
+	HookLogHeader header;
+	memcpy(&header, data, sizeof(header));
+	if (memcmp(header.magic, HOOK_LOG_MAGIC, sizeof(header.magic)) != 0 || header.version != HOOK_LOG_VERSION || header.headerSize < sizeof(header)) {
+		fprintf(stderr, "mockHost: %s is not a version %d hook log\n", path, HOOK_LOG_VERSION);
+		return false;
+	}
+
+	// Count the records up front, so the latency samples can be reserved before counting allocations
+	size_t offset = header.headerSize;
+	HookLogRecordHeader record;
+	while (size - offset >= sizeof(record)) {
+		memcpy(&record, data + offset, sizeof(record));
+		if (record.size < sizeof(record) || record.size > size - offset) {
+			break;
+		}
+		if (record.hook < (uint16_t)HookLogID::count) {
+			hookCalls[record.hook]++;
+		}
+		lastTimestampNs = record.timestampNs;
+		recordCount++;
+		offset += record.size;
+	}
+	for (size_t i = 0; i < stats.size(); i++) {
+		stats[i]->reserve(hookCalls[i]);
+	}
+	return true;
+}
+
+bool HookReplay::bind(void* library) {
+	bool ok = true;
+	auto bindIfUsed = [&](HookLogID id, bool bound) {
+		ok = ok && (bound || !hookCalls[(size_t)id]);
+	};
+	auto followConnect = [](uint64 serverConnectionHandlerID, int newStatus, unsigned int) {
+		MockServer& server = mockServer();
+		if (newStatus == STATUS_CONNECTION_ESTABLISHED) {
+			server.serverConnectionHandlerID = serverConnectionHandlerID;
+			server.connected = true;
+		}
+		else if (newStatus == STATUS_DISCONNECTED && serverConnectionHandlerID == server.serverConnectionHandlerID) {
+			server.connected = false;
+		}
+	};
+	auto followMoveArgs = [](uint64 serverConnectionHandlerID, anyID clientID, uint64, uint64 newChannelID, int, auto&&...) {
+		followMove(serverConnectionHandlerID, clientID, newChannelID);
+	};
+	auto followLeave = [](uint64 serverConnectionHandlerID, anyID clientID, auto&&...) {
+		followMove(serverConnectionHandlerID, clientID, 0);
+	};
+	auto followSeen = [](uint64 serverConnectionHandlerID, anyID clientID, auto&&...) {
+		followClient(serverConnectionHandlerID, clientID);
+	};
+	auto followTalk = [](uint64 serverConnectionHandlerID, int status, int, anyID clientID) {
+		MockClient* client = followClient(serverConnectionHandlerID, clientID);
+		if (client) {
+			client->talkStatus = status;
+		}
+	};
+
+	// Hooks the log never calls may be missing from an older plugin
+#define BIND(hookName, ...) bindIfUsed(HookLogID::hookName, bindHook(library, HookLogID::hookName, &ts3plugin_##hookName, replayers, stats, ##__VA_ARGS__))
+	BIND(onConnectStatusChangeEvent, followConnect);
+	BIND(onNewChannelEvent);
+	BIND(onNewChannelCreatedEvent);
+	BIND(onDelChannelEvent);
+	BIND(onChannelMoveEvent);
+	BIND(onUpdateChannelEvent);
+	BIND(onUpdateChannelEditedEvent);
+	BIND(onUpdateClientEvent, followSeen);
+	BIND(onClientMoveEvent, followMoveArgs);
+	BIND(onClientMoveSubscriptionEvent, followMoveArgs);
+	BIND(onClientMoveTimeoutEvent, followMoveArgs);
+	BIND(onClientMoveMovedEvent, followMoveArgs);
+	BIND(onClientKickFromChannelEvent, followMoveArgs);
+	BIND(onClientKickFromServerEvent, followLeave);
+	BIND(onClientBanFromServerEvent, followLeave);
+	BIND(onClientPokeEvent);
+	BIND(onTextMessageEvent);
+	BIND(onTalkStatusChangeEvent, followTalk);
+	BIND(onClientSelfVariableUpdateEvent);
+	BIND(onClientDisplayNameChanged, followSeen);
+	BIND(onEditPlaybackVoiceDataEvent);
+	BIND(onEditCapturedVoiceDataEvent);
+	BIND(onEditMixedPlaybackVoiceDataEvent);
+	BIND(onChannelSubscribeEvent);
+	BIND(onChannelSubscribeFinishedEvent);
+	BIND(onChannelUnsubscribeEvent);
+	BIND(onChannelUnsubscribeFinishedEvent);
+	BIND(onClientIDsEvent);
+	BIND(onClientIDsFinishedEvent);
+	BIND(currentServerConnectionChanged);
+#undef BIND
+	return ok;
+}
+
+size_t HookReplay::run(double speed) {
+	const HookLogHeader* header = (const HookLogHeader*)data;
+	size_t offset = header->headerSize;
+	size_t replayed = 0;
+	ReplayClock::time_point start = ReplayClock::now();
+
+	for (size_t i = 0; i < recordCount; i++) {
+		HookLogRecordHeader record;
+		memcpy(&record, data + offset, sizeof(record));
+		if (speed > 0) {
+			std::this_thread::sleep_until(start + std::chrono::duration_cast<ReplayClock::duration>(std::chrono::duration<double, std::nano>(record.timestampNs / speed)));
+		}
+		if (record.hook < replayers.size() && replayers[record.hook]) {
+			reader->reset(data + offset + sizeof(record), record.size - sizeof(record));
+			replayers[record.hook](*reader);
+			replayed++;
+		}
+		offset += record.size;
+	}
+	return replayed;
+}
+
+void HookReplay::printStats() {
+	for (std::unique_ptr<HookStats>& hookStats : stats) {
+		if (hookStats->calls()) {
+			hookStats->print();
+		}
+	}
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "hookLog.hpp"
+#include "hookStats.hpp"
+
+/*
+ * Feeds a hook log recorded by the plugin (hookLog = 1) back through the exported hooks of the loaded plugin,
+ * at the recorded pace, faster or as fast as possible. The mock server follows the recorded connects, moves and
+ * talk status changes, so the plugin's queries see the clients the log talks about (names are made up).
+ */
+class HookReplay {
+public:
+	HookReplay();
+	~HookReplay();
+
+	HookReplay(const HookReplay&) = delete;
+	HookReplay& operator=(const HookReplay&) = delete;
+
+	/* Maps the log and counts its records. Prints why and returns false if it is not a hook log */
+	bool open(const char* path);
+
+	/* Looks up every hook in the log in the plugin, false if one is missing */
+	bool bind(void* library);
+
+	/* Replays every record, speed 1 is the recorded pace and 0 as fast as possible. Returns the replayed calls */
+	size_t run(double speed);
+
+	/* Recorded time span of the log in seconds */
+	double recordedSeconds() const { return lastTimestampNs / 1e9; }
+
+	void printStats();
+
+	class RecordReader;
+	typedef std::function<void(RecordReader&)> Replayer;
+
+private:
+	const char* data;
+	size_t size;
+	size_t recordCount;
+	uint64_t lastTimestampNs;
+	std::vector<size_t> hookCalls;
+	std::vector<Replayer> replayers;
+	std::vector<std::unique_ptr<HookStats>> stats;
+	std::unique_ptr<RecordReader> reader;
+};
@@ -0,0 +1,43 @@
+#include <stdio.h>
+
+#include <algorithm>
+
+#include "hookStats.hpp"
+
+HookStats::HookStats(const char* hookName) : hookName(hookName), allocations(0), maxAllocations(0) {
+}
+
+void HookStats::reserve(size_t samples) {
+	latencies.reserve(samples);
+}
+
+void HookStats::record(uint64_t latencyNs, size_t callAllocations) {
+	latencies.push_back(latencyNs);
+	allocations += callAllocations;
+	maxAllocations = std::max(maxAllocations, callAllocations);
+}
+
+static double percentileUs(const std::vector<uint64_t>& sorted, double percentile) {
+	size_t index = (size_t)(percentile * (sorted.size() - 1) + 0.5);
+	return sorted[index] / 1000.0;
+}
+
+void HookStats::printHeader() {
+	printf("%-36s %9s %10s %10s %10s %10s %12s %10s\n", "hook", "calls", "p50 us", "p90 us", "p99 us", "max us", "allocs/call", "max allocs");
+}
+
+void HookStats::print() {
+	if (latencies.empty()) {
+		return;
+	}
+	std::sort(latencies.begin(), latencies.end());
+	printf("%-36s %9zu %10.2f %10.2f %10.2f %10.2f %12.2f %10zu\n",
+		hookName,
+		latencies.size(),
+		percentileUs(latencies, 0.50),
+		percentileUs(latencies, 0.90),
+		percentileUs(latencies, 0.99),
+		latencies.back() / 1000.0,
+		(double)allocations / latencies.size(),
+		maxAllocations);
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+/* Latency samples and allocation totals of one exported hook */
+class HookStats {
+public:
+	explicit HookStats(const char* hookName);
+
+	/* Reserves sample storage up front, so recording never allocates while allocations are being counted */
+	void reserve(size_t samples);
+	void record(uint64_t latencyNs, size_t allocations);
+
+	size_t calls() const { return latencies.size(); }
+
+	/* Prints one row of the report, sorts the samples */
+	void print();
+
+	static void printHeader();
+
+private:
+	const char* hookName;
+	std::vector<uint64_t> latencies;
+	size_t allocations;
+	size_t maxAllocations;
+};
@@ -0,0 +1,697 @@
+/*
+ * Loads the plugin .so like the TeamSpeak client would, hands it a fake TS3Functions and drives scripted
+ * event sequences through the exported hooks. Reports per hook latency percentiles, throughput and allocations.
+ *
+ *   mockHost [--plugin path] [--scenario talk|moves|chat|connect|subscribe|tabs|voice|capture|spectrum|mixed] [--events n] [--channels n]
+ *            [--clients n] [--rate events/s] [--seed n] [--config-dir path/] [--stats 0|1]
+ *            [--receiver port [--receiver-transport http|udp|tcp|unix|shm] [--receiver-socket-path path] [--receiver-shm-name name]
+ *                             [--receiver-latency-ms n] [--receiver-error-rate 0..1] [--receiver-refuse-rate 0..1]]
+ *   mockHost --replay aurora_gsi_hooks_<date>_<time>.bin [--speed x] [--plugin path] [--receiver port ...]
+ *
+ * With --receiver a stand-in Aurora runs in-process on that port and text messages are numbered,
+ * which adds events/s and hook entry to receipt latency of the whole pipeline to the report.
+ * The receiver's transport has to match sinkTransport in the plugin's settings (--config-dir).
+ * --replay runs a recorded hook log instead of a scenario, at --speed times the recorded pace (0 as fast as possible).
+ * --stats 1 prints the plugin's "/aurora stats" output before shutting it down and has it write aurora_gsi_stats.json.
+ */
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dlfcn.h>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "plugin_exports.hpp"
+#include "auroraReceiver.hpp"
+#include "allocationCounter.hpp"
+#include "deliveryTracker.hpp"
+#include "hookReplay.hpp"
+#include "hookStats.hpp"
+#include "mockServer.hpp"
+
+#ifndef MOCKHOST_DEFAULT_PLUGIN
+#define MOCKHOST_DEFAULT_PLUGIN "./TeamSpeak3-GSI.so"
+#endif
+
+typedef std::chrono::steady_clock HostClock;
+
+// voice scenario: 10 ms of 48 kHz stereo per buffer, spread over a few talkers
+#define VOICE_BUFFER_SAMPLES 960
+#define VOICE_BUFFER_COUNT 16
+#define VOICE_TALKERS 8
+
+struct HostOptions {
+	const char* pluginPath = MOCKHOST_DEFAULT_PLUGIN;
+	const char* scenario = "mixed";
+	const char* configDir = "";
+	const char* replayPath = nullptr;
+	double speed = 1.0;
+	unsigned long events = 100000;
+	unsigned int channels = 50;
+	unsigned int clients = 200;
+	double rate = 0;
+	unsigned int seed = 1;
+	bool receiver = false;
+	ReceiverOptions receiverOptions;
+	bool stats = false;
+};
+
+struct PluginHooks {
+	decltype(&ts3plugin_setFunctionPointers) setFunctionPointers;
+	decltype(&ts3plugin_registerPluginID) registerPluginID;
+	decltype(&ts3plugin_init) init;
+	decltype(&ts3plugin_shutdown) shutdown;
+	decltype(&ts3plugin_processCommand) processCommand;
+	decltype(&ts3plugin_onConnectStatusChangeEvent) onConnectStatusChangeEvent;
+	decltype(&ts3plugin_onUpdateChannelEditedEvent) onUpdateChannelEditedEvent;
+	decltype(&ts3plugin_onUpdateClientEvent) onUpdateClientEvent;
+	decltype(&ts3plugin_onClientMoveEvent) onClientMoveEvent;
+	decltype(&ts3plugin_onClientPokeEvent) onClientPokeEvent;
+	decltype(&ts3plugin_onTextMessageEvent) onTextMessageEvent;
+	decltype(&ts3plugin_onTalkStatusChangeEvent) onTalkStatusChangeEvent;
+	decltype(&ts3plugin_onClientDisplayNameChanged) onClientDisplayNameChanged;
+	decltype(&ts3plugin_onEditPlaybackVoiceDataEvent) onEditPlaybackVoiceDataEvent;
+	decltype(&ts3plugin_onEditCapturedVoiceDataEvent) onEditCapturedVoiceDataEvent;
+	decltype(&ts3plugin_onEditMixedPlaybackVoiceDataEvent) onEditMixedPlaybackVoiceDataEvent;
+	decltype(&ts3plugin_onChannelSubscribeEvent) onChannelSubscribeEvent;
+	decltype(&ts3plugin_onChannelSubscribeFinishedEvent) onChannelSubscribeFinishedEvent;
+	decltype(&ts3plugin_onChannelUnsubscribeEvent) onChannelUnsubscribeEvent;
+	decltype(&ts3plugin_onChannelUnsubscribeFinishedEvent) onChannelUnsubscribeFinishedEvent;
+	decltype(&ts3plugin_onClientMoveSubscriptionEvent) onClientMoveSubscriptionEvent;
+	decltype(&ts3plugin_onClientIDsEvent) onClientIDsEvent;
+	decltype(&ts3plugin_onClientIDsFinishedEvent) onClientIDsFinishedEvent;
+	decltype(&ts3plugin_currentServerConnectionChanged) currentServerConnectionChanged;
+};
+
+enum HookID {
+	HOOK_CONNECT_STATUS,
+	HOOK_CHANNEL_EDITED,
+	HOOK_CLIENT_UPDATED,
+	HOOK_CLIENT_MOVE,
+	HOOK_POKE,
+	HOOK_TEXT_MESSAGE,
+	HOOK_TALK_STATUS,
+	HOOK_DISPLAY_NAME,
+	HOOK_PLAYBACK_VOICE,
+	HOOK_CAPTURED_VOICE,
+	HOOK_MIXED_PLAYBACK,
+	HOOK_CHANNEL_SUBSCRIBE,
+	HOOK_CHANNEL_SUBSCRIBE_FINISHED,
+	HOOK_CHANNEL_UNSUBSCRIBE,
+	HOOK_CHANNEL_UNSUBSCRIBE_FINISHED,
+	HOOK_CLIENT_MOVE_SUBSCRIPTION,
+	HOOK_CLIENT_IDS,
+	HOOK_CLIENT_IDS_FINISHED,
+	HOOK_CURRENT_CONNECTION,
+	HOOK_COUNT
+};
+
+static HookStats hookStats[HOOK_COUNT] = {
+	HookStats("onConnectStatusChangeEvent"),
+	HookStats("onUpdateChannelEditedEvent"),
+	HookStats("onUpdateClientEvent"),
+	HookStats("onClientMoveEvent"),
+	HookStats("onClientPokeEvent"),
+	HookStats("onTextMessageEvent"),
+	HookStats("onTalkStatusChangeEvent"),
+	HookStats("onClientDisplayNameChanged"),
+	HookStats("onEditPlaybackVoiceDataEvent"),
+	HookStats("onEditCapturedVoiceDataEvent"),
+	HookStats("onEditMixedPlaybackVoiceDataEvent"),
+	HookStats("onChannelSubscribeEvent"),
+	HookStats("onChannelSubscribeFinishedEvent"),
+	HookStats("onChannelUnsubscribeEvent"),
+	HookStats("onChannelUnsubscribeFinishedEvent"),
+	HookStats("onClientMoveSubscriptionEvent"),
+	HookStats("onClientIDsEvent"),
+	HookStats("onClientIDsFinishedEvent"),
+	HookStats("currentServerConnectionChanged"),
+};
+
+template <typename T>
+static bool loadSymbol(void* library, const char* name, T& function) {
+	function = (T)dlsym(library, name);
+	if (!function) {
+		fprintf(stderr, "mockHost: %s missing in plugin\n", name);
+	}
+	return function != nullptr;
+}
+
+static bool loadPlugin(const char* path, PluginHooks& hooks, void*& library) {
+	library = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+	if (!library) {
+		fprintf(stderr, "mockHost: %s\n", dlerror());
+		return false;
+	}
+	return loadSymbol(library, "ts3plugin_setFunctionPointers", hooks.setFunctionPointers)
+		&& loadSymbol(library, "ts3plugin_registerPluginID", hooks.registerPluginID)
+		&& loadSymbol(library, "ts3plugin_init", hooks.init)
+		&& loadSymbol(library, "ts3plugin_shutdown", hooks.shutdown)
+		&& loadSymbol(library, "ts3plugin_processCommand", hooks.processCommand)
+		&& loadSymbol(library, "ts3plugin_onConnectStatusChangeEvent", hooks.onConnectStatusChangeEvent)
+		&& loadSymbol(library, "ts3plugin_onUpdateChannelEditedEvent", hooks.onUpdateChannelEditedEvent)
+		&& loadSymbol(library, "ts3plugin_onUpdateClientEvent", hooks.onUpdateClientEvent)
+		&& loadSymbol(library, "ts3plugin_onClientMoveEvent", hooks.onClientMoveEvent)
+		&& loadSymbol(library, "ts3plugin_onClientPokeEvent", hooks.onClientPokeEvent)
+		&& loadSymbol(library, "ts3plugin_onTextMessageEvent", hooks.onTextMessageEvent)
+		&& loadSymbol(library, "ts3plugin_onTalkStatusChangeEvent", hooks.onTalkStatusChangeEvent)
+		&& loadSymbol(library, "ts3plugin_onClientDisplayNameChanged", hooks.onClientDisplayNameChanged)
+		&& loadSymbol(library, "ts3plugin_onEditPlaybackVoiceDataEvent", hooks.onEditPlaybackVoiceDataEvent)
+		&& loadSymbol(library, "ts3plugin_onEditCapturedVoiceDataEvent", hooks.onEditCapturedVoiceDataEvent)
+		&& loadSymbol(library, "ts3plugin_onEditMixedPlaybackVoiceDataEvent", hooks.onEditMixedPlaybackVoiceDataEvent)
+		&& loadSymbol(library, "ts3plugin_onChannelSubscribeEvent", hooks.onChannelSubscribeEvent)
+		&& loadSymbol(library, "ts3plugin_onChannelSubscribeFinishedEvent", hooks.onChannelSubscribeFinishedEvent)
+		&& loadSymbol(library, "ts3plugin_onChannelUnsubscribeEvent", hooks.onChannelUnsubscribeEvent)
+		&& loadSymbol(library, "ts3plugin_onChannelUnsubscribeFinishedEvent", hooks.onChannelUnsubscribeFinishedEvent)
+		&& loadSymbol(library, "ts3plugin_onClientMoveSubscriptionEvent", hooks.onClientMoveSubscriptionEvent)
+		&& loadSymbol(library, "ts3plugin_onClientIDsEvent", hooks.onClientIDsEvent)
+		&& loadSymbol(library, "ts3plugin_onClientIDsFinishedEvent", hooks.onClientIDsFinishedEvent)
+		&& loadSymbol(library, "ts3plugin_currentServerConnectionChanged", hooks.currentServerConnectionChanged);
+}
+
+/* Calls one hook and records its latency and the allocations made on this thread while it ran */
+template <typename Hook, typename... Args>
+static void callHook(HookID id, Hook hook, Args... args) {
+	beginCountingAllocations();
+	HostClock::time_point start = HostClock::now();
+	hook(args...);
+	HostClock::time_point end = HostClock::now();
+	size_t allocations = endCountingAllocations();
+	hookStats[id].record((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count(), allocations);
+}
+
+class ScenarioRunner {
+public:
+	ScenarioRunner(const PluginHooks& hooks, const HostOptions& options, DeliveryTracker* tracker) : hooks(hooks), random(options.seed), server(mockServer()), tracker(tracker) {
+	}
+
+	void connect() {
+		server.connected = true;
+		callHook(HOOK_CONNECT_STATUS, hooks.onConnectStatusChangeEvent, server.serverConnectionHandlerID, (int)STATUS_CONNECTION_ESTABLISHED, 0u);
+	}
+
+	void disconnect() {
+		server.connected = false;
+		callHook(HOOK_CONNECT_STATUS, hooks.onConnectStatusChangeEvent, server.serverConnectionHandlerID, (int)STATUS_DISCONNECTED, 0u);
+		if (backgroundTab) {
+			callHook(HOOK_CONNECT_STATUS, hooks.onConnectStatusChangeEvent, backgroundTab, (int)STATUS_DISCONNECTED, 0u);
+			backgroundTab = 0;
+		}
+	}
+
+	/* Runs one scripted step, returns false for an unknown scenario */
+	bool step(const char* scenario) {
+		if (!strcmp(scenario, "talk")) {
+			talk();
+		}
+		else if (!strcmp(scenario, "moves")) {
+			move();
+		}
+		else if (!strcmp(scenario, "chat")) {
+			chat();
+		}
+		else if (!strcmp(scenario, "subscribe")) {
+			// Mostly whole server (un)subscriptions, every fourth step the answer to a client ID request
+			if (pick(4) == 0) {
+				requestClientIDs();
+			}
+			else {
+				toggleSubscriptions();
+			}
+		}
+		else if (!strcmp(scenario, "voice")) {
+			playVoice();
+		}
+		else if (!strcmp(scenario, "capture")) {
+			captureVoice();
+		}
+		else if (!strcmp(scenario, "spectrum")) {
+			playMixed();
+		}
+		else if (!strcmp(scenario, "connect")) {
+			if (server.connected) {
+				disconnect();
+			}
+			else {
+				connect();
+			}
+		}
+		else if (!strcmp(scenario, "tabs")) {
+			tabs();
+		}
+		else if (!strcmp(scenario, "mixed")) {
+			mixed();
+		}
+		else {
+			return false;
+		}
+		return true;
+	}
+
+private:
+	unsigned int pick(unsigned int count) {
+		return std::uniform_int_distribution<unsigned int>(0, count - 1)(random);
+	}
+
+	void mixed() {
+		unsigned int roll = pick(100);
+		if (roll < 60) {
+			talk();
+		}
+		else if (roll < 80) {
+			move();
+		}
+		else if (roll < 90) {
+			chat();
+		}
+		else if (roll < 95) {
+			renameClient();
+		}
+		else {
+			renameChannel();
+		}
+	}
+
+	/* Runs a step as if it happened on another connection, the mock server answers for whichever connection is set */
+	template <typename F>
+	void onConnection(uint64 serverConnectionHandlerID, F runStep) {
+		const uint64 mainConnection = server.serverConnectionHandlerID;
+		server.serverConnectionHandlerID = serverConnectionHandlerID;
+		runStep();
+		server.serverConnectionHandlerID = mainConnection;
+	}
+
+	/* The mock server open in a second tab as well: mixed traffic on both, every thousandth step switches the focused tab */
+	void tabs() {
+		if (!backgroundTab) {
+			backgroundTab = server.serverConnectionHandlerID + 1;
+			onConnection(backgroundTab, [this] { connect(); });
+		}
+		if (pick(1000) == 0) {
+			server.focusedConnectionHandlerID = server.focusedConnectionHandlerID == backgroundTab ? server.serverConnectionHandlerID : backgroundTab;
+			callHook(HOOK_CURRENT_CONNECTION, hooks.currentServerConnectionChanged, server.focusedConnectionHandlerID);
+		}
+		onConnection(pick(2) ? backgroundTab : server.serverConnectionHandlerID, [this] { mixed(); });
+	}
+
+	/* Any client but our own that is currently visible */
+	anyID pickOtherClient() {
+		for (;;) {
+			anyID clientID = (anyID)(pick((unsigned int)server.clients.size()) + 1);
+			if (clientID != server.ownClientID && server.clients[clientID - 1].channelID) {
+				return clientID;
+			}
+		}
+	}
+
+	void talk() {
+		anyID clientID = pickOtherClient();
+		MockClient& client = server.clients[clientID - 1];
+		client.talkStatus = client.talkStatus == STATUS_TALKING ? STATUS_NOT_TALKING : STATUS_TALKING;
+		callHook(HOOK_TALK_STATUS, hooks.onTalkStatusChangeEvent, server.serverConnectionHandlerID, client.talkStatus, 0, clientID);
+	}
+
+	void move() {
+		anyID clientID = pickOtherClient();
+		MockClient& client = server.clients[clientID - 1];
+		uint64 oldChannelID = client.channelID;
+		// Every tenth move is a disconnect followed by a reconnect of the same client
+		bool leave = pick(10) == 0;
+		uint64 newChannelID = leave ? 0 : pick((unsigned int)server.channels.size()) + 1;
+
+		client.channelID = newChannelID;
+		client.talkStatus = STATUS_NOT_TALKING;
+		callHook(HOOK_CLIENT_MOVE, hooks.onClientMoveEvent, server.serverConnectionHandlerID, clientID, oldChannelID, newChannelID, (int)(leave ? LEAVE_VISIBILITY : RETAIN_VISIBILITY), "");
+		if (leave) {
+			client.channelID = oldChannelID;
+			callHook(HOOK_CLIENT_MOVE, hooks.onClientMoveEvent, server.serverConnectionHandlerID, clientID, (uint64)0, oldChannelID, (int)ENTER_VISIBILITY, "");
+		}
+	}
+
+	void makeVoiceBuffers() {
+		if (voiceBuffers.empty()) {
+			UncountedAllocations uncounted;
+			std::normal_distribution<double> noise(0.0, 4000.0);
+			voiceBuffers.resize(VOICE_BUFFER_COUNT * VOICE_BUFFER_SAMPLES);
+			for (short& sample : voiceBuffers) {
+				sample = (short)std::max(-32768.0, std::min(32767.0, noise(random)));
+			}
+		}
+	}
+
+	/* One 10 ms buffer of 48 kHz stereo from one of a few talking clients, like the playback thread delivers them */
+	void playVoice() {
+		makeVoiceBuffers();
+		anyID clientID = (anyID)(2 + pick(std::min<unsigned int>(VOICE_TALKERS, (unsigned int)server.clients.size() - 1)));
+		// The hook may edit the samples, hand it a copy like the client does
+		memcpy(voiceScratch, &voiceBuffers[pick(VOICE_BUFFER_COUNT) * VOICE_BUFFER_SAMPLES], sizeof(voiceScratch));
+		callHook(HOOK_PLAYBACK_VOICE, hooks.onEditPlaybackVoiceDataEvent, server.serverConnectionHandlerID, clientID, voiceScratch, VOICE_BUFFER_SAMPLES / 2, 2);
+	}
+
+	/* 10 ms of 48 kHz mono from our own microphone, now and then loud enough to clip */
+	void captureVoice() {
+		makeVoiceBuffers();
+		memcpy(voiceScratch, &voiceBuffers[pick(VOICE_BUFFER_COUNT) * VOICE_BUFFER_SAMPLES], VOICE_BUFFER_SAMPLES);
+		if (pick(50) == 0) {
+			voiceScratch[pick(VOICE_BUFFER_SAMPLES / 2)] = 32767;
+		}
+		int edited = 1;
+		callHook(HOOK_CAPTURED_VOICE, hooks.onEditCapturedVoiceDataEvent, server.serverConnectionHandlerID, voiceScratch, VOICE_BUFFER_SAMPLES / 2, 1, &edited);
+	}
+
+	/* 10 ms of the final 48 kHz stereo mix, as handed over right before it goes to the speakers */
+	void playMixed() {
+		makeVoiceBuffers();
+		memcpy(voiceScratch, &voiceBuffers[pick(VOICE_BUFFER_COUNT) * VOICE_BUFFER_SAMPLES], sizeof(voiceScratch));
+		const unsigned int speakers[2] = { SPEAKER_FRONT_LEFT, SPEAKER_FRONT_RIGHT };
+		unsigned int fillMask = SPEAKER_FRONT_LEFT | SPEAKER_FRONT_RIGHT;
+		callHook(HOOK_MIXED_PLAYBACK, hooks.onEditMixedPlaybackVoiceDataEvent, server.serverConnectionHandlerID, voiceScratch, VOICE_BUFFER_SAMPLES / 2, 2, (const unsigned int*)speakers, &fillMask);
+	}
+
+	void chat() {
+		anyID clientID = pickOtherClient();
+		const MockClient& client = server.clients[clientID - 1];
+		if (pick(4) == 0) {
+			callHook(HOOK_POKE, hooks.onClientPokeEvent, server.serverConnectionHandlerID, clientID, client.nickname.c_str(), "mockUID", "poke", 0);
+		}
+		else {
+			char message[32] = "hello there";
+			long sequence = tracker ? tracker->markSent(receiverClockNs()) : -1;
+			if (sequence >= 0) {
+				snprintf(message, sizeof(message), "#seq:%ld", sequence);
+			}
+			callHook(HOOK_TEXT_MESSAGE, hooks.onTextMessageEvent, server.serverConnectionHandlerID, (anyID)TextMessageTarget_CHANNEL, server.ownClientID, clientID, client.nickname.c_str(), "mockUID", (const char*)message, 0);
+		}
+	}
+
+	/* Unsubscribes from every channel but our own or subscribes to all of them again, a burst closed by its Finished callback */
+	void toggleSubscriptions() {
+		const uint64 ownChannelID = server.clients[server.ownClientID - 1].channelID;
+		subscribed = !subscribed;
+		for (uint64 channelID = 1; channelID <= server.channels.size(); channelID++) {
+			if (channelID != ownChannelID) {
+				callHook(subscribed ? HOOK_CHANNEL_SUBSCRIBE : HOOK_CHANNEL_UNSUBSCRIBE, subscribed ? hooks.onChannelSubscribeEvent : hooks.onChannelUnsubscribeEvent,
+					server.serverConnectionHandlerID, channelID);
+			}
+		}
+		// Clients of the other channels appear or disappear, the mock server keeps them where they are
+		for (size_t i = 0; i < server.clients.size(); i++) {
+			const uint64 channelID = server.clients[i].channelID;
+			if (channelID && channelID != ownChannelID) {
+				callHook(HOOK_CLIENT_MOVE_SUBSCRIPTION, hooks.onClientMoveSubscriptionEvent, server.serverConnectionHandlerID, (anyID)(i + 1),
+					subscribed ? (uint64)0 : channelID, subscribed ? channelID : (uint64)0, (int)(subscribed ? ENTER_VISIBILITY : LEAVE_VISIBILITY));
+			}
+		}
+		if (subscribed) {
+			callHook(HOOK_CHANNEL_SUBSCRIBE_FINISHED, hooks.onChannelSubscribeFinishedEvent, server.serverConnectionHandlerID);
+		}
+		else {
+			callHook(HOOK_CHANNEL_UNSUBSCRIBE_FINISHED, hooks.onChannelUnsubscribeFinishedEvent, server.serverConnectionHandlerID);
+		}
+	}
+
+	/* Answer to a request for the clients of one identity, a few of them in our channel */
+	void requestClientIDs() {
+		const uint64 ownChannelID = server.clients[server.ownClientID - 1].channelID;
+		for (size_t i = 0; i < server.clients.size(); i++) {
+			MockClient& client = server.clients[i];
+			if (client.channelID == ownChannelID && (anyID)(i + 1) != server.ownClientID) {
+				renameCounter++;
+				{
+					UncountedAllocations uncounted;
+					client.nickname = "Client " + std::to_string(i + 1) + "." + std::to_string(renameCounter);
+				}
+				callHook(HOOK_CLIENT_IDS, hooks.onClientIDsEvent, server.serverConnectionHandlerID, "mockUID", (anyID)(i + 1), client.nickname.c_str());
+			}
+		}
+		callHook(HOOK_CLIENT_IDS_FINISHED, hooks.onClientIDsFinishedEvent, server.serverConnectionHandlerID);
+	}
+
+	void renameClient() {
+		anyID clientID = pickOtherClient();
+		MockClient& client = server.clients[clientID - 1];
+		renameCounter++;
+		{
+			UncountedAllocations uncounted;
+			client.nickname = "Client " + std::to_string(clientID) + "." + std::to_string(renameCounter);
+		}
+		callHook(HOOK_CLIENT_UPDATED, hooks.onUpdateClientEvent, server.serverConnectionHandlerID, clientID, clientID, client.nickname.c_str(), "mockUID");
+		callHook(HOOK_DISPLAY_NAME, hooks.onClientDisplayNameChanged, server.serverConnectionHandlerID, clientID, client.nickname.c_str(), "mockUID");
+	}
+
+	void renameChannel() {
+		uint64 channelID = pick((unsigned int)server.channels.size()) + 1;
+		renameCounter++;
+		{
+			UncountedAllocations uncounted;
+			server.channels[channelID - 1].name = "Channel " + std::to_string(channelID) + "." + std::to_string(renameCounter);
+		}
+		callHook(HOOK_CHANNEL_EDITED, hooks.onUpdateChannelEditedEvent, server.serverConnectionHandlerID, channelID, server.ownClientID, "mockAdmin", "mockUID");
+	}
+
+	const PluginHooks& hooks;
+	std::mt19937 random;
+	MockServer& server;
+	DeliveryTracker* tracker;
+	bool subscribed = true;
+	uint64 backgroundTab = 0;
+	unsigned long renameCounter = 0;
+	std::vector<short> voiceBuffers;
+	short voiceScratch[VOICE_BUFFER_SAMPLES];
+};
+
+static bool parseOptions(int argc, char** argv, HostOptions& options) {
+	for (int i = 1; i < argc; i++) {
+		const char* option = argv[i];
+		const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+		if (!value) {
+			fprintf(stderr, "mockHost: %s needs a value\n", option);
+			return false;
+		}
+		i++;
+
+		if (!strcmp(option, "--plugin")) {
+			options.pluginPath = value;
+		}
+		else if (!strcmp(option, "--scenario")) {
+			options.scenario = value;
+		}
+		else if (!strcmp(option, "--replay")) {
+			options.replayPath = value;
+		}
+		else if (!strcmp(option, "--speed")) {
+			options.speed = strtod(value, nullptr);
+		}
+		else if (!strcmp(option, "--config-dir")) {
+			options.configDir = value;
+		}
+		else if (!strcmp(option, "--events")) {
+			options.events = strtoul(value, nullptr, 10);
+		}
+		else if (!strcmp(option, "--channels")) {
+			options.channels = (unsigned int)strtoul(value, nullptr, 10);
+		}
+		else if (!strcmp(option, "--clients")) {
+			options.clients = (unsigned int)strtoul(value, nullptr, 10);
+		}
+		else if (!strcmp(option, "--rate")) {
+			options.rate = strtod(value, nullptr);
+		}
+		else if (!strcmp(option, "--seed")) {
+			options.seed = (unsigned int)strtoul(value, nullptr, 10);
+		}
+		else if (!strcmp(option, "--stats")) {
+			options.stats = atoi(value) != 0;
+		}
+		else if (!strcmp(option, "--receiver")) {
+			options.receiver = true;
+			options.receiverOptions.port = (unsigned short)strtoul(value, nullptr, 10);
+		}
+		else if (!strcmp(option, "--receiver-transport")) {
+			if (!parseReceiverTransport(value, options.receiverOptions.transport)) {
+				fprintf(stderr, "mockHost: unknown transport %s\n", value);
+				return false;
+			}
+		}
+		else if (!strcmp(option, "--receiver-socket-path")) {
+			options.receiverOptions.socketPath = value;
+		}
+		else if (!strcmp(option, "--receiver-shm-name")) {
+			options.receiverOptions.shmName = value;
+		}
+		else if (!strcmp(option, "--receiver-latency-ms")) {
+			options.receiverOptions.latencyMs = (unsigned int)strtoul(value, nullptr, 10);
+		}
+		else if (!strcmp(option, "--receiver-error-rate")) {
+			options.receiverOptions.errorRate = strtod(value, nullptr);
+		}
+		else if (!strcmp(option, "--receiver-refuse-rate")) {
+			options.receiverOptions.refuseRate = strtod(value, nullptr);
+		}
+		else {
+			fprintf(stderr, "mockHost: unknown option %s\n", option);
+			return false;
+		}
+	}
+	if (options.channels < 1 || options.clients < 2 || options.clients > 65000) {
+		fprintf(stderr, "mockHost: need at least 1 channel and 2 to 65000 clients\n");
+		return false;
+	}
+	return true;
+}
+
+static void printReceiverReport(AuroraReceiver& receiver, DeliveryTracker& tracker, int64_t startNs) {
+	receiver.stop();
+	tracker.print(startNs);
+	printf("receiver: %llu requests, %llu answered with 500, %llu connections refused\n",
+		(unsigned long long)receiver.requests(), (unsigned long long)receiver.failedRequests(), (unsigned long long)receiver.refusedConnections());
+}
+
+/* The plugin's own metrics, as "/aurora stats" would show them in the client */
+static void printPluginStats(const PluginHooks& hooks, const HostOptions& options) {
+	if (options.stats) {
+		printf("\n/aurora stats\n");
+		hooks.processCommand(mockServer().serverConnectionHandlerID, "stats");
+		hooks.processCommand(mockServer().serverConnectionHandlerID, "stats json");
+	}
+}
+
+/* Replays a hook log through the initialized plugin, then shuts it down and reports like a scenario run */
+static int runReplay(HookReplay& replay, const PluginHooks& hooks, const HostOptions& options, DeliveryTracker* tracker, AuroraReceiver* receiver) {
+	HostClock::time_point start = HostClock::now();
+	int64_t startNs = receiverClockNs();
+	size_t calls = replay.run(options.speed);
+	double elapsed = std::chrono::duration<double>(HostClock::now() - start).count();
+
+	if (tracker) {
+		tracker->waitForDelivery(2000);
+	}
+	printPluginStats(hooks, options);
+	HostClock::time_point shutdownStart = HostClock::now();
+	hooks.shutdown();
+	double shutdownMs = std::chrono::duration<double, std::milli>(HostClock::now() - shutdownStart).count();
+
+	printf("\nreplay %s: %zu hook calls recorded over %.3f s, replayed in %.3f s, %.0f calls/s, shutdown %.1f ms\n\n",
+		options.replayPath, calls, replay.recordedSeconds(), elapsed, calls / elapsed, shutdownMs);
+	HookStats::printHeader();
+	replay.printStats();
+
+	if (receiver) {
+		printReceiverReport(*receiver, *tracker, startNs);
+	}
+	return 0;
+}
+
+int main(int argc, char** argv) {
+	HostOptions options;
+	if (!parseOptions(argc, argv, options)) {
+		return 2;
+	}
+
+	PluginHooks hooks;
+	void* library;
+	if (!loadPlugin(options.pluginPath, hooks, library)) {
+		return 1;
+	}
+
+	std::unique_ptr<HookReplay> replay;
+	if (options.replayPath) {
+		replay.reset(new HookReplay());
+		if (!replay->open(options.replayPath) || !replay->bind(library)) {
+			return 1;
+		}
+	}
+
+	mockServer().configPath = options.configDir;
+	if (replay) {
+		// The replay fills in channels and clients as the log mentions them, we are client 1
+		populateMockServer(1, 1);
+	}
+	else {
+		populateMockServer(options.channels, options.clients);
+		for (HookStats& stats : hookStats) {
+			stats.reserve(options.events * 2 + 2);
+		}
+	}
+
+	std::unique_ptr<DeliveryTracker> tracker;
+	std::unique_ptr<AuroraReceiver> receiver;
+	if (options.receiver) {
+		tracker.reset(new DeliveryTracker(options.events));
+		DeliveryTracker* deliveries = tracker.get();
+		receiver.reset(new AuroraReceiver(options.receiverOptions, [deliveries](int64_t arrivalNs, const char* body, size_t length, bool accepted) {
+			if (accepted) {
+				deliveries->onPayload(arrivalNs, body, length);
+			}
+		}));
+		if (!receiver->start()) {
+			return 1;
+		}
+	}
+
+	hooks.setFunctionPointers(makeMockFunctions());
+	hooks.registerPluginID("mockHost");
+	if (hooks.init() != 0) {
+		fprintf(stderr, "mockHost: ts3plugin_init failed\n");
+		return 1;
+	}
+
+	if (replay) {
+		return runReplay(*replay, hooks, options, tracker.get(), receiver.get());
+	}
+
+	ScenarioRunner runner(hooks, options, tracker.get());
+	bool connectScenario = !strcmp(options.scenario, "connect");
+	if (!connectScenario) {
+		runner.connect();
+	}
+
+	HostClock::time_point start = HostClock::now();
+	int64_t startNs = receiverClockNs();
+	for (unsigned long i = 0; i < options.events; i++) {
+		if (options.rate > 0) {
+			std::this_thread::sleep_until(start + std::chrono::duration_cast<HostClock::duration>(std::chrono::duration<double>(i / options.rate)));
+		}
+		if (!runner.step(options.scenario)) {
+			fprintf(stderr, "mockHost: unknown scenario %s\n", options.scenario);
+			return 2;
+		}
+	}
+	double elapsed = std::chrono::duration<double>(HostClock::now() - start).count();
+
+	// Shutdown drops whatever is still queued, give the sender time to deliver it first
+	if (tracker) {
+		tracker->waitForDelivery(2000);
+	}
+
+	if (mockServer().connected) {
+		runner.disconnect();
+	}
+	printPluginStats(hooks, options);
+	HostClock::time_point shutdownStart = HostClock::now();
+	hooks.shutdown();
+	double shutdownMs = std::chrono::duration<double, std::milli>(HostClock::now() - shutdownStart).count();
+
+	size_t calls = 0;
+	for (const HookStats& stats : hookStats) {
+		calls += stats.calls();
+	}
+	printf("\nscenario %s: %lu steps, %zu hook calls in %.3f s, %.0f calls/s, shutdown %.1f ms\n\n",
+		options.scenario, options.events, calls, elapsed, calls / elapsed, shutdownMs);
+	HookStats::printHeader();
+	for (HookStats& stats : hookStats) {
+		stats.print();
+	}
+
+	if (receiver) {
+		printReceiverReport(*receiver, *tracker, startNs);
+	}
+	return 0;
+}
@@ -0,0 +1,241 @@
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <teamspeak/public_errors.h>
+#include <teamspeak/public_definitions.h>
+#include <teamspeak/clientlib_publicdefinitions.h>
+#include <ts3_functions.h>
+
+#include "mockServer.hpp"
+#include "allocationCounter.hpp"
+
+MockServer& mockServer() {
+	static MockServer server;
+	return server;
+}
+
+void populateMockServer(unsigned int channelCount, unsigned int clientCount) {
+	MockServer& server = mockServer();
+	char name[64];
+
+	server.channels.clear();
+	server.clients.clear();
+	for (unsigned int i = 0; i < channelCount; i++) {
+		snprintf(name, sizeof(name), "Channel %u", i + 1);
+		// Every fourth channel is a sub channel of the one before it
+		server.channels.push_back(MockChannel{ i % 4 == 3 ? (uint64)i : 0, name });
+	}
+	for (unsigned int i = 0; i < clientCount; i++) {
+		snprintf(name, sizeof(name), "Client %u", i + 1);
+		server.clients.push_back(MockClient{ (uint64)(i % channelCount) + 1, STATUS_NOT_TALKING, name });
+	}
+}
+
+static MockChannel* findChannel(uint64 serverConnectionHandlerID, uint64 channelID) {
+	MockServer& server = mockServer();
+	if (serverConnectionHandlerID != server.serverConnectionHandlerID || channelID == 0 || channelID > server.channels.size()) {
+		return nullptr;
+	}
+	return &server.channels[channelID - 1];
+}
+
+static MockClient* findClient(uint64 serverConnectionHandlerID, anyID clientID) {
+	MockServer& server = mockServer();
+	if (serverConnectionHandlerID != server.serverConnectionHandlerID || clientID == 0 || clientID > server.clients.size() || server.clients[clientID - 1].channelID == 0) {
+		return nullptr;
+	}
+	return &server.clients[clientID - 1];
+}
+
+static char* copyString(const std::string& value) {
+	char* result = (char*)malloc(value.size() + 1);
+	memcpy(result, value.c_str(), value.size() + 1);
+	return result;
+}
+
+static void copyPath(char* path, size_t maxLen, const char* value) {
+	snprintf(path, maxLen, "%s", value);
+}
+
+static unsigned int mockFreeMemory(void* pointer) {
+	free(pointer);
+	return ERROR_ok;
+}
+
+static unsigned int mockLogMessage(const char* logMessage, enum LogLevel severity, const char* channel, uint64 logID) {
+	printf("LOG %d %s: %s\n", (int)severity, channel ? channel : "", logMessage);
+	return ERROR_ok;
+}
+
+static unsigned int mockGetClientID(uint64 serverConnectionHandlerID, anyID* result) {
+	MockServer& server = mockServer();
+	if (serverConnectionHandlerID != server.serverConnectionHandlerID || !server.connected) {
+		return ERROR_not_connected;
+	}
+	*result = server.ownClientID;
+	return ERROR_ok;
+}
+
+static unsigned int mockGetClientVariableAsString(uint64 serverConnectionHandlerID, anyID clientID, size_t flag, char** result) {
+	UncountedAllocations uncounted;
+	MockClient* client = findClient(serverConnectionHandlerID, clientID);
+	if (!client) {
+		return ERROR_client_invalid_id;
+	}
+	if (flag != CLIENT_NICKNAME) {
+		return ERROR_not_implemented;
+	}
+	*result = copyString(client->nickname);
+	return ERROR_ok;
+}
+
+static unsigned int mockGetClientList(uint64 serverConnectionHandlerID, anyID** result) {
+	UncountedAllocations uncounted;
+	MockServer& server = mockServer();
+	if (serverConnectionHandlerID != server.serverConnectionHandlerID) {
+		return ERROR_invalid_server_connection_handler_id;
+	}
+	anyID* list = (anyID*)malloc((server.clients.size() + 1) * sizeof(anyID));
+	size_t count = 0;
+	for (size_t i = 0; i < server.clients.size(); i++) {
+		if (server.clients[i].channelID) {
+			list[count++] = (anyID)(i + 1);
+		}
+	}
+	list[count] = 0;
+	*result = list;
+	return ERROR_ok;
+}
+
+static unsigned int mockGetChannelOfClient(uint64 serverConnectionHandlerID, anyID clientID, uint64* result) {
+	MockClient* client = findClient(serverConnectionHandlerID, clientID);
+	if (!client) {
+		return ERROR_client_invalid_id;
+	}
+	*result = client->channelID;
+	return ERROR_ok;
+}
+
+static unsigned int mockGetChannelVariableAsString(uint64 serverConnectionHandlerID, uint64 channelID, size_t flag, char** result) {
+	UncountedAllocations uncounted;
+	MockChannel* channel = findChannel(serverConnectionHandlerID, channelID);
+	if (!channel) {
+		return ERROR_channel_invalid_id;
+	}
+	if (flag != CHANNEL_NAME) {
+		return ERROR_not_implemented;
+	}
+	*result = copyString(channel->name);
+	return ERROR_ok;
+}
+
+static unsigned int mockGetChannelList(uint64 serverConnectionHandlerID, uint64** result) {
+	UncountedAllocations uncounted;
+	MockServer& server = mockServer();
+	if (serverConnectionHandlerID != server.serverConnectionHandlerID) {
+		return ERROR_invalid_server_connection_handler_id;
+	}
+	uint64* list = (uint64*)malloc((server.channels.size() + 1) * sizeof(uint64));
+	for (size_t i = 0; i < server.channels.size(); i++) {
+		list[i] = i + 1;
+	}
+	list[server.channels.size()] = 0;
+	*result = list;
+	return ERROR_ok;
+}
+
+static unsigned int mockGetChannelClientList(uint64 serverConnectionHandlerID, uint64 channelID, anyID** result) {
+	UncountedAllocations uncounted;
+	MockServer& server = mockServer();
+	if (!findChannel(serverConnectionHandlerID, channelID)) {
+		return ERROR_channel_invalid_id;
+	}
+	anyID* list = (anyID*)malloc((server.clients.size() + 1) * sizeof(anyID));
+	size_t count = 0;
+	for (size_t i = 0; i < server.clients.size(); i++) {
+		if (server.clients[i].channelID == channelID) {
+			list[count++] = (anyID)(i + 1);
+		}
+	}
+	list[count] = 0;
+	*result = list;
+	return ERROR_ok;
+}
+
+static unsigned int mockGetParentChannelOfChannel(uint64 serverConnectionHandlerID, uint64 channelID, uint64* result) {
+	MockChannel* channel = findChannel(serverConnectionHandlerID, channelID);
+	if (!channel) {
+		return ERROR_channel_invalid_id;
+	}
+	*result = channel->parentID;
+	return ERROR_ok;
+}
+
+static unsigned int mockGetServerConnectionHandlerList(uint64** result) {
+	UncountedAllocations uncounted;
+	uint64* list = (uint64*)malloc(2 * sizeof(uint64));
+	list[0] = mockServer().serverConnectionHandlerID;
+	list[1] = 0;
+	*result = list;
+	return ERROR_ok;
+}
+
+static void mockGetAppPath(char* path, size_t maxLen) {
+	copyPath(path, maxLen, "");
+}
+
+static void mockGetResourcesPath(char* path, size_t maxLen) {
+	copyPath(path, maxLen, "");
+}
+
+static void mockGetConfigPath(char* path, size_t maxLen) {
+	copyPath(path, maxLen, mockServer().configPath.c_str());
+}
+
+static void mockGetPluginPath(char* path, size_t maxLen, const char* pluginID) {
+	copyPath(path, maxLen, "");
+}
+
+static uint64 mockGetCurrentServerConnectionHandlerID() {
+	return mockServer().focusedConnectionHandlerID;
+}
+
+static unsigned int mockGetClientDisplayName(uint64 scHandlerID, anyID clientID, char* result, size_t maxLen) {
+	MockClient* client = findClient(scHandlerID, clientID);
+	if (!client) {
+		return ERROR_client_invalid_id;
+	}
+	copyPath(result, maxLen, client->nickname.c_str());
+	return ERROR_ok;
+}
+
+static void mockPrintMessageToCurrentTab(const char* message) {
+	printf("%s\n", message);
+}
+
+TS3Functions makeMockFunctions() {
+	TS3Functions functions;
+	memset(&functions, 0, sizeof(functions));
+
+	functions.freeMemory = mockFreeMemory;
+	functions.logMessage = mockLogMessage;
+	functions.getClientID = mockGetClientID;
+	functions.getClientVariableAsString = mockGetClientVariableAsString;
+	functions.getClientList = mockGetClientList;
+	functions.getChannelOfClient = mockGetChannelOfClient;
+	functions.getChannelVariableAsString = mockGetChannelVariableAsString;
+	functions.getChannelList = mockGetChannelList;
+	functions.getChannelClientList = mockGetChannelClientList;
+	functions.getParentChannelOfChannel = mockGetParentChannelOfChannel;
+	functions.getServerConnectionHandlerList = mockGetServerConnectionHandlerList;
+	functions.getAppPath = mockGetAppPath;
+	functions.getResourcesPath = mockGetResourcesPath;
+	functions.getConfigPath = mockGetConfigPath;
+	functions.getPluginPath = mockGetPluginPath;
+	functions.getCurrentServerConnectionHandlerID = mockGetCurrentServerConnectionHandlerID;
+	functions.getClientDisplayName = mockGetClientDisplayName;
+	functions.printMessageToCurrentTab = mockPrintMessageToCurrentTab;
+	return functions;
+}
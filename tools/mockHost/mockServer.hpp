@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stddef.h>
+
+#include <string>
+#include <vector>
+
+#include <teamspeak/public_definitions.h>
+#include <ts3_functions.h>
+
+/*
+ * Fake server behind the TS3Functions handed to the plugin.
+ * One connection with a flat channel list, channel and client IDs are their index + 1.
+ * The host changes it before calling a hook, just like the real client updates its view before notifying plugins.
+ */
+
+struct MockChannel {
+	uint64 parentID;
+	std::string name;
+};
+
+struct MockClient {
+	uint64 channelID;
+	int talkStatus;
+	std::string nickname;
+};
+
+struct MockServer {
+	uint64 serverConnectionHandlerID = 1;
+	anyID ownClientID = 1;
+	/* Selected tab, getCurrentServerConnectionHandlerID */
+	uint64 focusedConnectionHandlerID = 1;
+	bool connected = false;
+	std::vector<MockChannel> channels;
+	std::vector<MockClient> clients;
+	std::string configPath;
+};
+
+MockServer& mockServer();
+
+/* Creates channelCount channels and spreads clientCount clients over them, our own client is client 1 in channel 1 */
+void populateMockServer(unsigned int channelCount, unsigned int clientCount);
+
+/* Function table backed by mockServer(). Functions the plugin does not use stay nullptr */
+TS3Functions makeMockFunctions();
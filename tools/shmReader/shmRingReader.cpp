@@ -0,0 +1,157 @@
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <time.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+#include <chrono>
+#include <thread>
+
+#include "shmRingReader.hpp"
+
+// Sequence of the first payload after attaching is not known yet
+#define UNKNOWN_SEQUENCE UINT64_MAX
+
+ShmRingReader::ShmRingReader(const char* name) : name(std::string("/") + name), ring(nullptr), data(nullptr), segmentSize(0),
+	readPosition(0), peekedEnd(0), expectedSequence(UNKNOWN_SEQUENCE), lost(0), segmentInode(0) {
+}
+
+ShmRingReader::~ShmRingReader() {
+	detach();
+}
+
+bool ShmRingReader::attach() {
+	if (ring) {
+		return true;
+	}
+	int file = shm_open(name.c_str(), O_RDWR, 0);
+	if (file < 0) {
+		return false;
+	}
+	struct stat info;
+	void* address = MAP_FAILED;
+	if (fstat(file, &info) == 0 && (size_t)info.st_size >= sizeof(ShmRingHeader)) {
+		address = mmap(nullptr, (size_t)info.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+	}
+	close(file);
+	if (address == MAP_FAILED) {
+		return false;
+	}
+
+	ShmRingHeader* header = (ShmRingHeader*)address;
+	// The writer may still be filling in the header
+	if (header->version.load(std::memory_order_acquire) != SHM_RING_VERSION || memcmp(header->magic, SHM_RING_MAGIC, sizeof(header->magic)) != 0 ||
+		shmSegmentSize(header->capacity) > (size_t)info.st_size || header->writerClosed.load()) {
+		munmap(address, (size_t)info.st_size);
+		return false;
+	}
+
+	ring = header;
+	data = (const char*)address + header->dataOffset;
+	segmentSize = (size_t)info.st_size;
+	segmentInode = (uint64_t)info.st_ino;
+	// Continue where the previous reader stopped, the whole ring for a segment nobody read yet
+	readPosition = ring->readPosition.load(std::memory_order_acquire);
+	peekedEnd = readPosition;
+	expectedSequence = UNKNOWN_SEQUENCE;
+	return true;
+}
+
+void ShmRingReader::detach() {
+	if (ring) {
+		munmap(ring, segmentSize);
+		ring = nullptr;
+		data = nullptr;
+	}
+}
+
+/* True if the name now belongs to a newer segment, after the writer was restarted without closing its ring */
+bool ShmRingReader::replaced() {
+	int file = shm_open(name.c_str(), O_RDONLY, 0);
+	if (file < 0) {
+		return true;
+	}
+	struct stat info;
+	bool differs = fstat(file, &info) != 0 || (uint64_t)info.st_ino != segmentInode;
+	close(file);
+	return differs;
+}
+
+bool ShmRingReader::peek(ShmPayload& payload) {
+	if (!ring && !attach()) {
+		return false;
+	}
+	const uint64_t capacity = ring->capacity;
+	const uint64_t write = ring->writePosition.load(std::memory_order_acquire);
+	while (readPosition != write) {
+		const uint64_t offset = readPosition % capacity;
+		if (capacity - offset < sizeof(ShmRecordHeader)) {
+			readPosition += capacity - offset;
+			continue;
+		}
+		ShmRecordHeader header;
+		memcpy(&header, data + offset, sizeof(header));
+		if (header.type == SHM_RECORD_PADDING) {
+			readPosition += sizeof(header) + header.length;
+			continue;
+		}
+
+		if (expectedSequence != UNKNOWN_SEQUENCE && header.sequence > expectedSequence) {
+			lost += header.sequence - expectedSequence;
+		}
+		expectedSequence = header.sequence + 1;
+		payload.data = data + offset + sizeof(header);
+		payload.length = header.length;
+		payload.sequence = header.sequence;
+		peekedEnd = readPosition + shmRecordSize(header.length);
+		return true;
+	}
+	// Skipped padding is free for the writer too
+	ring->readPosition.store(readPosition, std::memory_order_release);
+	return false;
+}
+
+void ShmRingReader::release() {
+	if (ring && peekedEnd != readPosition) {
+		readPosition = peekedEnd;
+		ring->readPosition.store(readPosition, std::memory_order_release);
+	}
+}
+
+void ShmRingReader::wait(int timeoutMs) {
+	if (!ring && !attach()) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(timeoutMs));
+		return;
+	}
+	// Whatever the writer published before closing is still read
+	if (ring->writerClosed.load() && ring->writePosition.load() == readPosition) {
+		detach();
+		return;
+	}
+
+	// Counterpart of the writer's publish and check, see shmRing.hpp
+	const uint32_t counter = ring->wakeCounter.load();
+	ring->readerWaiting.store(1, std::memory_order_seq_cst);
+	bool woken = ring->writePosition.load(std::memory_order_seq_cst) != readPosition;
+	if (!woken) {
+#ifdef __linux__
+		timespec timeout = { timeoutMs / 1000, (long)(timeoutMs % 1000) * 1000000 };
+		woken = syscall(SYS_futex, (uint32_t*)&ring->wakeCounter, FUTEX_WAIT, counter, &timeout, nullptr, 0) == 0 ||
+			ring->wakeCounter.load() != counter;
+#else
+		(void)counter;
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		woken = true;
+#endif
+	}
+	ring->readerWaiting.store(0, std::memory_order_relaxed);
+
+	if ((ring->writerClosed.load() && ring->writePosition.load() == readPosition) || (!woken && replaced())) {
+		detach();
+	}
+}
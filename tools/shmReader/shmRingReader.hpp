@@ -0,0 +1,69 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+#include "shmRing.hpp"
+
+/* Payload in the ring, data points into the shared memory and stays valid until release() */
+struct ShmPayload {
+	const char* data;
+	size_t length;
+	uint64_t sequence;
+};
+
+/*
+ * Reference reader of the plugin's shared memory transport (sinkTransport = shm), see shmRing.hpp for the layout.
+ * Only one reader per segment, and it must be used from one thread. Linux and other POSIX systems,
+ * without futexes the wait falls back to sleeping.
+ *
+ *   ShmRingReader reader("aurora_gsi");
+ *   for (;;) {
+ *       ShmPayload payload;
+ *       while (reader.peek(payload)) {
+ *           handle(payload.data, payload.length);
+ *           reader.release();
+ *       }
+ *       reader.wait(100);
+ *   }
+ */
+class ShmRingReader {
+public:
+	explicit ShmRingReader(const char* name);
+	~ShmRingReader();
+
+	ShmRingReader(const ShmRingReader&) = delete;
+	ShmRingReader& operator=(const ShmRingReader&) = delete;
+
+	/* Maps the segment if the plugin created it and continues where the previous reader stopped. peek and wait attach on their own */
+	bool attach();
+	bool attached() const { return ring != nullptr; }
+
+	/* Next payload without copying it, false if the ring is empty or there is no writer */
+	bool peek(ShmPayload& payload);
+
+	/* Hands the payload from the last peek back to the writer */
+	void release();
+
+	/* Sleeps until the writer publishes, at most timeoutMs. Lets go of the segment once the writer closed or replaced it */
+	void wait(int timeoutMs);
+
+	/* Payloads the writer dropped because the ring was full, as far as this reader saw them */
+	uint64_t lostPayloads() const { return lost; }
+
+private:
+	void detach();
+	bool replaced();
+
+	std::string name;
+	ShmRingHeader* ring;
+	const char* data;
+	size_t segmentSize;
+	uint64_t readPosition;
+	uint64_t peekedEnd;
+	uint64_t expectedSequence;
+	uint64_t lost;
+	uint64_t segmentInode;
+};
@@ -0,0 +1,150 @@
+/*
+ * Per event cost of every sink transport, measured on the sender side against the in-process receiver.
+ * Each post carries one talk status event, the smallest and most frequent payload the plugin sends.
+ *
+ *   sinkBench [--events n] [--port 9188] [--socket-path /tmp/aurora_gsi_bench.sock] [--shm-name aurora_gsi_bench]
+ *
+ * http waits for Aurora's answer on every post, the other transports return once the kernel (or the ring) took the payload,
+ * so their numbers are the sender's cost, not a round trip. Delivery is checked at the receiver afterwards.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define CURL_STATICLIB
+#include <curl/curl.h>
+
+#include "auroraReceiver.hpp"
+#include "httpSink.hpp"
+#include "shmSink.hpp"
+#include "socketSink.hpp"
+
+typedef std::chrono::steady_clock BenchClock;
+
+static const char talkEvent[] =
+	"{\"provider\":{\"name\":\"TeamSpeak\",\"appid\":-1},\"data\":{\"onTalkStatusChangeEvent\":"
+	"{\"serverConnectionHandlerID\":1,\"status\":1,\"isReceivedWhisper\":0,\"clientID\":42,\"name\":\"Client 42\"}}}";
+
+struct BenchOptions {
+	unsigned long events = 20000;
+	unsigned short port = 9188;
+	std::string socketPath = "/tmp/aurora_gsi_bench.sock";
+	std::string shmName = "aurora_gsi_bench";
+};
+
+static double percentile(std::vector<double>& samples, double share) {
+	return samples[std::min(samples.size() - 1, (size_t)(share * samples.size()))];
+}
+
+static std::unique_ptr<AuroraSink> createSink(ReceiverTransport transport, const BenchOptions& options) {
+	switch (transport) {
+	case ReceiverTransport::udp:
+		return std::unique_ptr<AuroraSink>(new DatagramSink(options.port));
+	case ReceiverTransport::tcp:
+		return std::unique_ptr<AuroraSink>(new StreamSink(options.port, nullptr, 250, 1000));
+	case ReceiverTransport::unixSocket:
+		return std::unique_ptr<AuroraSink>(new StreamSink(options.port, options.socketPath.c_str(), 250, 1000));
+	case ReceiverTransport::shm:
+		return std::unique_ptr<AuroraSink>(new ShmRingSink(options.shmName.c_str(), 1 << 20));
+	case ReceiverTransport::http:
+	default:
+		break;
+	}
+	char url[SINK_URL_BUFSIZE];
+	snprintf(url, sizeof(url), "http://localhost:%u", options.port);
+	return std::unique_ptr<AuroraSink>(new HttpSink(url, "application/json", 250, 1000));
+}
+
+static bool benchTransport(const char* name, ReceiverTransport transport, const BenchOptions& options) {
+	ReceiverOptions receiverOptions;
+	receiverOptions.transport = transport;
+	receiverOptions.port = options.port;
+	receiverOptions.socketPath = options.socketPath;
+	receiverOptions.shmName = options.shmName;
+	std::atomic<unsigned long> received(0);
+	AuroraReceiver receiver(receiverOptions, [&received](int64_t, const char*, size_t, bool accepted) {
+		if (accepted) {
+			received++;
+		}
+	});
+	if (!receiver.start()) {
+		return false;
+	}
+
+	std::unique_ptr<AuroraSink> sink = createSink(transport, options);
+	// The first post connects, keep it out of the numbers. The shm reader only finds the segment once the sink created it
+	sink->post(talkEvent, sizeof(talkEvent) - 1);
+	for (int wait = 0; wait < 200 && received.load() == 0; wait++) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+	}
+
+	std::vector<double> latencies;
+	latencies.reserve(options.events);
+	unsigned long failures = 0;
+	BenchClock::time_point start = BenchClock::now();
+	for (unsigned long i = 0; i < options.events; i++) {
+		BenchClock::time_point before = BenchClock::now();
+		if (!sink->post(talkEvent, sizeof(talkEvent) - 1)) {
+			failures++;
+		}
+		latencies.push_back(std::chrono::duration<double, std::micro>(BenchClock::now() - before).count());
+	}
+	double elapsed = std::chrono::duration<double>(BenchClock::now() - start).count();
+
+	// Fire and forget transports may still have payloads in flight
+	const unsigned long expected = options.events + 1;
+	for (int wait = 0; wait < 200 && received.load() < expected; wait++) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+	}
+	sink.reset();
+	receiver.stop();
+
+	std::sort(latencies.begin(), latencies.end());
+	printf("%-6s %9.2f %9.2f %9.2f %9.2f %12.0f %10lu %8lu\n", name,
+		percentile(latencies, 0.5), percentile(latencies, 0.9), percentile(latencies, 0.99), latencies.back(),
+		options.events / elapsed, (unsigned long)received.load(), failures);
+	return received.load() == expected && failures == 0;
+}
+
+int main(int argc, char** argv) {
+	BenchOptions options;
+	for (int i = 1; i + 1 < argc; i += 2) {
+		if (!strcmp(argv[i], "--events")) {
+			options.events = strtoul(argv[i + 1], nullptr, 10);
+		}
+		else if (!strcmp(argv[i], "--port")) {
+			options.port = (unsigned short)strtoul(argv[i + 1], nullptr, 10);
+		}
+		else if (!strcmp(argv[i], "--socket-path")) {
+			options.socketPath = argv[i + 1];
+		}
+		else if (!strcmp(argv[i], "--shm-name")) {
+			options.shmName = argv[i + 1];
+		}
+	}
+	if (options.events == 0) {
+		fprintf(stderr, "sinkBench: --events must be at least 1\n");
+		return 2;
+	}
+
+	curl_global_init(CURL_GLOBAL_ALL);
+	printf("%lu posts of one %zu byte event per transport\n\n", options.events, sizeof(talkEvent) - 1);
+	printf("%-6s %9s %9s %9s %9s %12s %10s %8s\n", "sink", "p50 us", "p90 us", "p99 us", "max us", "posts/s", "received", "failed");
+
+	bool ok = benchTransport("http", ReceiverTransport::http, options);
+	ok = benchTransport("udp", ReceiverTransport::udp, options) && ok;
+	ok = benchTransport("tcp", ReceiverTransport::tcp, options) && ok;
+	ok = benchTransport("unix", ReceiverTransport::unixSocket, options) && ok;
+	ok = benchTransport("shm", ReceiverTransport::shm, options) && ok;
+
+	curl_global_cleanup();
+	return ok ? 0 : 1;
+}